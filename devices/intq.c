@@ -1,6 +1,7 @@
 #include "devices/intq.h"
 #include <debug.h>
 #include "threads/thread.h"
+#include "threads/trace.h"
 
 static int next (int pos);
 static void wait (struct intq *q, struct thread **waiter);
@@ -10,6 +11,7 @@ static void signal (struct intq *q, struct thread **waiter);
 void
 intq_init (struct intq *q) {
 	lock_init (&q->lock);
+	spinlock_init (&q->spin);
 	q->not_full = q->not_empty = NULL;
 	q->head = q->tail = 0;
 }
@@ -37,16 +39,23 @@ intq_getc (struct intq *q) {
 	uint8_t byte;
 
 	ASSERT (intr_get_level () == INTR_OFF);
+	spinlock_acquire (&q->spin);
 	while (intq_empty (q)) {
 		ASSERT (!intr_context ());
+		spinlock_release (&q->spin);
 		lock_acquire (&q->lock);
-		wait (q, &q->not_empty);
+		spinlock_acquire (&q->spin);
+		if (intq_empty (q))
+			wait (q, &q->not_empty);
+		spinlock_release (&q->spin);
 		lock_release (&q->lock);
+		spinlock_acquire (&q->spin);
 	}
 
 	byte = q->buf[q->tail];
 	q->tail = next (q->tail);
 	signal (q, &q->not_full);
+	spinlock_release (&q->spin);
 	return byte;
 }
 
@@ -57,16 +66,23 @@ intq_getc (struct intq *q) {
 void
 intq_putc (struct intq *q, uint8_t byte) {
 	ASSERT (intr_get_level () == INTR_OFF);
+	spinlock_acquire (&q->spin);
 	while (intq_full (q)) {
 		ASSERT (!intr_context ());
+		spinlock_release (&q->spin);
 		lock_acquire (&q->lock);
-		wait (q, &q->not_full);
+		spinlock_acquire (&q->spin);
+		if (intq_full (q))
+			wait (q, &q->not_full);
+		spinlock_release (&q->spin);
 		lock_release (&q->lock);
+		spinlock_acquire (&q->spin);
 	}
 
 	q->buf[q->head] = byte;
 	q->head = next (q->head);
 	signal (q, &q->not_empty);
+	spinlock_release (&q->spin);
 }
 
 /* Returns the position after POS within an intq. */
@@ -76,16 +92,20 @@ next (int pos) {
 }
 
 /* WAITER must be the address of Q's not_empty or not_full
-   member.  Waits until the given condition is true. */
+   member.  Waits until the given condition is true.  Q's
+   spinlock must be held; it is released while the thread waits
+   and held again on return. */
 static void
-wait (struct intq *q UNUSED, struct thread **waiter) {
+wait (struct intq *q, struct thread **waiter) {
 	ASSERT (!intr_context ());
 	ASSERT (intr_get_level () == INTR_OFF);
 	ASSERT ((waiter == &q->not_empty && intq_empty (q))
 			|| (waiter == &q->not_full && intq_full (q)));
 
 	*waiter = thread_current ();
-	thread_block ();
+	trace_record (TRACE_BLOCK, *waiter, TRACE_WAIT_IO, NULL);
+	thread_block_unlock (&q->spin);
+	spinlock_acquire (&q->spin);
 }
 
 /* WAITER must be the address of Q's not_empty or not_full
@@ -0,0 +1,217 @@
+#include "devices/lapic.h"
+#include <debug.h>
+#include "devices/timer.h"
+#include "threads/interrupt.h"
+#include "threads/mmu.h"
+#include "threads/vaddr.h"
+
+/* Local APIC, in xAPIC mode, through its memory-mapped registers.
+
+   Each CPU has its own local APIC at the same physical address,
+   so the one mapping reaches whichever CPU does the access.  The
+   8259A PICs still deliver device interrupts, to the bootstrap
+   processor through its LINT0 pin in virtual wire mode, which the
+   BIOS sets up and lapic_init() leaves alone.  The local APIC is
+   used for interprocessor interrupts (IPIs), including the
+   INIT-SIPI-SIPI sequence that starts an application processor,
+   and for its timer, which devices/timer.c runs in one-shot mode
+   on every CPU.
+
+   Refer to [IA32-v3a] chapter 10 "Advanced Programmable Interrupt
+   Controller (APIC)". */
+
+/* Register offsets. */
+#define ID_REG 0x020                    /* Local APIC ID. */
+#define TPR_REG 0x080                   /* Task Priority. */
+#define EOI_REG 0x0b0                   /* End Of Interrupt. */
+#define SVR_REG 0x0f0                   /* Spurious Interrupt Vector. */
+#define ESR_REG 0x280                   /* Error Status. */
+#define ICR_LO_REG 0x300                /* Interrupt Command, low half. */
+#define ICR_HI_REG 0x310                /* Interrupt Command, high half. */
+#define LINT0_REG 0x350                 /* LVT LINT0. */
+#define LINT1_REG 0x360                 /* LVT LINT1. */
+#define ERROR_REG 0x370                 /* LVT Error. */
+#define TIMER_REG 0x320                 /* LVT Timer. */
+#define TIMER_INIT_REG 0x380            /* Timer Initial Count. */
+#define TIMER_CUR_REG 0x390             /* Timer Current Count. */
+#define TIMER_DIV_REG 0x3e0             /* Timer Divide Configuration. */
+
+/* Spurious Interrupt Vector Register bits. */
+#define SVR_ENABLE 0x100                /* APIC software enable. */
+
+/* LVT bits. */
+#define LVT_MASKED 0x10000              /* Interrupt masked. */
+
+/* Timer Divide Configuration Register value: count at 1/16 of
+   the bus clock.  The LVT Timer's mode bits are left 0, for
+   one-shot mode. */
+#define TIMER_DIV_16 0x3
+
+/* How long lapic_timer_init() measures the timer for. */
+#define TIMER_CAL_NS (10 * 1000 * 1000)
+
+/* Interrupt Command Register bits. */
+#define ICR_FIXED 0x000                 /* Deliver VECTOR. */
+#define ICR_INIT 0x500                  /* INIT. */
+#define ICR_STARTUP 0x600               /* Start-up (SIPI). */
+#define ICR_PENDING 0x1000              /* Delivery status: not yet sent. */
+#define ICR_ASSERT 0x4000               /* Level: assert. */
+#define ICR_LEVEL 0x8000                /* Trigger mode: level. */
+#define ICR_DEST_SHIFT 24               /* Destination in ICR_HI_REG. */
+
+/* Registers, or null if there is no local APIC. */
+static volatile uint32_t *regs;
+
+/* Timer counts per millisecond, set by lapic_timer_init(). */
+static uint64_t timer_khz;
+
+static void
+write_reg (unsigned reg, uint32_t value) {
+	regs[reg / sizeof *regs] = value;
+}
+
+static uint32_t
+read_reg (unsigned reg) {
+	return regs[reg / sizeof *regs];
+}
+
+/* Maps the local APIC registers at physical address PA.  Called
+   once, by the bootstrap processor. */
+void
+lapic_init (uint64_t pa) {
+	regs = mmu_map_device (pa, PGSIZE);
+}
+
+/* Enables the running application processor's local APIC, which
+   comes out of INIT software-disabled, and masks its local
+   interrupt pins, so that it takes nothing but IPIs. */
+void
+lapic_init_ap (void) {
+	ASSERT (regs != NULL);
+
+	write_reg (LINT0_REG, LVT_MASKED);
+	write_reg (LINT1_REG, LVT_MASKED);
+	write_reg (ERROR_REG, LVT_MASKED);
+	write_reg (SVR_REG, SVR_ENABLE | LAPIC_VEC_SPURIOUS);
+	write_reg (ESR_REG, 0);
+	write_reg (TPR_REG, 0);
+	if (timer_khz != 0) {
+		write_reg (TIMER_DIV_REG, TIMER_DIV_16);
+		write_reg (TIMER_REG, LAPIC_VEC_TIMER);
+	}
+	lapic_eoi ();
+}
+
+/* Returns true if lapic_init() has mapped a local APIC. */
+bool
+lapic_present (void) {
+	return regs != NULL;
+}
+
+/* Returns the running CPU's local APIC ID. */
+uint8_t
+lapic_id (void) {
+	return read_reg (ID_REG) >> 24;
+}
+
+/* Acknowledges the interrupt being handled, other than a
+   spurious one. */
+void
+lapic_eoi (void) {
+	write_reg (EOI_REG, 0);
+}
+
+/* Sends CMD to the CPU whose local APIC ID is APIC_ID and waits
+   for the local APIC to accept it.  Interrupts must be off, since
+   the two halves of the command register are written separately. */
+static void
+send_icr (uint8_t apic_id, uint32_t cmd) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	write_reg (ICR_HI_REG, (uint32_t) apic_id << ICR_DEST_SHIFT);
+	write_reg (ICR_LO_REG, cmd);
+	while (read_reg (ICR_LO_REG) & ICR_PENDING)
+		asm volatile ("pause" : : : "memory");
+}
+
+/* Sends interrupt VEC to the CPU whose local APIC ID is APIC_ID. */
+void
+lapic_send_ipi (uint8_t apic_id, uint8_t vec) {
+	enum intr_level old_level = intr_disable ();
+	send_icr (apic_id, ICR_FIXED | vec);
+	intr_set_level (old_level);
+}
+
+/* Starts the application processor whose local APIC ID is
+   APIC_ID running real-mode code at START_PA, which must be
+   page-aligned and below 1 MB, with the INIT-SIPI-SIPI sequence
+   of [MP] appendix B.4.  Sleeps for about 10 ms, so interrupts
+   must be on. */
+void
+lapic_start_ap (uint8_t apic_id, uint64_t start_pa) {
+	enum intr_level old_level;
+	int i;
+
+	ASSERT (start_pa % PGSIZE == 0 && start_pa < 0x100000);
+	ASSERT (intr_get_level () == INTR_ON);
+
+	old_level = intr_disable ();
+	send_icr (apic_id, ICR_INIT | ICR_LEVEL | ICR_ASSERT);
+	send_icr (apic_id, ICR_INIT | ICR_LEVEL);
+	intr_set_level (old_level);
+	timer_msleep (10);
+
+	for (i = 0; i < 2; i++) {
+		old_level = intr_disable ();
+		send_icr (apic_id, ICR_STARTUP | (start_pa >> PGBITS));
+		intr_set_level (old_level);
+		timer_usleep (200);
+	}
+}
+
+/* Measures the running CPU's local APIC timer against timer_ns()
+   and points its interrupt at LAPIC_VEC_TIMER.  Called once, by
+   the bootstrap processor; every CPU's timer runs off the same
+   bus clock, so lapic_init_ap() just reuses the result.  Spins
+   for TIMER_CAL_NS. */
+void
+lapic_timer_init (void) {
+	uint64_t start;
+	uint32_t counted;
+
+	ASSERT (regs != NULL);
+
+	write_reg (TIMER_DIV_REG, TIMER_DIV_16);
+	write_reg (TIMER_REG, LVT_MASKED | LAPIC_VEC_TIMER);
+	write_reg (TIMER_INIT_REG, UINT32_MAX);
+	start = timer_ns ();
+	while (timer_ns () - start < TIMER_CAL_NS)
+		asm volatile ("pause" : : : "memory");
+	counted = UINT32_MAX - read_reg (TIMER_CUR_REG);
+	write_reg (TIMER_INIT_REG, 0);
+
+	timer_khz = (uint64_t) counted * 1000 * 1000 / TIMER_CAL_NS;
+	if (timer_khz == 0)
+		timer_khz = 1;
+	write_reg (TIMER_REG, LAPIC_VEC_TIMER);
+}
+
+/* Makes the running CPU's local APIC timer interrupt once, NS
+   nanoseconds from now, in place of whatever it was set for.  A
+   wait longer than a second is cut short to one second, since
+   the caller will find nothing due then and set it again. */
+void
+lapic_timer_set (uint64_t ns) {
+	uint64_t count;
+
+	ASSERT (timer_khz != 0);
+
+	if (ns > 1000 * 1000 * 1000)
+		ns = 1000 * 1000 * 1000;
+	count = ns * timer_khz / (1000 * 1000);
+	if (count == 0)
+		count = 1;
+	else if (count > UINT32_MAX)
+		count = UINT32_MAX;
+	write_reg (TIMER_INIT_REG, count);
+}
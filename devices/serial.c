@@ -1,12 +1,13 @@
 #include "devices/serial.h"
 #include <debug.h>
+#include <string.h>
 #include "devices/input.h"
-#include "devices/intq.h"
 #include "devices/timer.h"
 #include "threads/io.h"
 #include "threads/interrupt.h"
 #include "threads/synch.h"
 #include "threads/thread.h"
+#include "threads/trace.h"
 
 /* Register definitions for the 16550A UART used in PCs.
    The 16550A has a lot more going on than shown here, but this
@@ -37,6 +38,13 @@
 #define IER_RECV 0x01           /* Interrupt when data received. */
 #define IER_XMIT 0x02           /* Interrupt when transmit finishes. */
 
+/* FIFO Control Register bits. */
+#define FCR_ENABLE 0x01         /* Enable the receive and transmit FIFOs. */
+#define FCR_CLEAR 0x06          /* Clear both FIFOs. */
+
+/* Bytes the transmit FIFO holds. */
+#define TX_FIFO_SIZE 16
+
 /* Line Control Register bits. */
 #define LCR_N81 0x03            /* No parity, 8 data bits, 1 stop bit. */
 #define LCR_DLAB 0x80           /* Divisor Latch Access Bit (DLAB). */
@@ -51,11 +59,33 @@
 /* Transmission mode. */
 static enum { UNINIT, POLL, QUEUE } mode;
 
-/* Data to be transmitted. */
-static struct intq txq;
+/* Data to be transmitted.
+
+   A single-producer, single-consumer ring, both sides under
+   SERIAL_LOCK.  The producer side (serial_putc() and
+   serial_putbuf()) only advances TXQ_HEAD; the consumer, the
+   interrupt handler, only advances TXQ_TAIL.  Both are free-running counters, so the ring holds
+   TXQ_HEAD - TXQ_TAIL bytes, and each side publishes its
+   counter with a release store after touching the buffer.
+
+   A thread that finds the ring full with interrupts on sleeps
+   on TXQ_WAITERS until the interrupt handler has drained half
+   of it. */
+#define TXQ_SIZE 4096           /* Bytes in ring.  Power of 2. */
+static uint8_t txq[TXQ_SIZE];
+static unsigned txq_head;       /* Total bytes ever queued. */
+static unsigned txq_tail;       /* Total bytes ever sent. */
+static struct list txq_waiters; /* Threads waiting for room. */
+
+/* Protects the ring, TXQ_WAITERS and the UART's registers, which
+   any CPU may print through, with interrupts off. */
+static struct spinlock serial_lock;
 
 static void set_serial (int bps);
 static void putc_poll (uint8_t);
+static void putbuf_poll (const uint8_t *, size_t);
+static size_t txq_len (void);
+static void txq_drain (size_t max);
 static void write_ier (void);
 static intr_handler_func serial_interrupt;
 
@@ -67,10 +97,11 @@ static void
 init_poll (void) {
 	ASSERT (mode == UNINIT);
 	outb (IER_REG, 0);                    /* Turn off all interrupts. */
-	outb (FCR_REG, 0);                    /* Disable FIFO. */
+	outb (FCR_REG, FCR_ENABLE | FCR_CLEAR); /* Enable and clear FIFOs. */
 	set_serial (115200);                  /* 115.2 kbps, N-8-1. */
 	outb (MCR_REG, MCR_OUT2);             /* Required to enable interrupts. */
-	intq_init (&txq);
+	list_init (&txq_waiters);
+	spinlock_init (&serial_lock);
 	mode = POLL;
 }
 
@@ -88,37 +119,78 @@ serial_init_queue (void) {
 	intr_register_ext (0x20 + 4, serial_interrupt, "serial");
 	mode = QUEUE;
 	old_level = intr_disable ();
+	spinlock_acquire (&serial_lock);
 	write_ier ();
+	spinlock_release (&serial_lock);
 	intr_set_level (old_level);
 }
 
 /* Sends BYTE to the serial port. */
 void
 serial_putc (uint8_t byte) {
+	serial_putbuf (&byte, 1);
+}
+
+/* Sends the SIZE bytes in BUFFER to the serial port, with
+   interrupts disabled once for the whole buffer rather than
+   once per byte. */
+void
+serial_putbuf (const void *buffer, size_t size) {
+	const uint8_t *p = buffer;
 	enum intr_level old_level = intr_disable ();
 
+	if (mode == UNINIT)
+		init_poll ();
+	spinlock_acquire (&serial_lock);
 	if (mode != QUEUE) {
 		/* If we're not set up for interrupt-driven I/O yet,
-		   use dumb polling to transmit a byte. */
-		if (mode == UNINIT)
-			init_poll ();
-		putc_poll (byte);
-	} else {
-		/* Otherwise, queue a byte and update the interrupt enable
-		   register. */
-		if (old_level == INTR_OFF && intq_full (&txq)) {
-			/* Interrupts are off and the transmit queue is full.
-			   If we wanted to wait for the queue to empty,
-			   we'd have to reenable interrupts.
-			   That's impolite, so we'll send a character via
-			   polling instead. */
-			putc_poll (intq_getc (&txq));
+		   use dumb polling to transmit. */
+		putbuf_poll (p, size);
+		spinlock_release (&serial_lock);
+		intr_set_level (old_level);
+		return;
+	}
+
+	while (size > 0) {
+		size_t room = TXQ_SIZE - txq_len ();
+		size_t head = txq_head % TXQ_SIZE;
+		size_t chunk;
+
+		if (room == 0) {
+			if (old_level == INTR_OFF) {
+				/* Interrupts are off and the transmit queue is full.
+				   If we wanted to wait for the queue to empty,
+				   we'd have to reenable interrupts.
+				   That's impolite, so we'll make room by sending
+				   some of it via polling instead. */
+				txq_drain (TX_FIFO_SIZE);
+			} else {
+				/* Sleep until the interrupt handler has made
+				   room. */
+				struct thread *t = thread_current ();
+
+				ASSERT (!intr_context ());
+				list_push_back (&txq_waiters, &t->elem);
+				write_ier ();
+				trace_record (TRACE_BLOCK, t, TRACE_WAIT_IO, NULL);
+				thread_block_unlock (&serial_lock);
+				spinlock_acquire (&serial_lock);
+			}
+			continue;
 		}
 
-		intq_putc (&txq, byte);
-		write_ier ();
+		/* Copy as much as fits before the ring wraps. */
+		chunk = size < room ? size : room;
+		if (chunk > TXQ_SIZE - head)
+			chunk = TXQ_SIZE - head;
+		memcpy (txq + head, p, chunk);
+		__atomic_store_n (&txq_head, txq_head + chunk, __ATOMIC_RELEASE);
+		p += chunk;
+		size -= chunk;
 	}
+	write_ier ();
 
+	spinlock_release (&serial_lock);
 	intr_set_level (old_level);
 }
 
@@ -127,8 +199,10 @@ serial_putc (uint8_t byte) {
 void
 serial_flush (void) {
 	enum intr_level old_level = intr_disable ();
-	while (!intq_empty (&txq))
-		putc_poll (intq_getc (&txq));
+	spinlock_acquire (&serial_lock);
+	while (txq_len () > 0)
+		txq_drain (TX_FIFO_SIZE);
+	spinlock_release (&serial_lock);
 	intr_set_level (old_level);
 }
 
@@ -139,8 +213,11 @@ serial_flush (void) {
 void
 serial_notify (void) {
 	ASSERT (intr_get_level () == INTR_OFF);
-	if (mode == QUEUE)
+	if (mode == QUEUE) {
+		spinlock_acquire (&serial_lock);
 		write_ier ();
+		spinlock_release (&serial_lock);
+	}
 }
 
 /* Configures the serial port for BPS bits per second. */
@@ -171,7 +248,7 @@ write_ier (void) {
 
 	/* Enable transmit interrupt if we have any characters to
 	   transmit. */
-	if (!intq_empty (&txq))
+	if (txq_len () > 0)
 		ier |= IER_XMIT;
 
 	/* Enable receive interrupt if we have room to store any
@@ -193,6 +270,51 @@ putc_poll (uint8_t byte) {
 	outb (THR_REG, byte);
 }
 
+/* Polls the serial port until its transmit FIFO is empty, and
+   then fills it from the SIZE bytes in BUFFER, until they are
+   all sent. */
+static void
+putbuf_poll (const uint8_t *buffer, size_t size) {
+	while (size > 0) {
+		size_t chunk = size < TX_FIFO_SIZE ? size : TX_FIFO_SIZE;
+
+		putc_poll (*buffer++);
+		for (size--, chunk--; chunk > 0; size--, chunk--)
+			outb (THR_REG, *buffer++);
+	}
+}
+
+/* Returns the number of bytes in the transmit ring. */
+static size_t
+txq_len (void) {
+	return __atomic_load_n (&txq_head, __ATOMIC_ACQUIRE) - txq_tail;
+}
+
+/* Sends up to MAX bytes from the transmit ring: the first one
+   once the transmitter is ready, the rest straight into its
+   FIFO behind it.  Wakes up the threads waiting for room once
+   the ring is no more than half full. */
+static void
+txq_drain (size_t max) {
+	size_t len = txq_len ();
+	size_t cnt = len < max ? len : max;
+	unsigned tail = txq_tail;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (cnt == 0)
+		return;
+	putc_poll (txq[tail++ % TXQ_SIZE]);
+	while (--cnt > 0)
+		outb (THR_REG, txq[tail++ % TXQ_SIZE]);
+	__atomic_store_n (&txq_tail, tail, __ATOMIC_RELEASE);
+
+	if (txq_len () <= TXQ_SIZE / 2)
+		while (!list_empty (&txq_waiters))
+			thread_unblock (list_entry (list_pop_front (&txq_waiters),
+						struct thread, elem));
+}
+
 /* Serial interrupt handler. */
 static void
 serial_interrupt (struct intr_frame *f UNUSED) {
@@ -201,15 +323,20 @@ serial_interrupt (struct intr_frame *f UNUSED) {
 	inb (IIR_REG);
 
 	/* As long as we have room to receive a byte, and the hardware
-	   has a byte for us, receive a byte.  */
+	   has a byte for us, receive a byte.  input_putc() calls
+	   serial_notify(), which takes SERIAL_LOCK, so we may not hold
+	   it yet. */
 	while (!input_full () && (inb (LSR_REG) & LSR_DR) != 0)
 		input_putc (inb (RBR_REG));
 
-	/* As long as we have a byte to transmit, and the hardware is
-	   ready to accept a byte for transmission, transmit a byte. */
-	while (!intq_empty (&txq) && (inb (LSR_REG) & LSR_THRE) != 0)
-		outb (THR_REG, intq_getc (&txq));
+	spinlock_acquire (&serial_lock);
+
+	/* If the transmitter has emptied its FIFO, refill all of it
+	   from the transmit ring. */
+	if ((inb (LSR_REG) & LSR_THRE) != 0)
+		txq_drain (TX_FIFO_SIZE);
 
 	/* Update interrupt enable register based on queue status. */
 	write_ier ();
+	spinlock_release (&serial_lock);
 }
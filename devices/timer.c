@@ -3,12 +3,33 @@
 #include <inttypes.h>
 #include <round.h>
 #include <stdio.h>
+#include "devices/lapic.h"
+#include "threads/cpu.h"
 #include "threads/interrupt.h"
 #include "threads/io.h"
 #include "threads/synch.h"
 #include "threads/thread.h"
+#include "intrinsic.h"
 
-/* See [8254] for hardware details of the 8254 timer chip. */
+/* See [8254] for hardware details of the 8254 timer chip.
+
+   The 8254 interrupts the bootstrap processor TIMER_FREQ times a
+   second and drives timer_ticks(), timer_sleep() and its time
+   slices.  Finer time comes from two other sources:
+
+     - timer_ns() reads the time stamp counter (TSC), whose rate
+       timer_calibrate() measures against the 8254.
+
+     - Each CPU's local APIC timer, once timer_lapic_init() has
+       set it up, interrupts in one-shot mode at the CPU's next
+       event: the earliest deadline among the threads sleeping in
+       timer_msleep(), timer_usleep() and timer_nsleep(), and on
+       an application processor, which the 8254 does not reach,
+       its next tick.
+
+   A sleep shorter than SPIN_NS is not worth two context switches,
+   so it spins on the TSC instead of blocking, as every sleep
+   shorter than a tick does when there is no local APIC. */
 
 #if TIMER_FREQ < 19
 #error 8254 timer requires TIMER_FREQ >= 19
@@ -17,16 +38,39 @@
 #error TIMER_FREQ <= 1000 recommended
 #endif
 
+#define NS_PER_SEC (1000 * 1000 * 1000)
+#define TICK_NS (NS_PER_SEC / TIMER_FREQ)
+#define CAL_TICKS 10                    /* Ticks timer_calibrate() counts. */
+#define SPIN_NS (20 * 1000)             /* Shortest sleep that blocks. */
+
 /* Number of timer ticks since OS booted. */
 static int64_t ticks;
 
-/* Number of loops per timer tick.
-   Initialized by timer_calibrate(). */
-static unsigned loops_per_tick;
+/* TSC cycles per second, and the TSC at the time the OS booted,
+   as far as timer_calibrate() can tell.  Initialized by
+   timer_calibrate(). */
+static uint64_t tsc_hz;
+static uint64_t tsc_base;
+
+/* Threads in timer_msleep() and friends, by deadline. */
+struct sleeper {
+	uint64_t deadline;                  /* timer_ns() to wake at. */
+	struct thread *thread;              /* The sleeping thread. */
+	struct list_elem elem;              /* Element in sleepers. */
+};
+static struct list sleepers;
+static struct spinlock sleepers_lock;
+static bool lapic_timer_on;             /* Local APIC timers running? */
+
+/* Statistics. */
+static long long block_cnt;             /* Sleeps that blocked. */
+static long long spin_cnt;              /* Sleeps that spun. */
 
 static intr_handler_func timer_interrupt;
-static bool too_many_loops (unsigned loops);
-static void busy_wait (int64_t loops);
+static intr_handler_func lapic_timer_interrupt;
+static void timer_arm (uint64_t deadline);
+static void spin_until (uint64_t deadline);
+static void block_until (uint64_t deadline);
 static void real_time_sleep (int64_t num, int32_t denom);
 
 /* Sets up the 8254 Programmable Interval Timer (PIT) to
@@ -42,32 +86,71 @@ timer_init (void) {
 	outb (0x40, count & 0xff);
 	outb (0x40, count >> 8);
 
+	list_init (&sleepers);
+	spinlock_init (&sleepers_lock);
 	intr_register_ext (0x20, timer_interrupt, "8254 Timer");
 }
 
-/* Calibrates loops_per_tick, used to implement brief delays. */
+/* Measures the TSC's rate against the 8254, for timer_ns() and
+   brief delays.  Takes CAL_TICKS timer ticks. */
 void
 timer_calibrate (void) {
-	unsigned high_bit, test_bit;
+	int64_t start;
+	uint64_t tsc;
 
 	ASSERT (intr_get_level () == INTR_ON);
 	printf ("Calibrating timer...  ");
 
-	/* Approximate loops_per_tick as the largest power-of-two
-	   still less than one timer tick. */
-	loops_per_tick = 1u << 10;
-	while (!too_many_loops (loops_per_tick << 1)) {
-		loops_per_tick <<= 1;
-		ASSERT (loops_per_tick != 0);
-	}
+	/* Wait for a timer tick, so as to start right at one. */
+	start = ticks;
+	while (ticks == start)
+		barrier ();
 
-	/* Refine the next 8 bits of loops_per_tick. */
-	high_bit = loops_per_tick;
-	for (test_bit = high_bit >> 1; test_bit != high_bit >> 10; test_bit >>= 1)
-		if (!too_many_loops (high_bit | test_bit))
-			loops_per_tick |= test_bit;
+	/* Count TSC cycles over CAL_TICKS more. */
+	start = ticks;
+	tsc = rdtsc ();
+	while (ticks - start < CAL_TICKS)
+		barrier ();
+	tsc_hz = (rdtsc () - tsc) * TIMER_FREQ / CAL_TICKS;
+
+	/* Line timer_ns() up with timer_ticks(). */
+	tsc_base = tsc - start * (tsc_hz / TIMER_FREQ);
 
-	printf ("%'"PRIu64" loops/s.\n", (uint64_t) loops_per_tick * TIMER_FREQ);
+	printf ("%'"PRIu64" kHz TSC.\n", tsc_hz / 1000);
+}
+
+/* Sets up the bootstrap processor's local APIC timer, once
+   lapic_init() has found the local APIC, and lets the sleeps
+   below a tick block.  Interrupts must be on. */
+void
+timer_lapic_init (void) {
+	enum intr_level old_level;
+
+	ASSERT (tsc_hz != 0);
+
+	lapic_timer_init ();
+	intr_register_ext (LAPIC_VEC_TIMER, lapic_timer_interrupt,
+			"Local APIC Timer");
+
+	old_level = intr_disable ();
+	cpu_current ()->timer_deadline = UINT64_MAX;
+	lapic_timer_on = true;
+	intr_set_level (old_level);
+}
+
+/* Starts the running application processor's ticks, with
+   interrupts off, once lapic_init_ap() has set up its local
+   APIC. */
+void
+timer_init_ap (void) {
+	struct cpu *c = cpu_current ();
+
+	ASSERT (lapic_timer_on);
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	c->timer_deadline = UINT64_MAX;
+	c->tick_deadline = timer_ns () + TICK_NS;
+	timer_arm (c->tick_deadline);
 }
 
 /* Returns the number of timer ticks since the OS booted. */
@@ -87,6 +170,24 @@ timer_elapsed (int64_t then) {
 	return timer_ticks () - then;
 }
 
+/* Returns the number of nanoseconds since the OS booted, or 0
+   before timer_calibrate(). */
+uint64_t
+timer_ns (void) {
+	if (tsc_hz == 0)
+		return 0;
+	return timer_cycles_to_ns (rdtsc () - tsc_base);
+}
+
+/* Converts CYCLES of the TSC to nanoseconds. */
+uint64_t
+timer_cycles_to_ns (uint64_t cycles) {
+	/* Split off whole seconds so that the multiplication cannot
+	   overflow. */
+	return cycles / tsc_hz * NS_PER_SEC
+		+ cycles % tsc_hz * NS_PER_SEC / tsc_hz;
+}
+
 /* Suspends execution for approximately TICKS timer ticks. */
 void
 timer_sleep (int64_t ticks) {
@@ -120,7 +221,9 @@ timer_nsleep (int64_t ns) {
 /* Prints timer statistics. */
 void
 timer_print_stats (void) {
-	printf ("Timer: %"PRId64" ticks\n", timer_ticks ());
+	printf ("Timer: %"PRId64" ticks, %"PRIu64" ms by TSC, "
+			"%lld short sleeps blocked, %lld spun\n", timer_ticks (),
+			timer_ns () / (1000 * 1000), block_cnt, spin_cnt);
 }
 
 /* Timer interrupt handler. */
@@ -145,35 +248,102 @@ timer_interrupt (struct intr_frame *args UNUSED) {
 	thread_awake(ticks);
 }
 
-/* Returns true if LOOPS iterations waits for more than one timer
-   tick, otherwise false. */
+/* Local APIC timer interrupt handler: ticks an application
+   processor, wakes the sleepers that are due, preempting the
+   running thread for them if they outrank it, and sets the timer
+   for the next event. */
+static void
+lapic_timer_interrupt (struct intr_frame *args UNUSED) {
+	struct cpu *c = cpu_current ();
+	uint64_t now = timer_ns ();
+	uint64_t next = UINT64_MAX;
+
+	c->timer_deadline = UINT64_MAX;
+	if (c->id != 0) {
+		if (now >= c->tick_deadline) {
+			thread_tick_ap ();
+			c->tick_deadline += TICK_NS;
+			if (c->tick_deadline <= now)
+				c->tick_deadline = now + TICK_NS;
+		}
+		next = c->tick_deadline;
+	}
+
+	spinlock_acquire (&sleepers_lock);
+	while (!list_empty (&sleepers)) {
+		struct sleeper *s = list_entry (list_front (&sleepers),
+				struct sleeper, elem);
+		struct thread *t = s->thread;
+
+		if (s->deadline > now) {
+			if (s->deadline < next)
+				next = s->deadline;
+			break;
+		}
+		list_pop_front (&sleepers);
+		thread_unblock (t);
+		if (t->cpu == c && t->priority > thread_current ()->priority)
+			intr_yield_on_return ();
+	}
+	spinlock_release (&sleepers_lock);
+
+	if (next != UINT64_MAX)
+		timer_arm (next);
+}
+
+/* Sets the running CPU's local APIC timer to interrupt at
+   DEADLINE, unless it is already set to go off sooner.  The
+   interrupt handler re-arms it for whatever is still pending, so
+   no deadline is lost.  Interrupts must be off. */
+static void
+timer_arm (uint64_t deadline) {
+	struct cpu *c = cpu_current ();
+	uint64_t now;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (deadline >= c->timer_deadline)
+		return;
+	c->timer_deadline = deadline;
+	now = timer_ns ();
+	lapic_timer_set (deadline > now ? deadline - now : 0);
+}
+
+/* Returns true if sleeper A wakes before sleeper B. */
 static bool
-too_many_loops (unsigned loops) {
-	/* Wait for a timer tick. */
-	int64_t start = ticks;
-	while (ticks == start)
-		barrier ();
+sleeper_less (const struct list_elem *a_, const struct list_elem *b_,
+		void *aux UNUSED) {
+	const struct sleeper *a = list_entry (a_, struct sleeper, elem);
+	const struct sleeper *b = list_entry (b_, struct sleeper, elem);
 
-	/* Run LOOPS loops. */
-	start = ticks;
-	busy_wait (loops);
+	return a->deadline < b->deadline;
+}
 
-	/* If the tick count changed, we iterated too long. */
-	barrier ();
-	return start != ticks;
+/* Blocks the running thread until timer_ns() reaches DEADLINE. */
+static void
+block_until (uint64_t deadline) {
+	struct sleeper s;
+	enum intr_level old_level;
+
+	s.deadline = deadline;
+	s.thread = thread_current ();
+
+	old_level = intr_disable ();
+	spinlock_acquire (&sleepers_lock);
+	block_cnt++;
+	list_insert_ordered (&sleepers, &s.elem, sleeper_less, NULL);
+	timer_arm (deadline);
+	thread_block_unlock (&sleepers_lock);
+	intr_set_level (old_level);
 }
 
-/* Iterates through a simple loop LOOPS times, for implementing
-   brief delays.
+/* Spins until timer_ns() reaches DEADLINE. */
+static void
+spin_until (uint64_t deadline) {
+	__atomic_fetch_add (&spin_cnt, 1, __ATOMIC_RELAXED);
 
-   Marked NO_INLINE because code alignment can significantly
-   affect timings, so that if this function was inlined
-   differently in different places the results would be difficult
-   to predict. */
-static void NO_INLINE
-busy_wait (int64_t loops) {
-	while (loops-- > 0)
-		barrier ();
+	while (timer_ns () < deadline)
+		asm volatile ("pause" : : : "memory");
 }
 
 /* Sleep for approximately NUM/DENOM seconds. */
@@ -186,18 +356,23 @@ real_time_sleep (int64_t num, int32_t denom) {
 	   1 s / TIMER_FREQ ticks
 	   */
 	int64_t ticks = num * TIMER_FREQ / denom;
+	int64_t ns = num * (NS_PER_SEC / denom);
 
 	ASSERT (intr_get_level () == INTR_ON);
-	if (ticks > 0) {
+	ASSERT (tsc_hz != 0);
+	if (ns <= 0)
+		return;
+	if (lapic_timer_on && ns >= SPIN_NS) {
+		/* Sleep to the nanosecond, yielding the CPU to other
+		   processes meanwhile. */
+		block_until (timer_ns () + ns);
+	} else if (ticks > 0) {
 		/* We're waiting for at least one full timer tick.  Use
 		   timer_sleep() because it will yield the CPU to other
 		   processes. */
 		timer_sleep (ticks);
 	} else {
-		/* Otherwise, use a busy-wait loop for more accurate
-		   sub-tick timing.  We scale the numerator and denominator
-		   down by 1000 to avoid the possibility of overflow. */
-		ASSERT (denom % 1000 == 0);
-		busy_wait (loops_per_tick * num / 1000 * TIMER_FREQ / (denom / 1000));
+		/* Otherwise, spin for more accurate sub-tick timing. */
+		spin_until (timer_ns () + ns);
 	}
 }
@@ -5,6 +5,7 @@
 #include <string.h>
 #include "threads/io.h"
 #include "threads/interrupt.h"
+#include "threads/synch.h"
 #include "threads/vaddr.h"
 
 /* VGA text screen support.  See [FREEVGA] for more information. */
@@ -25,6 +26,11 @@ static size_t cx, cy;
    The attribute at (x,y) is fb[y][x][1]. */
 static uint8_t (*fb)[COL_CNT][2];
 
+/* Protects the cursor, the framebuffer and the CRTC registers
+   from other CPUs. */
+static struct spinlock vga_lock;
+
+static void putc_fb (int c);
 static void clear_row (size_t y);
 static void cls (void);
 static void newline (void);
@@ -47,12 +53,37 @@ init (void) {
    characters in the conventional ways.  */
 void
 vga_putc (int c) {
+	char ch = c;
+
+	vga_putbuf (&ch, 1);
+}
+
+/* Writes the SIZE characters in BUFFER to the VGA text display,
+   like vga_putc() on each of them, but moving the hardware
+   cursor only once at the end. */
+void
+vga_putbuf (const char *buffer, size_t size) {
 	/* Disable interrupts to lock out interrupt handlers
 	   that might write to the console. */
 	enum intr_level old_level = intr_disable ();
 
+	spinlock_acquire (&vga_lock);
 	init ();
 
+	while (size-- > 0)
+		putc_fb ((uint8_t) *buffer++);
+
+	/* Update cursor position. */
+	move_cursor ();
+
+	spinlock_release (&vga_lock);
+	intr_set_level (old_level);
+}
+
+/* Writes C into the framebuffer at the cursor and advances the
+   cursor.  Interrupts must be off. */
+static void
+putc_fb (int c) {
 	switch (c) {
 		case '\n':
 			newline ();
@@ -84,11 +115,6 @@ vga_putc (int c) {
 				newline ();
 			break;
 	}
-
-	/* Update cursor position. */
-	move_cursor ();
-
-	intr_set_level (old_level);
 }
 
 /* Clears the screen and moves the cursor to the upper left. */
@@ -5,6 +5,7 @@
 #include "filesys/filesys.h"
 #include "filesys/inode.h"
 #include "threads/malloc.h"
+#include "threads/synch.h"
 
 /* A directory. */
 struct dir {
@@ -100,19 +101,26 @@ lookup (const struct dir *dir, const char *name,
 /* Searches DIR for a file with the given NAME
  * and returns true if one exists, false otherwise.
  * On success, sets *INODE to an inode for the file, otherwise to
- * a null pointer.  The caller must close *INODE. */
+ * a null pointer.  The caller must close *INODE.
+ *
+ * The inode is opened before the directory lock is dropped, so a
+ * concurrent dir_remove() cannot free its sectors in between. */
 bool
 dir_lookup (const struct dir *dir, const char *name,
 		struct inode **inode) {
+	struct rwlock *dir_lock;
 	struct dir_entry e;
 
 	ASSERT (dir != NULL);
 	ASSERT (name != NULL);
 
+	dir_lock = inode_dir_lock (dir->inode);
+	rwlock_acquire_read (dir_lock);
 	if (lookup (dir, name, &e, NULL))
 		*inode = inode_open (e.inode_sector);
 	else
 		*inode = NULL;
+	rwlock_release_read (dir_lock);
 
 	return *inode != NULL;
 }
@@ -136,7 +144,10 @@ dir_add (struct dir *dir, const char *name, disk_sector_t inode_sector) {
 	if (*name == '\0' || strlen (name) > NAME_MAX)
 		return false;
 
-	/* Check that NAME is not in use. */
+	/* Check that NAME is not in use.  The directory stays locked
+	 * until the new entry is written, so that two threads cannot
+	 * both claim NAME or the same free slot. */
+	rwlock_acquire_write (inode_dir_lock (dir->inode));
 	if (lookup (dir, name, NULL, NULL))
 		goto done;
 
@@ -159,6 +170,7 @@ dir_add (struct dir *dir, const char *name, disk_sector_t inode_sector) {
 	success = inode_write_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
 
 done:
+	rwlock_release_write (inode_dir_lock (dir->inode));
 	return success;
 }
 
@@ -176,6 +188,7 @@ dir_remove (struct dir *dir, const char *name) {
 	ASSERT (name != NULL);
 
 	/* Find directory entry. */
+	rwlock_acquire_write (inode_dir_lock (dir->inode));
 	if (!lookup (dir, name, &e, &ofs))
 		goto done;
 
@@ -194,6 +207,7 @@ dir_remove (struct dir *dir, const char *name) {
 	success = true;
 
 done:
+	rwlock_release_write (inode_dir_lock (dir->inode));
 	inode_close (inode);
 	return success;
 }
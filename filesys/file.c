@@ -8,6 +8,7 @@ struct file {
 	struct inode *inode;        /* File's inode. */
 	off_t pos;                  /* Current position. */
 	bool deny_write;            /* Has file_deny_write() been called? */
+	int ref_cnt;                /* References; see file_dup(). */
 };
 
 /* Opens a file for the given INODE, of which it takes ownership,
@@ -20,6 +21,7 @@ file_open (struct inode *inode) {
 		file->inode = inode;
 		file->pos = 0;
 		file->deny_write = false;
+		file->ref_cnt = 1;
 		return file;
 	} else {
 		inode_close (inode);
@@ -48,10 +50,26 @@ file_duplicate (struct file *file) {
 	return nfile;
 }
 
-/* Closes FILE. */
+/* Returns FILE with one more reference, for a second file
+ * descriptor that shares FILE and its position.  Each reference
+ * is dropped by its own file_close(). */
+struct file *
+file_dup (struct file *file) {
+	file->ref_cnt++;
+	return file;
+}
+
+/* Returns true if FILE has more than one reference. */
+bool
+file_is_shared (const struct file *file) {
+	return file->ref_cnt > 1;
+}
+
+/* Drops a reference to FILE, closing it when the last one
+ * goes. */
 void
 file_close (struct file *file) {
-	if (file != NULL) {
+	if (file != NULL && --file->ref_cnt == 0) {
 		file_allow_write (file);
 		inode_close (file->inode);
 		free (file);
@@ -113,6 +131,20 @@ file_write_at (struct file *file, const void *buffer, off_t size,
 	return inode_write_at (file->inode, buffer, size, file_ofs);
 }
 
+/* Copies SIZE bytes from IN into OUT, starting at each file's
+ * current position, without going through a caller's buffer.
+ * Returns the number of bytes actually copied,
+ * which may be less than SIZE if the end of either file is reached.
+ * Advances both files' positions by the number of bytes copied. */
+off_t
+file_copy_range (struct file *in, struct file *out, off_t size) {
+	off_t bytes_copied = inode_copy_at (out->inode, out->pos,
+			in->inode, in->pos, size);
+	in->pos += bytes_copied;
+	out->pos += bytes_copied;
+	return bytes_copied;
+}
+
 /* Prevents write operations on FILE's underlying inode
  * until file_allow_write() is called or FILE is closed. */
 void
@@ -6,6 +6,7 @@
 #include "filesys/filesys.h"
 #include "filesys/free-map.h"
 #include "threads/malloc.h"
+#include "threads/synch.h"
 
 /* Identifies an inode. */
 #define INODE_MAGIC 0x494e4f44
@@ -26,13 +27,23 @@ bytes_to_sectors (off_t size) {
 	return DIV_ROUND_UP (size, DISK_SECTOR_SIZE);
 }
 
-/* In-memory inode. */
+/* In-memory inode.
+ *
+ * ELEM, OPEN_CNT and REMOVED are protected by open_inodes_lock.
+ * RW protects the file's contents, DATA and DENY_WRITE_CNT: any
+ * number of readers may be inside inode_read_at() at once, while
+ * writers are exclusive.  DIR_RW is not used by this module; it
+ * serializes updates to the entries of a directory stored in the
+ * inode (see directory.c), so that a lookup and the add or remove
+ * that depends on it are atomic. */
 struct inode {
 	struct list_elem elem;              /* Element in inode list. */
 	disk_sector_t sector;               /* Sector number of disk location. */
 	int open_cnt;                       /* Number of openers. */
 	bool removed;                       /* True if deleted, false otherwise. */
 	int deny_write_cnt;                 /* 0: writes ok, >0: deny writes. */
+	struct rwlock rw;                   /* Protects contents and DATA. */
+	struct rwlock dir_rw;               /* Protects directory entries. */
 	struct inode_disk data;             /* Inode content. */
 };
 
@@ -53,10 +64,14 @@ byte_to_sector (const struct inode *inode, off_t pos) {
  * returns the same `struct inode'. */
 static struct list open_inodes;
 
+/* Protects open_inodes and the open counts of its members. */
+static struct lock open_inodes_lock;
+
 /* Initializes the inode module. */
 void
 inode_init (void) {
 	list_init (&open_inodes);
+	lock_init (&open_inodes_lock);
 }
 
 /* Initializes an inode with LENGTH bytes of data and
@@ -104,20 +119,26 @@ inode_open (disk_sector_t sector) {
 	struct list_elem *e;
 	struct inode *inode;
 
-	/* Check whether this inode is already open. */
+	/* Check whether this inode is already open.  The lock is held
+	 * until the new inode is on the list, so that two threads
+	 * opening the same sector end up sharing one inode. */
+	lock_acquire (&open_inodes_lock);
 	for (e = list_begin (&open_inodes); e != list_end (&open_inodes);
 			e = list_next (e)) {
 		inode = list_entry (e, struct inode, elem);
 		if (inode->sector == sector) {
-			inode_reopen (inode);
+			inode->open_cnt++;
+			lock_release (&open_inodes_lock);
 			return inode; 
 		}
 	}
 
 	/* Allocate memory. */
 	inode = malloc (sizeof *inode);
-	if (inode == NULL)
+	if (inode == NULL) {
+		lock_release (&open_inodes_lock);
 		return NULL;
+	}
 
 	/* Initialize. */
 	list_push_front (&open_inodes, &inode->elem);
@@ -125,15 +146,21 @@ inode_open (disk_sector_t sector) {
 	inode->open_cnt = 1;
 	inode->deny_write_cnt = 0;
 	inode->removed = false;
+	rwlock_init (&inode->rw);
+	rwlock_init (&inode->dir_rw);
 	disk_read (filesys_disk, inode->sector, &inode->data);
+	lock_release (&open_inodes_lock);
 	return inode;
 }
 
 /* Reopens and returns INODE. */
 struct inode *
 inode_reopen (struct inode *inode) {
-	if (inode != NULL)
+	if (inode != NULL) {
+		lock_acquire (&open_inodes_lock);
 		inode->open_cnt++;
+		lock_release (&open_inodes_lock);
+	}
 	return inode;
 }
 
@@ -153,9 +180,12 @@ inode_close (struct inode *inode) {
 		return;
 
 	/* Release resources if this was the last opener. */
+	lock_acquire (&open_inodes_lock);
 	if (--inode->open_cnt == 0) {
-		/* Remove from inode list and release lock. */
+		/* Remove from inode list and release lock.  Nobody else
+		 * can find INODE now, so the rest needs no locking. */
 		list_remove (&inode->elem);
+		lock_release (&open_inodes_lock);
 
 		/* Deallocate blocks if removed. */
 		if (inode->removed) {
@@ -165,7 +195,20 @@ inode_close (struct inode *inode) {
 		}
 
 		free (inode); 
-	}
+	} else
+		lock_release (&open_inodes_lock);
+}
+
+/* Returns true if INODE has been removed, so that the name it was
+ * opened by may now refer to another file. */
+bool
+inode_is_removed (struct inode *inode) {
+	bool removed;
+
+	lock_acquire (&open_inodes_lock);
+	removed = inode->removed;
+	lock_release (&open_inodes_lock);
+	return removed;
 }
 
 /* Marks INODE to be deleted when it is closed by the last caller who
@@ -173,7 +216,9 @@ inode_close (struct inode *inode) {
 void
 inode_remove (struct inode *inode) {
 	ASSERT (inode != NULL);
+	lock_acquire (&open_inodes_lock);
 	inode->removed = true;
+	lock_release (&open_inodes_lock);
 }
 
 /* Reads SIZE bytes from INODE into BUFFER, starting at position OFFSET.
@@ -185,6 +230,7 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset) {
 	off_t bytes_read = 0;
 	uint8_t *bounce = NULL;
 
+	rwlock_acquire_read (&inode->rw);
 	while (size > 0) {
 		/* Disk sector to read, starting byte offset within sector. */
 		disk_sector_t sector_idx = byte_to_sector (inode, offset);
@@ -220,6 +266,7 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset) {
 		offset += chunk_size;
 		bytes_read += chunk_size;
 	}
+	rwlock_release_read (&inode->rw);
 	free (bounce);
 
 	return bytes_read;
@@ -237,8 +284,11 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
 	off_t bytes_written = 0;
 	uint8_t *bounce = NULL;
 
-	if (inode->deny_write_cnt)
+	rwlock_acquire_write (&inode->rw);
+	if (inode->deny_write_cnt) {
+		rwlock_release_write (&inode->rw);
 		return 0;
+	}
 
 	while (size > 0) {
 		/* Sector to write, starting byte offset within sector. */
@@ -282,18 +332,66 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
 		offset += chunk_size;
 		bytes_written += chunk_size;
 	}
+	rwlock_release_write (&inode->rw);
 	free (bounce);
 
 	return bytes_written;
 }
 
+/* Copies SIZE bytes from SRC, starting at SRC_OFS, into DST,
+ * starting at DST_OFS, through a sector-sized kernel buffer, so
+ * the data never passes through a caller's buffer.  Chunks
+ * follow SRC's sector boundaries, so when both offsets are
+ * sector-aligned every chunk is a whole sector and neither
+ * inode_read_at() nor inode_write_at() needs a bounce buffer.
+ * Going through them keeps DST's locking and deny-write rules
+ * in one place.
+ * Returns the number of bytes actually copied, which may be less
+ * than SIZE if the end of SRC is reached or a write to DST comes
+ * up short.  If SRC and DST are the same inode, the two ranges
+ * must not overlap. */
+off_t
+inode_copy_at (struct inode *dst, off_t dst_ofs,
+		struct inode *src, off_t src_ofs, off_t size) {
+	uint8_t *buf;
+	off_t bytes_copied = 0;
+
+	ASSERT (src != dst || src_ofs + size <= dst_ofs || dst_ofs + size <= src_ofs);
+
+	buf = malloc (DISK_SECTOR_SIZE);
+	if (buf == NULL)
+		return 0;
+
+	while (size > 0) {
+		/* Bytes left in source sector, lesser of that and SIZE. */
+		int sector_left = DISK_SECTOR_SIZE - src_ofs % DISK_SECTOR_SIZE;
+		int chunk_size = size < sector_left ? size : sector_left;
+
+		off_t bytes_read = inode_read_at (src, buf, chunk_size, src_ofs);
+		off_t bytes_written = inode_write_at (dst, buf, bytes_read, dst_ofs);
+		bytes_copied += bytes_written;
+		if (bytes_written != chunk_size)
+			break;
+
+		/* Advance. */
+		size -= chunk_size;
+		src_ofs += chunk_size;
+		dst_ofs += chunk_size;
+	}
+	free (buf);
+
+	return bytes_copied;
+}
+
 /* Disables writes to INODE.
    May be called at most once per inode opener. */
 	void
 inode_deny_write (struct inode *inode) 
 {
+	rwlock_acquire_write (&inode->rw);
 	inode->deny_write_cnt++;
 	ASSERT (inode->deny_write_cnt <= inode->open_cnt);
+	rwlock_release_write (&inode->rw);
 }
 
 /* Re-enables writes to INODE.
@@ -301,13 +399,25 @@ inode_deny_write (struct inode *inode)
  * inode_deny_write() on the inode, before closing the inode. */
 void
 inode_allow_write (struct inode *inode) {
+	rwlock_acquire_write (&inode->rw);
 	ASSERT (inode->deny_write_cnt > 0);
 	ASSERT (inode->deny_write_cnt <= inode->open_cnt);
 	inode->deny_write_cnt--;
+	rwlock_release_write (&inode->rw);
 }
 
-/* Returns the length, in bytes, of INODE's data. */
+/* Returns the length, in bytes, of INODE's data.
+ * Takes no lock: files do not grow, so the length never changes
+ * while the inode is open, and inode_read_at() and
+ * inode_write_at() call this with INODE's lock already held. */
 off_t
 inode_length (const struct inode *inode) {
 	return inode->data.length;
 }
+
+/* Returns the lock that serializes changes to the directory
+ * entries stored in INODE. */
+struct rwlock *
+inode_dir_lock (struct inode *inode) {
+	return &inode->dir_rw;
+}
@@ -15,7 +15,8 @@
    and condition variables from threads/synch.h cannot be used in
    this case, as they normally would, because they can only
    protect kernel threads from one another, not from interrupt
-   handlers. */
+   handlers.  Turning interrupts off keeps out only the running
+   CPU's handlers, so a spinlock keeps out the other CPUs. */
 
 /* Queue buffer size, in bytes. */
 #define INTQ_BUFSIZE 64
@@ -24,6 +25,7 @@
 struct intq {
 	/* Waiting threads. */
 	struct lock lock;           /* Only one thread may wait at once. */
+	struct spinlock spin;       /* Protects the members below. */
 	struct thread *not_full;    /* Thread waiting for not-full condition. */
 	struct thread *not_empty;   /* Thread waiting for not-empty condition. */
 
@@ -0,0 +1,26 @@
+#ifndef DEVICES_LAPIC_H
+#define DEVICES_LAPIC_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Interrupt vectors raised by the local APIC, above the 8259A
+   PICs' range, the exceptions, and the system call gate.
+   Vectors LAPIC_VEC_FIRST...LAPIC_VEC_SPURIOUS - 1 are handled
+   like the PICs' external interrupts. */
+#define LAPIC_VEC_FIRST 0xf0
+#define LAPIC_VEC_RESCHED 0xf0          /* IPI: look at the run queue. */
+#define LAPIC_VEC_TIMER 0xf1            /* Local APIC timer. */
+#define LAPIC_VEC_SPURIOUS 0xff         /* Spurious, takes no EOI. */
+
+void lapic_init (uint64_t pa);
+void lapic_init_ap (void);
+bool lapic_present (void);
+uint8_t lapic_id (void);
+void lapic_eoi (void);
+void lapic_send_ipi (uint8_t apic_id, uint8_t vec);
+void lapic_start_ap (uint8_t apic_id, uint64_t start_pa);
+void lapic_timer_init (void);
+void lapic_timer_set (uint64_t ns);
+
+#endif /* devices/lapic.h */
@@ -9,9 +9,13 @@
 
 void timer_init (void);
 void timer_calibrate (void);
+void timer_lapic_init (void);
+void timer_init_ap (void);
 
 int64_t timer_ticks (void);
 int64_t timer_elapsed (int64_t);
+uint64_t timer_ns (void);
+uint64_t timer_cycles_to_ns (uint64_t cycles);
 
 void timer_sleep (int64_t ticks);
 void timer_msleep (int64_t milliseconds);
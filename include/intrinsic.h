@@ -119,6 +119,98 @@ static __inline uint64_t rcr2(void) {
 	return val;
 }
 
+/* Reads the CPU's time-stamp counter, which counts clock cycles
+   since reset.  See [IA32-v2b] "RDTSC". */
+__attribute__((always_inline))
+static __inline uint64_t rdtsc(void) {
+	uint32_t lo, hi;
+	__asm __volatile("rdtsc" : "=a" (lo), "=d" (hi));
+	return ((uint64_t) hi << 32) | lo;
+}
+
+__attribute__((always_inline))
+static __inline uint64_t rcr4(void) {
+	uint64_t val;
+	__asm __volatile("movq %%cr4,%0" : "=r" (val));
+	return val;
+}
+
+__attribute__((always_inline))
+static __inline void lcr4(uint64_t val) {
+	__asm __volatile("movq %0, %%cr4" : : "r" (val) : "memory");
+}
+
+/* Stores the EAX, EBX, ECX and EDX results of CPUID leaf LEAF,
+   subleaf SUBLEAF, into REGS[0] through REGS[3]. */
+__attribute__((always_inline))
+static __inline void cpuid(uint32_t leaf, uint32_t subleaf, uint32_t regs[4]) {
+	__asm __volatile("cpuid"
+			: "=a" (regs[0]), "=b" (regs[1]), "=c" (regs[2]), "=d" (regs[3])
+			: "a" (leaf), "c" (subleaf));
+}
+
+/* Invalidates TLB entries as TYPE says, for the process-context
+   identifier PCID and, for type 0, linear address ADDR.  See
+   [IA32-v2a] "INVPCID". */
+__attribute__((always_inline))
+static __inline void invpcid(uint64_t type, uint64_t pcid, uint64_t addr) {
+	struct { uint64_t pcid, addr; } desc = { pcid, addr };
+	__asm __volatile("invpcid %0, %1" : : "m" (desc), "r" (type) : "memory");
+}
+
+__attribute__((always_inline))
+static __inline uint64_t rcr0(void) {
+	uint64_t val;
+	__asm __volatile("movq %%cr0,%0" : "=r" (val));
+	return val;
+}
+
+__attribute__((always_inline))
+static __inline void lcr0(uint64_t val) {
+	__asm __volatile("movq %0, %%cr0" : : "r" (val) : "memory");
+}
+
+/* Clears CR0.TS, so that FPU instructions no longer raise #NM. */
+__attribute__((always_inline))
+static __inline void clts(void) {
+	__asm __volatile("clts" : : : "memory");
+}
+
+/* Writes VAL to extended control register XCR.  See [IA32-v2b]
+   "XSETBV". */
+__attribute__((always_inline))
+static __inline void xsetbv(uint32_t xcr, uint64_t val) {
+	__asm __volatile("xsetbv"
+			: : "c" (xcr), "a" ((uint32_t) val), "d" ((uint32_t) (val >> 32)));
+}
+
+/* Save and restore x87/SSE state at AREA, which must be 16-byte
+   aligned for FXSAVE and 64-byte aligned for XSAVE.  XSAVE and
+   XRSTOR handle the state components in MASK. */
+__attribute__((always_inline))
+static __inline void fxsave(void *area) {
+	__asm __volatile("fxsave64 %0" : "=m" (*(char (*)[512]) area));
+}
+
+__attribute__((always_inline))
+static __inline void fxrstor(const void *area) {
+	__asm __volatile("fxrstor64 %0" : : "m" (*(const char (*)[512]) area));
+}
+
+__attribute__((always_inline))
+static __inline void xsave(void *area, uint64_t mask) {
+	__asm __volatile("xsave64 (%0)"
+			: : "r" (area), "a" ((uint32_t) mask), "d" ((uint32_t) (mask >> 32))
+			: "memory");
+}
+
+__attribute__((always_inline))
+static __inline void xrstor(const void *area, uint64_t mask) {
+	__asm __volatile("xrstor64 (%0)"
+			: : "r" (area), "a" ((uint32_t) mask), "d" ((uint32_t) (mask >> 32))
+			: "memory");
+}
+
 __attribute__((always_inline))
 static __inline void write_msr(uint32_t ecx, uint64_t val) {
 	uint32_t edx, eax;
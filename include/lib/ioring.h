@@ -0,0 +1,66 @@
+#ifndef __LIB_IORING_H
+#define __LIB_IORING_H
+
+#include <stdint.h>
+
+/* A submission/completion ring for batched file I/O, shared
+   between a user process and the kernel.
+
+   The process asks for the ring with ioring_setup(), which maps
+   one page holding a struct io_ring at the address it names.  To
+   queue operations, it fills in sqes[sq_tail % IORING_ENTRIES]
+   and advances sq_tail, as many times as it likes.  A single
+   ioring_enter() then performs them in order, advancing sq_head
+   past each one and posting a completion at cq_tail.  The process
+   reads completions from cq_head and advances it.
+
+   All four indexes run freely and wrap at 2**32.  Each is written
+   only by its owner: sq_tail and cq_head by the process, sq_head
+   and cq_tail by the kernel.  ioring_enter() stops early if the
+   completion queue fills up. */
+
+#define IORING_ENTRIES 64       /* Entries per queue; a power of 2. */
+
+/* Operations.  Each does what the system call of the same name
+   does, including killing the process for a bad pointer, and its
+   return value becomes the completion's RES. */
+enum {
+	IORING_OP_NOP,              /* Nothing; RES is 0. */
+	IORING_OP_OPEN,             /* open (ADDR). */
+	IORING_OP_CLOSE,            /* close (FD). */
+	IORING_OP_READ,             /* read (FD, ADDR, LEN). */
+	IORING_OP_WRITE,            /* write (FD, ADDR, LEN). */
+	IORING_OP_PREAD,            /* pread (FD, ADDR, LEN, OFF). */
+	IORING_OP_PWRITE,           /* pwrite (FD, ADDR, LEN, OFF). */
+	IORING_OP_SEEK,             /* seek (FD, OFF). */
+};
+
+/* A submission queue entry. */
+struct io_sqe {
+	uint8_t op;                 /* IORING_OP_*. */
+	uint8_t reserved[3];        /* Zero. */
+	int32_t fd;                 /* File descriptor. */
+	uint64_t addr;              /* Buffer or file name. */
+	uint32_t len;               /* Buffer length. */
+	int32_t off;                /* File offset. */
+	uint64_t user_data;         /* Passed through to the completion. */
+};
+
+/* A completion queue entry. */
+struct io_cqe {
+	uint64_t user_data;         /* From the submission. */
+	int64_t res;                /* Result of the operation. */
+};
+
+/* The shared page. */
+struct io_ring {
+	uint32_t sq_head;           /* Next submission the kernel takes. */
+	uint32_t sq_tail;           /* Next submission slot to fill. */
+	uint32_t cq_head;           /* Next completion to read. */
+	uint32_t cq_tail;           /* Next completion slot the kernel fills. */
+	uint8_t reserved[48];       /* Zero. */
+	struct io_sqe sqes[IORING_ENTRIES];
+	struct io_cqe cqes[IORING_ENTRIES];
+};
+
+#endif /* lib/ioring.h */
@@ -0,0 +1,15 @@
+#ifndef __LIB_IOVEC_H
+#define __LIB_IOVEC_H
+
+#include <stddef.h>
+
+/* One buffer of a vectored readv() or writev(). */
+struct iovec {
+	void *iov_base;             /* Start of the buffer. */
+	size_t iov_len;             /* Length of the buffer in bytes. */
+};
+
+/* Most buffers a single readv() or writev() accepts. */
+#define IOV_MAX 64
+
+#endif /* lib/iovec.h */
@@ -0,0 +1,36 @@
+#ifndef __LIB_KERNEL_HISTOGRAM_H
+#define __LIB_KERNEL_HISTOGRAM_H
+
+#include <stdint.h>
+
+/* Histogram of 64-bit samples, such as latencies in TSC cycles.
+
+   Values below 8 have a bucket each.  Above that, each power of
+   2 is split into 8 buckets, so a percentile read back from the
+   histogram is within 12.5% of the true value, whatever the
+   range of the samples.  Adding a sample takes constant time and
+   no memory beyond the fixed array, so it may be done in an
+   interrupt handler or with interrupts off.  A histogram that
+   several CPUs add to without a lock must use
+   histogram_add_atomic() instead of histogram_add(). */
+
+#define HISTOGRAM_SUB_BITS 3
+#define HISTOGRAM_SUB (1 << HISTOGRAM_SUB_BITS)
+#define HISTOGRAM_BUCKETS \
+	(HISTOGRAM_SUB + (64 - HISTOGRAM_SUB_BITS) * HISTOGRAM_SUB)
+
+struct histogram {
+	uint64_t cnt;                       /* Number of samples. */
+	uint64_t sum;                       /* Sum of samples. */
+	uint64_t min;                       /* Smallest sample. */
+	uint64_t max;                       /* Largest sample. */
+	uint32_t buckets[HISTOGRAM_BUCKETS];
+};
+
+void histogram_init (struct histogram *);
+void histogram_add (struct histogram *, uint64_t value);
+void histogram_add_atomic (struct histogram *, uint64_t value);
+uint64_t histogram_percentile (const struct histogram *, unsigned permille);
+uint64_t histogram_mean (const struct histogram *);
+
+#endif /* lib/kernel/histogram.h */
@@ -36,6 +36,28 @@ enum {
 
 	SYS_MOUNT,
 	SYS_UMOUNT,
+
+	/* Diagnostics. */
+	SYS_TRACE_READ,             /* Copy out the scheduler trace. */
+
+	/* Vectored, positional and in-kernel I/O. */
+	SYS_READV,                  /* Read into several buffers. */
+	SYS_WRITEV,                 /* Write from several buffers. */
+	SYS_PREAD,                  /* Read at a given file offset. */
+	SYS_PWRITE,                 /* Write at a given file offset. */
+	SYS_COPY_FILE_RANGE,        /* Copy between files in the kernel. */
+
+	/* Diagnostics, continued. */
+	SYS_SYSCALL_STATS,          /* Copy out per-syscall statistics. */
+
+	/* Batched I/O. */
+	SYS_IORING_SETUP,           /* Map a submission/completion ring. */
+	SYS_IORING_ENTER,           /* Perform queued operations. */
+
+	/* Extra process calls. */
+	SYS_GETPID,                 /* Return the caller's pid. */
+	SYS_SPAWN,                  /* Start a new process from a file. */
+	SYS_YIELD,                  /* Let another process run. */
 };
 
 #endif /* lib/syscall-nr.h */
@@ -0,0 +1,18 @@
+#ifndef __LIB_SYSCALL_STAT_H
+#define __LIB_SYSCALL_STAT_H
+
+#include <stdint.h>
+
+/* Counts and latencies of one system call, as handed out by
+   syscall_stats().  Latencies are in TSC cycles from entry to the
+   kernel's handler to its return, taken over the calls that have
+   returned; exit() and a successful exec() never do. */
+struct syscall_stat {
+	uint64_t cnt;               /* Times invoked. */
+	uint64_t mean;              /* Mean latency. */
+	uint64_t p50;               /* Median latency. */
+	uint64_t p99;               /* 99th percentile latency. */
+	uint64_t max;               /* Largest latency. */
+};
+
+#endif /* lib/syscall-stat.h */
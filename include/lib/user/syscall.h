@@ -4,6 +4,9 @@
 #include <stdbool.h>
 #include <debug.h>
 #include <stddef.h>
+#include <iovec.h>
+#include <syscall-stat.h>
+#include <ioring.h>
 
 /* Process identifier. */
 typedef int pid_t;
@@ -26,6 +29,9 @@ void exit (int status) NO_RETURN;
 pid_t fork (const char *thread_name);
 int exec (const char *file);
 int wait (pid_t);
+pid_t getpid (void);
+pid_t spawn (const char *file, char *const argv[]);
+void yield (void);
 bool create (const char *file, unsigned initial_size);
 bool remove (const char *file);
 int open (const char *file);
@@ -38,6 +44,16 @@ void close (int fd);
 
 int dup2(int oldfd, int newfd);
 
+int readv (int fd, const struct iovec *iov, int iovcnt);
+int writev (int fd, const struct iovec *iov, int iovcnt);
+int pread (int fd, void *buffer, unsigned length, off_t offset);
+int pwrite (int fd, const void *buffer, unsigned length, off_t offset);
+int copy_file_range (int fd_in, int fd_out, unsigned length);
+
+/* Batched I/O; see lib/ioring.h. */
+struct io_ring *ioring_setup (void *addr);
+int ioring_enter (unsigned to_submit);
+
 /* Project 3 and optionally project 4. */
 void *mmap (void *addr, size_t length, int writable, int fd, off_t offset);
 void munmap (void *addr);
@@ -50,6 +66,10 @@ bool isdir (int fd);
 int inumber (int fd);
 int symlink (const char* target, const char* linkpath);
 
+/* Diagnostics. */
+int trace_read (void *buffer, unsigned size);
+int syscall_stats (struct syscall_stat *stats, int cnt);
+
 static inline void* get_phys_addr (void *user_addr) {
 	void* pa;
 	asm volatile ("movq %0, %%rax" ::"r"(user_addr));
@@ -0,0 +1,76 @@
+#ifndef THREADS_CPU_H
+#define THREADS_CPU_H
+
+/* Most CPUs the kernel will bring up. */
+#define CPU_MAX 16
+
+/* Offsets of struct cpu members used by userprog/syscall-entry.S,
+   which finds the running CPU's struct cpu through %gs. */
+#define CPU_TSS 0
+#define CPU_SCRATCH 8
+
+#ifndef __ASSEMBLER__
+#include <list.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "threads/synch.h"
+
+/* A CPU.  cpus[0] is the bootstrap processor (BSP), which runs
+   main(); the rest are application processors (APs) started by
+   smp_init().  Each thread records the CPU whose run queue it
+   belongs to in its `cpu' member, so cpu_current() is the
+   `cpu' of the running thread. */
+struct cpu {
+	/* At CPU_TSS and CPU_SCRATCH, for userprog/syscall-entry.S. */
+	struct task_state *tss;             /* Task-state segment (userprog/tss.c). */
+	uint64_t syscall_scratch[2];        /* Saved registers on system call entry. */
+
+	/* Owned by cpu.c. */
+	unsigned id;                        /* Index in cpus[]. */
+	uint8_t apic_id;                    /* Local APIC ID. */
+	volatile bool online;               /* Running the scheduler? */
+
+	/* Owned by thread.c. */
+	struct thread *running;             /* Thread running on this CPU. */
+	struct thread *idle_thread;         /* Runs when ready_list is empty. */
+	struct spinlock rq_lock;            /* Protects ready_list. */
+	struct list ready_list;             /* THREAD_READY threads, by priority. */
+	struct list destruction_req;        /* Dead threads to free. */
+	unsigned slice_ticks;               /* Timer ticks since last yield. */
+	long long idle_ticks;               /* Timer ticks spent idle. */
+	long long kernel_ticks;             /* Timer ticks in kernel threads. */
+	long long user_ticks;               /* Timer ticks in user programs. */
+	uint64_t idle_cycles;               /* TSC cycles spent idle. */
+	uint64_t kernel_cycles;             /* TSC cycles in kernel threads. */
+	uint64_t user_cycles;               /* TSC cycles in user programs. */
+	unsigned balance_ticks;             /* Timer ticks since balancing. */
+	bool wake_pending;                  /* Sent an IPI it has not acted on? */
+	long long steal_cnt;                /* Threads stolen from other CPUs. */
+
+	/* Owned by threads/fpu.c. */
+	struct thread *fpu_owner;           /* Thread whose FPU state is loaded. */
+	bool fpu_ts;                        /* CR0.TS is set? */
+
+	/* Owned by devices/timer.c. */
+	uint64_t timer_deadline;            /* Local APIC timer due, in ns. */
+	uint64_t tick_deadline;             /* Next tick, on an AP, in ns. */
+
+	/* Owned by interrupt.c. */
+	bool in_external_intr;              /* Processing an external interrupt? */
+	bool yield_on_return;               /* Yield on interrupt return? */
+	uint64_t off_tsc;                   /* TSC when interrupts went off. */
+	void *off_from;                     /* Where they went off, or null. */
+};
+
+extern struct cpu cpus[CPU_MAX];
+extern unsigned cpu_cnt;
+
+/* -no-smp: Leave the application processors halted? */
+extern bool smp_disabled;
+
+struct cpu *cpu_init_bsp (void);
+struct cpu *cpu_current (void);
+void smp_init (void);
+#endif /* __ASSEMBLER__ */
+
+#endif /* threads/cpu.h */
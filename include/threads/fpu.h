@@ -0,0 +1,17 @@
+#ifndef THREADS_FPU_H
+#define THREADS_FPU_H
+
+#include <stdbool.h>
+
+struct thread;
+
+void fpu_init (void);
+void fpu_init_ap (void);
+void fpu_switch (struct thread *next);
+bool fpu_loaded (const struct thread *);
+void fpu_flush (void);
+bool fpu_fork (struct thread *parent);
+void fpu_reset (void);
+void fpu_print_stats (void);
+
+#endif /* threads/fpu.h */
@@ -2,15 +2,38 @@
 #define THREAD_MMU_H
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 #include "threads/pte.h"
 
 typedef bool pte_for_each_func (uint64_t *pte, void *va, void *aux);
 
+/* The page table that served the last lookup in pml4e_walk(), so
+   that the next lookup in the same 2 MB region, as in a loop over
+   consecutive pages, need not walk down from the root.  Each
+   thread has one. */
+struct pde_cache {
+	uint64_t *pml4;             /* Page map level 4 it belongs to. */
+	uint64_t va;                /* Start of the 2 MB region. */
+	uint64_t *pt;               /* Page table for the region. */
+	unsigned gen;               /* Page tables freed before caching. */
+};
+
+/* -no-pcid: Flush the whole TLB on every address space switch? */
+extern bool mmu_no_pcid;
+
+void mmu_init (void);
+
 uint64_t *pml4e_walk (uint64_t *pml4, const uint64_t va, int create);
 uint64_t *pml4_create (void);
 bool pml4_for_each (uint64_t *, pte_for_each_func *, void *);
+bool pml4_for_each_range (uint64_t *, const void *start, const void *end,
+		pte_for_each_func *, void *);
 void pml4_destroy (uint64_t *pml4);
+void pml4_destroy_deferred (uint64_t *pml4);
+bool pml4_reclaim (bool user);
+void pml4_reaper_init (void);
+void *mmu_map_device (uint64_t pa, size_t size);
 void pml4_activate (uint64_t *pml4);
 void *pml4_get_page (uint64_t *pml4, const void *upage);
 bool pml4_set_page (uint64_t *pml4, void *upage, void *kpage, bool rw);
@@ -19,6 +42,9 @@ bool pml4_is_dirty (uint64_t *pml4, const void *upage);
 void pml4_set_dirty (uint64_t *pml4, const void *upage, bool dirty);
 bool pml4_is_accessed (uint64_t *pml4, const void *upage);
 void pml4_set_accessed (uint64_t *pml4, const void *upage, bool accessed);
+size_t pml4_clear_range (uint64_t *pml4, const void *start, const void *end);
+uint64_t pml4_clear_accessed_range (uint64_t *pml4, const void *upage,
+		size_t page_cnt);
 
 #define is_writable(pte) (*(pte) & PTE_W)
 #define is_user_pte(pte) (*(pte) & PTE_U)
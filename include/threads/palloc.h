@@ -8,7 +8,8 @@
 enum palloc_flags {
 	PAL_ASSERT = 001,           /* Panic on failure. */
 	PAL_ZERO = 002,             /* Zero page contents. */
-	PAL_USER = 004              /* User page. */
+	PAL_USER = 004,             /* User page. */
+	PAL_NORECLAIM = 010         /* Fail rather than reclaim page tables. */
 };
 
 /* Maximum number of pages to put in user pool. */
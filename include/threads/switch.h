@@ -0,0 +1,36 @@
+#ifndef THREADS_SWITCH_H
+#define THREADS_SWITCH_H
+
+#ifndef __ASSEMBLER__
+#include <stdint.h>
+
+struct thread;
+
+/* switch_to()'s stack frame: the callee-saved registers of the
+   System V ABI, in the order switch_to() pops them, and the
+   address it returns to. */
+struct switch_frame {
+	uint64_t r15;
+	uint64_t r14;
+	uint64_t r13;
+	uint64_t r12;
+	uint64_t rbx;
+	uint64_t rbp;
+	void (*rip) (void);         /* Return address. */
+};
+
+/* Saves the running thread CUR's callee-saved registers and stack
+   pointer, and resumes NEXT where it last called switch_to().
+   Everything else the C calling convention already assumes is
+   clobbered by a call, so a kernel-to-kernel switch need not
+   save it.  Must be called with interrupts off.  Returns, once
+   CUR runs again, the thread that switched back to it. */
+struct thread *switch_to (struct thread *cur, struct thread *next);
+
+/* Where a new thread's first switch_to() returns.  Calls
+   thread_schedule_tail() on the thread it switched from, then
+   rbx (r12, r13), which must not return. */
+void switch_entry (void);
+#endif
+
+#endif /* threads/switch.h */
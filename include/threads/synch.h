@@ -7,10 +7,28 @@
 
 bool sema_cmp_priority (const struct list_elem *,const struct list_elem *,void *);
 
+/* Spinlock, for data shared between CPUs that a sleeping lock
+   cannot protect, such as run queues.  Its holder busy-waits, so
+   it must be held only briefly, and only with interrupts off,
+   which keeps the holder from being preempted or interrupted by
+   code on the same CPU that wants it too.  A CPU that needs more
+   than one takes them in order: a semaphore's or a reader-writer
+   lock's, then donate_lock (thread.c), then a run queue's. */
+struct spinlock {
+	int locked;                 /* Nonzero while held. */
+	struct cpu *holder;         /* CPU holding it (for debugging). */
+};
+
+void spinlock_init (struct spinlock *);
+void spinlock_acquire (struct spinlock *);
+void spinlock_release (struct spinlock *);
+bool spinlock_held_by_current_cpu (const struct spinlock *);
+
 /* A counting semaphore. */
 struct semaphore {
 	unsigned value;             /* Current value. */
 	struct list waiters;        /* List of waiting threads. */
+	struct spinlock lock;       /* Protects the members above. */
 };
 
 void sema_init (struct semaphore *, unsigned value);
@@ -23,6 +41,8 @@ void sema_self_test (void);
 struct lock {
 	struct thread *holder;      /* Thread holding lock (for debugging). */
 	struct semaphore semaphore; /* Binary semaphore controlling access. */
+	struct list_elem elem;      /* Element in holder's `locks'. */
+	int max_priority;           /* Highest priority among waiters. */
 };
 
 void lock_init (struct lock *);
@@ -30,6 +50,35 @@ void lock_acquire (struct lock *);
 bool lock_try_acquire (struct lock *);
 void lock_release (struct lock *);
 bool lock_held_by_current_thread (const struct lock *);
+void lock_acquire_adaptive (struct lock *);
+
+/* One read hold on a reader-writer lock.  Each thread embeds a
+   few of these, so that a writer waiting for readers to drain
+   can find every reader and donate its priority to them. */
+struct rwlock_reader {
+	struct rwlock *rwlock;      /* Read-held lock, or NULL if free. */
+	struct thread *thread;      /* Thread holding the read lock. */
+	struct list_elem elem;      /* Element in rwlock's `readers'. */
+};
+
+/* Maximum number of read locks a thread may hold at once. */
+#define RWLOCK_READ_MAX 4
+
+/* Reader-writer lock. */
+struct rwlock {
+	struct lock writer_lock;    /* Held by the (waiting) writer. */
+	struct semaphore drained;   /* Upped when the last reader leaves. */
+	struct list readers;        /* Active read holds. */
+	bool draining;              /* Writer is waiting for readers? */
+	struct spinlock lock;       /* Protects readers and draining. */
+};
+
+void rwlock_init (struct rwlock *);
+void rwlock_acquire_read (struct rwlock *);
+void rwlock_release_read (struct rwlock *);
+void rwlock_acquire_write (struct rwlock *);
+void rwlock_release_write (struct rwlock *);
+bool rwlock_held_by_current_thread (const struct rwlock *);
 
 /* Condition variable. */
 struct condition {
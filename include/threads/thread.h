@@ -5,10 +5,14 @@
 #include <list.h>
 #include <stdint.h>
 #include "threads/interrupt.h"
+#include "threads/mmu.h"
 #include "threads/synch.h"
 #ifdef VM
 #include "vm/vm.h"
 #endif
+#ifdef USERPROG
+#include "userprog/fdtable.h"
+#endif
 
 
 /* States in a thread's life cycle. : 쓰레드의 상태*/
@@ -54,7 +58,7 @@ typedef int tid_t;
  *           |                                 |
  *           +---------------------------------+
  *           |              magic              |
- *           |            intr_frame           |
+ *           |              stack              |
  *           |                :                |
  *           |                :                |
  *           |               name              |
@@ -102,11 +106,11 @@ struct thread {
 	int64_t awake;                      /* 본인 잠들 시간 저장용 */
 
 	struct lock *wait_on_lock;           /* 기다리는 lock */
-	struct list donations;              /* Priority 기부 해줄 리스트*/
+	struct list locks;                  /* Locks held, for donation. */
+	struct rwlock_reader rw_reads[RWLOCK_READ_MAX]; /* Read-held rwlocks. */
 	/* Shared between thread.c and synch.c. */
 	struct list_elem all_elem;   
 	struct list_elem elem;              /* List element. */
-	struct list_elem d_elem;            /* donations list_element */
 
 	// for advanced scheduler.
 	int nice;							/* niceness of thread for adjusting pri. */
@@ -124,23 +128,38 @@ struct thread {
 
 	struct intr_frame parent_if;        /* fork과정에서 유저 영역 값 저장용*/ 
 
-	struct file **fdt;                  /* file descriptor table: file구조체의 포인터로 구성 최대사이즈 64 */
-	int fd_index;                       /* fdt의 오픈 지점 인덱스 */
-
-	struct file *runn_file;               /* 현재 실행 중인 프로세스가 실행 중인 파일*/
+	struct exec_image *exec_image;      /* Executable being run, or null. */
 	
 
 #ifdef USERPROG //만약 USERPROG매크로가 정의되있다면
 	/* Owned by userprog/process.c. */
 	uint64_t *pml4;                     /* Page map level 4 */
+	struct fd_table fdt;                /* File descriptor table. */
+	struct io_ring *ioring;             /* Batched I/O ring, or null. */
 #endif
 #ifdef VM
 	/* Table for whole virtual memory owned by thread. */
 	struct supplemental_page_table spt;
 #endif
 
+	/* Owned by thread.c, for accounting (see trace.c). */
+	uint64_t run_cycles;                /* TSC cycles spent running. */
+	uint64_t ready_cycles;              /* TSC cycles spent ready to run. */
+	uint64_t blocked_cycles;            /* TSC cycles spent blocked. */
+	uint64_t state_tsc;                 /* TSC at last status change. */
+
+	/* Owned by threads/fpu.c. */
+	void *fpu_state;                    /* Saved FPU registers, or null. */
+
+	/* Owned by threads/mmu.c. */
+	struct pde_cache pde_cache;         /* Last page table walked to. */
+
 	/* Owned by thread.c. */
-	struct intr_frame tf;               /* Information for switching : 재개를 위해? */
+	struct cpu *cpu;                    /* CPU whose run queue it is on. */
+	struct cpu *last_cpu;               /* CPU it last ran on, or null. */
+	bool on_cpu;                        /* Running, or still switching away? */
+	uint64_t last_ran;                  /* TSC when it last stopped running. */
+	uint8_t *stack;                     /* Saved stack pointer while switched out. */
 	unsigned magic;                     /* Detects stack overflow. : thread_current()가 현재 스레드내 magic멤버가 THREAD_MAGIC인지 확인한다.*/
 };
 
@@ -150,18 +169,21 @@ struct thread {
 extern bool thread_mlfqs;
 int load_avg;
 
-void remove_donation(struct lock *);
+extern struct spinlock donate_lock;
+
 bool cmp_priority (const struct list_elem *,const struct list_elem *,void *);
-bool cmp_donation_priority (const struct list_elem *,const struct list_elem *,void *);
 void thread_compare_priority(void);
-void priority_donation(void);
 void re_priority(void);
+void thread_donate_priority (struct thread *, int priority);
 
 void thread_sleep(int64_t);
 void thread_awake(int64_t);
 
 void thread_init (void);
 void thread_start (void);
+struct thread *thread_create_idle (struct cpu *);
+void thread_start_ap (void) NO_RETURN;
+void thread_tick_ap (void);
 
 void thread_tick (void);
 void thread_print_stats (void);
@@ -170,7 +192,9 @@ typedef void thread_func (void *aux);
 tid_t thread_create (const char *name, int priority, thread_func *, void *);
 
 void thread_block (void);
+void thread_block_unlock (struct spinlock *);
 void thread_unblock (struct thread *);
+void thread_schedule_tail (struct thread *prev);
 
 struct thread *thread_current (void);
 tid_t thread_tid (void);
@@ -196,7 +220,3 @@ void calculate_load_avg (void);
 void recalculate_recent_cpu (void);
 void recalculate_priority (void);
 #endif /* threads/thread.h */
-
-//project 2
-#define FDT_PAGES 3 
-#define FDCOUNT_LIMIT FDT_PAGES *(1 << 9)
@@ -0,0 +1,52 @@
+#ifndef THREADS_TRACE_H
+#define THREADS_TRACE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+struct thread;
+
+/* Kinds of scheduler trace events. */
+enum trace_type {
+	TRACE_SWITCH,               /* TID starts running; OTHER stopped with
+	                               status ARG. */
+	TRACE_WAKEUP,               /* TID made ready by OTHER (0: interrupt). */
+	TRACE_DONATE,               /* TID raised to priority ARG by OTHER. */
+	TRACE_BLOCK,                /* TID about to block for reason ARG. */
+	TRACE_EXIT,                 /* TID exiting. */
+};
+
+/* Number of events kept in the ring.  Must be a power of 2. */
+#define TRACE_SIZE 2048
+
+/* Why a thread blocked, the ARG of a TRACE_BLOCK event. */
+enum trace_reason {
+	TRACE_WAIT_SEMA,            /* sema_down(). */
+	TRACE_WAIT_LOCK,            /* lock_acquire(). */
+	TRACE_WAIT_SLEEP,           /* timer_sleep(). */
+	TRACE_WAIT_IO,              /* Waiting on an interrupt queue. */
+};
+
+/* One trace event, as stored in the ring and as handed out by
+   trace_copy() and dumped by trace_print_stats().  Thread ids
+   are truncated to their low 16 bits.  All fields are
+   little-endian; utils/pintos-trace decodes them. */
+struct trace_event {
+	uint64_t tsc;               /* Time-stamp counter. */
+	uint16_t tid;               /* Thread the event is about. */
+	uint16_t other;             /* Thread that caused it, or 0. */
+	uint8_t type;               /* A `enum trace_type'. */
+	uint8_t arg;                /* Depends on TYPE. */
+	uint16_t reserved;          /* Zero. */
+};
+
+/* -trace: Dump the trace buffer on shutdown? */
+extern bool trace_dump_on_exit;
+
+void trace_record (enum trace_type, const struct thread *, int arg,
+		const struct thread *other);
+size_t trace_copy (void *, size_t size);
+void trace_print_stats (void);
+
+#endif /* threads/trace.h */
@@ -0,0 +1,33 @@
+#ifndef USERPROG_FDTABLE_H
+#define USERPROG_FDTABLE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+struct file;
+
+/* Most file descriptors a process may have, including the
+   console's 0 and 1. */
+#define FD_MAX 1536
+
+/* A process's file descriptor table.  A zeroed fd_table is a
+   valid empty table; memory is allocated on the first open.
+
+   Descriptors 0 and 1 are the console.  They are always in use
+   but have no file, so fd_table_add() never returns them and
+   fd_table_get() returns a null pointer for them. */
+struct fd_table {
+	struct file **files;        /* Open files, indexed by fd. */
+	uint64_t *used;             /* Bit N set if fd N is in use. */
+	int size;                   /* Slots in FILES, a multiple of 64. */
+	int lo;                     /* No word of USED below this has
+	                               a clear bit. */
+};
+
+int fd_table_add (struct fd_table *, struct file *);
+struct file *fd_table_get (const struct fd_table *, int fd);
+bool fd_table_close (struct fd_table *, int fd);
+bool fd_table_copy (struct fd_table *dst, const struct fd_table *src);
+void fd_table_destroy (struct fd_table *);
+
+#endif /* userprog/fdtable.h */
@@ -1,11 +1,25 @@
 #ifndef USERPROG_PROCESS_H
 #define USERPROG_PROCESS_H
 
+#include <stddef.h>
 #include "threads/thread.h"
 
+/* A program's command-line arguments, packed back to back in a
+   buffer of just the right size, from which they are copied onto
+   the new process's stack in a single pass. */
+struct exec_args {
+	int argc;                   /* Number of arguments. */
+	size_t size;                /* Bytes in STRS. */
+	char strs[];                /* ARGC null-terminated strings. */
+};
+
+struct exec_args *exec_args_create (size_t size);
+void exec_args_split (struct exec_args *);
+
 tid_t process_create_initd (const char *file_name);
 tid_t process_fork (const char *name, struct intr_frame *if_);
-int process_exec (void *f_name);
+int process_exec (struct exec_args *args);
+tid_t process_spawn (const char *file, struct exec_args *args);
 int process_wait (tid_t);
 void process_exit (void);
 void process_activate (struct thread *next);
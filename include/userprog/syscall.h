@@ -4,6 +4,8 @@
 #include <stdbool.h>
 #include <debug.h>
 #include <stddef.h>
+#include <iovec.h>
+#include <syscall-stat.h>
 #include "filesys/filesys.h"
 #include "filesys/file.h"
 
@@ -23,13 +25,20 @@ typedef int off_t;
 #define EXIT_SUCCESS 0          /* Successful execution. */
 #define EXIT_FAILURE 1          /* Unsuccessful execution. */
 
-struct lock file_lock;
 void syscall_init (void);
+void syscall_init_ap (void);
+void syscall_print_stats (void);
+
+/* -no-fast-syscall: Use the full entry path for every call. */
+extern bool syscall_no_fast;
 
 void halt (void) NO_RETURN;
 void exit (int status) NO_RETURN;
 int exec (const char *file);
 int wait (pid_t);
+pid_t getpid (void);
+pid_t spawn (const char *file, char *const argv[]);
+void yield (void);
 bool create (const char *file, unsigned initial_size);
 bool remove (const char *file);
 int open (const char *file);
@@ -39,5 +48,14 @@ int write (int fd, const void *buffer, unsigned length);
 void seek (int fd, unsigned position);
 unsigned tell (int fd);
 void close (int fd);
+int readv (int fd, const struct iovec *iov, int iovcnt);
+int writev (int fd, const struct iovec *iov, int iovcnt);
+int pread (int fd, void *buffer, unsigned length, off_t offset);
+int pwrite (int fd, const void *buffer, unsigned length, off_t offset);
+int copy_file_range (int fd_in, int fd_out, unsigned length);
+void *ioring_setup (void *addr);
+int ioring_enter (unsigned to_submit);
+int trace_read (void *buffer, unsigned size);
+int syscall_stats (struct syscall_stat *stats, int cnt);
 
 #endif /* userprog/syscall.h */
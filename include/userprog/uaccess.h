@@ -0,0 +1,27 @@
+#ifndef USERPROG_UACCESS_H
+#define USERPROG_UACCESS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "threads/vaddr.h"
+
+/* Returns true if the SIZE bytes at UADDR lie entirely below
+   KERN_BASE.  This is all the checking a user pointer needs
+   before it is handed to the functions below: whether the pages
+   are actually mapped is found out by touching them. */
+static inline bool
+is_user_range (const void *uaddr, size_t size) {
+	uintptr_t start = (uintptr_t) uaddr;
+
+	return start + size >= start && start + size <= KERN_BASE;
+}
+
+bool copy_from_user (void *dst, const void *usrc, size_t size);
+bool copy_to_user (void *udst, const void *src, size_t size);
+int strncpy_from_user (char *dst, const char *usrc, size_t size);
+int strnlen_user (const char *usrc, size_t size);
+
+uintptr_t uaccess_fixup (uintptr_t rip);
+
+#endif /* userprog/uaccess.h */
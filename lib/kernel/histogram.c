@@ -0,0 +1,109 @@
+#include "histogram.h"
+#include <debug.h>
+#include <stdbool.h>
+#include <string.h>
+
+/* Returns the index of the bucket that VALUE falls in. */
+static unsigned
+bucket_of (uint64_t value) {
+	int msb;
+
+	if (value < HISTOGRAM_SUB)
+		return value;
+	msb = 63 - __builtin_clzll (value);
+	return HISTOGRAM_SUB + (msb - HISTOGRAM_SUB_BITS) * HISTOGRAM_SUB
+		+ ((value >> (msb - HISTOGRAM_SUB_BITS)) & (HISTOGRAM_SUB - 1));
+}
+
+/* Returns the largest value that falls in bucket IDX. */
+static uint64_t
+bucket_max (unsigned idx) {
+	unsigned shift, sub;
+
+	if (idx < HISTOGRAM_SUB)
+		return idx;
+	shift = (idx - HISTOGRAM_SUB) / HISTOGRAM_SUB;
+	sub = (idx - HISTOGRAM_SUB) % HISTOGRAM_SUB;
+	return ((uint64_t) (HISTOGRAM_SUB + sub + 1) << shift) - 1;
+}
+
+/* Initializes H as an empty histogram. */
+void
+histogram_init (struct histogram *h) {
+	ASSERT (h != NULL);
+
+	memset (h, 0, sizeof *h);
+	h->min = UINT64_MAX;
+}
+
+/* Adds VALUE to H. */
+void
+histogram_add (struct histogram *h, uint64_t value) {
+	h->cnt++;
+	h->sum += value;
+	if (value < h->min)
+		h->min = value;
+	if (value > h->max)
+		h->max = value;
+	h->buckets[bucket_of (value)]++;
+}
+
+/* Adds VALUE to H like histogram_add(), but with atomic
+   operations, so that any number of CPUs may add to H at once
+   with interrupts on.  A reader racing with it may see a sample
+   counted in CNT before it lands in its bucket. */
+void
+histogram_add_atomic (struct histogram *h, uint64_t value) {
+	uint64_t old;
+
+	__atomic_fetch_add (&h->cnt, 1, __ATOMIC_RELAXED);
+	__atomic_fetch_add (&h->sum, value, __ATOMIC_RELAXED);
+	old = __atomic_load_n (&h->min, __ATOMIC_RELAXED);
+	while (value < old && !__atomic_compare_exchange_n (&h->min, &old, value,
+				true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+		continue;
+	old = __atomic_load_n (&h->max, __ATOMIC_RELAXED);
+	while (value > old && !__atomic_compare_exchange_n (&h->max, &old, value,
+				true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+		continue;
+	__atomic_fetch_add (&h->buckets[bucket_of (value)], 1, __ATOMIC_RELAXED);
+}
+
+/* Returns the value below which PERMILLE thousandths of the
+   samples in H fall, e.g. the median for 500 and the 99.9th
+   percentile for 999.  The result is the top of the bucket the
+   percentile lands in, so it errs high, but never exceeds the
+   largest sample.  Returns 0 if H is empty. */
+uint64_t
+histogram_percentile (const struct histogram *h, unsigned permille) {
+	uint64_t rank, seen = 0;
+	unsigned i;
+
+	ASSERT (permille <= 1000);
+
+	if (h->cnt == 0)
+		return 0;
+
+	/* The 1-based rank of the sample we want, rounded up. */
+	rank = (h->cnt * permille + 999) / 1000;
+	if (rank == 0)
+		rank = 1;
+	for (i = 0; i < HISTOGRAM_BUCKETS; i++) {
+		seen += h->buckets[i];
+		if (seen >= rank) {
+			uint64_t v = bucket_max (i);
+			if (v > h->max)
+				v = h->max;
+			if (v < h->min)
+				v = h->min;
+			return v;
+		}
+	}
+	return h->max;
+}
+
+/* Returns the mean of the samples in H, or 0 if it is empty. */
+uint64_t
+histogram_mean (const struct histogram *h) {
+	return h->cnt != 0 ? h->sum / h->cnt : 0;
+}
@@ -54,7 +54,7 @@ static __inline int64_t syscall (uint64_t num_, uint64_t a1_, uint64_t a2_,
 			((uint64_t) ARG2), 0, 0, 0))
 
 #define syscall4(NUMBER, ARG0, ARG1, ARG2, ARG3) ( \
-		syscall(((uint64_t *) NUMBER), \
+		syscall(((uint64_t) NUMBER), \
 			((uint64_t) ARG0), \
 			((uint64_t) ARG1), \
 			((uint64_t) ARG2), \
@@ -95,6 +95,21 @@ wait (pid_t pid) {
 	return syscall1 (SYS_WAIT, pid);
 }
 
+pid_t
+getpid (void) {
+	return syscall0 (SYS_GETPID);
+}
+
+pid_t
+spawn (const char *file, char *const argv[]) {
+	return (pid_t) syscall2 (SYS_SPAWN, file, argv);
+}
+
+void
+yield (void) {
+	syscall0 (SYS_YIELD);
+}
+
 bool
 create (const char *file, unsigned initial_size) {
 	return syscall2 (SYS_CREATE, file, initial_size);
@@ -145,6 +160,31 @@ dup2 (int oldfd, int newfd){
 	return syscall2 (SYS_DUP2, oldfd, newfd);
 }
 
+int
+readv (int fd, const struct iovec *iov, int iovcnt) {
+	return syscall3 (SYS_READV, fd, iov, iovcnt);
+}
+
+int
+writev (int fd, const struct iovec *iov, int iovcnt) {
+	return syscall3 (SYS_WRITEV, fd, iov, iovcnt);
+}
+
+int
+pread (int fd, void *buffer, unsigned size, off_t offset) {
+	return syscall4 (SYS_PREAD, fd, buffer, size, offset);
+}
+
+int
+pwrite (int fd, const void *buffer, unsigned size, off_t offset) {
+	return syscall4 (SYS_PWRITE, fd, buffer, size, offset);
+}
+
+int
+copy_file_range (int fd_in, int fd_out, unsigned size) {
+	return syscall3 (SYS_COPY_FILE_RANGE, fd_in, fd_out, size);
+}
+
 void *
 mmap (void *addr, size_t length, int writable, int fd, off_t offset) {
 	return (void *) syscall5 (SYS_MMAP, addr, length, writable, fd, offset);
@@ -194,3 +234,23 @@ int
 umount (const char *path) {
 	return syscall1 (SYS_UMOUNT, path);
 }
+
+struct io_ring *
+ioring_setup (void *addr) {
+	return (struct io_ring *) syscall1 (SYS_IORING_SETUP, addr);
+}
+
+int
+ioring_enter (unsigned to_submit) {
+	return syscall1 (SYS_IORING_ENTER, to_submit);
+}
+
+int
+trace_read (void *buffer, unsigned size) {
+	return syscall2 (SYS_TRACE_READ, buffer, size);
+}
+
+int
+syscall_stats (struct syscall_stat *stats, int cnt) {
+	return syscall2 (SYS_SYSCALL_STATS, stats, cnt);
+}
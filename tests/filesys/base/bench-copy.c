@@ -0,0 +1,96 @@
+/* Measures copying one file to another, the way a test harness
+   or archiver does: first through a user buffer with read() and
+   write() in 512-byte and 4 kB chunks, then inside the kernel
+   with a single copy_file_range().  Each run copies the file
+   PASSES times, checks the copy, and prints the time it took in
+   TSC cycles and the system calls it made. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_SIZE 65536         /* Bytes in the source file. */
+#define PASSES 4                /* Copies per run. */
+
+static char data[FILE_SIZE];
+static char buf[FILE_SIZE];
+
+/* Copies FILE_SIZE bytes from IN to OUT with read() and write()
+   of CHUNK_SIZE bytes at a time, and returns the number of
+   system calls that took. */
+static int
+copy_rw (int in, int out, int chunk_size)
+{
+  static char chunk[4096];
+  int ofs;
+
+  for (ofs = 0; ofs < FILE_SIZE; ofs += chunk_size)
+    if (read (in, chunk, chunk_size) != chunk_size
+        || write (out, chunk, chunk_size) != chunk_size)
+      fail ("copy failed at offset %d", ofs);
+  return 2 * (FILE_SIZE / chunk_size);
+}
+
+/* Copies FILE_SIZE bytes from IN to OUT with copy_file_range(),
+   and returns the number of system calls that took. */
+static int
+copy_range (int in, int out, int chunk_size UNUSED)
+{
+  if (copy_file_range (in, out, FILE_SIZE) != FILE_SIZE)
+    fail ("copy_file_range() came up short");
+  return 1;
+}
+
+/* Copies "src" to "dst" PASSES times with COPY and reports. */
+static void
+run (const char *label, int (*copy) (int in, int out, int chunk_size),
+     int chunk_size)
+{
+  unsigned long long bytes = (unsigned long long) FILE_SIZE * PASSES;
+  unsigned long long cycles;
+  uint64_t start;
+  int in, out;
+  int calls = 0;
+  int i;
+
+  if ((in = open ("src")) < 2 || (out = open ("dst")) < 2)
+    fail ("open failed");
+  start = rdtsc ();
+  for (i = 0; i < PASSES; i++)
+    {
+      seek (in, 0);
+      seek (out, 0);
+      calls += copy (in, out, chunk_size);
+    }
+  cycles = rdtsc () - start;
+
+  seek (out, 0);
+  if (read (out, buf, FILE_SIZE) != FILE_SIZE)
+    fail ("%s: reading back \"dst\" failed", label);
+  compare_bytes (buf, data, FILE_SIZE, 0, "dst");
+  close (in);
+  close (out);
+
+  msg ("%s: %llu kB in %llu kcycles, %d syscalls (%llu bytes/kcycle)",
+       label, bytes / 1024, cycles / 1000, calls, bytes * 1000 / cycles);
+}
+
+void
+test_main (void)
+{
+  int fd;
+  int i;
+
+  for (i = 0; i < FILE_SIZE; i++)
+    data[i] = i * 7 + i / 512;
+  if (!create ("src", FILE_SIZE) || !create ("dst", FILE_SIZE))
+    fail ("create failed");
+  if ((fd = open ("src")) < 2 || write (fd, data, FILE_SIZE) != FILE_SIZE)
+    fail ("writing \"src\" failed");
+  close (fd);
+
+  run ("read and write, 512 B chunks", copy_rw, 512);
+  run ("read and write, 4 kB chunks", copy_rw, 4096);
+  run ("copy_file_range", copy_range, 0);
+}
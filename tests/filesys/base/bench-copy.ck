@@ -0,0 +1,32 @@
+# -*- perl -*-
+
+# The expected output looks like this, with varying numbers:
+#
+# (bench-copy) begin
+# (bench-copy) read and write, 512 B chunks: 256 kB in 91234 kcycles, 1024 syscalls (2873 bytes/kcycle)
+# (bench-copy) read and write, 4 kB chunks: 256 kB in 81234 kcycles, 128 syscalls (3227 bytes/kcycle)
+# (bench-copy) copy_file_range: 256 kB in 51234 kcycles, 4 syscalls (5116 bytes/kcycle)
+# (bench-copy) end
+
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+
+common_checks ("run", @output);
+
+my (@core) = get_core_output ("run", @output);
+fail "Missing \"begin\".\n" if !grep (/\(bench-copy\) begin$/, @core);
+fail "Missing \"end\".\n" if !grep (/\(bench-copy\) end$/, @core);
+
+foreach my $run ('read and write, 512 B chunks',
+		 'read and write, 4 kB chunks', 'copy_file_range') {
+    my ($line) = grep (/^\(bench-copy\) \Q$run\E: /, @core);
+    fail "No measurement for \"$run\".\n" if !defined $line;
+    $line =~ /: 256 kB in \d+ kcycles, \d+ syscalls \(\d+ bytes\/kcycle\)$/
+      or fail "Malformed measurement: $line\n";
+}
+
+pass;
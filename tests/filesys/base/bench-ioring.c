@@ -0,0 +1,134 @@
+/* Measures writing and reading a file in 512-byte blocks, the
+   way the sm-seq-block and lg-seq-block tests do, first with one
+   write() or read() per block and then through a batched I/O
+   ring, queueing a full ring of blocks per ioring_enter().  Each
+   run prints the time it took in TSC cycles and the number of
+   kernel entries it made, as counted by syscall_stats(). */
+
+#include <string.h>
+#include <syscall.h>
+#include <syscall-nr.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_SIZE 65536         /* Bytes in the file. */
+#define BLOCK_SIZE 512          /* Bytes per operation. */
+#define BLOCK_CNT (FILE_SIZE / BLOCK_SIZE)
+#define PASSES 4                /* Times over the file per run. */
+#define RING_ADDR ((void *) 0x20000000)
+
+static char data[FILE_SIZE];
+static char buf[FILE_SIZE];
+static struct io_ring *ring;
+
+/* Writes or reads the file at FD block by block with write() or
+   read(). */
+static void
+rw_syscall (int fd, bool writing)
+{
+  int i;
+
+  seek (fd, 0);
+  for (i = 0; i < BLOCK_CNT; i++)
+    if (writing
+        ? write (fd, data + i * BLOCK_SIZE, BLOCK_SIZE) != BLOCK_SIZE
+        : read (fd, buf + i * BLOCK_SIZE, BLOCK_SIZE) != BLOCK_SIZE)
+      fail ("block %d failed", i);
+}
+
+/* Writes or reads the file at FD block by block through the
+   ring, IORING_ENTRIES blocks per ioring_enter(). */
+static void
+rw_ring (int fd, bool writing)
+{
+  int i, j;
+
+  seek (fd, 0);
+  for (i = 0; i < BLOCK_CNT; i += IORING_ENTRIES)
+    {
+      int cnt = BLOCK_CNT - i < IORING_ENTRIES ? BLOCK_CNT - i : IORING_ENTRIES;
+
+      for (j = 0; j < cnt; j++)
+        {
+          struct io_sqe *sqe = &ring->sqes[ring->sq_tail++ % IORING_ENTRIES];
+          char *block = (writing ? data : buf) + (i + j) * BLOCK_SIZE;
+
+          memset (sqe, 0, sizeof *sqe);
+          sqe->op = writing ? IORING_OP_WRITE : IORING_OP_READ;
+          sqe->fd = fd;
+          sqe->addr = (uintptr_t) block;
+          sqe->len = BLOCK_SIZE;
+          sqe->user_data = i + j;
+        }
+      if (ioring_enter (cnt) != cnt)
+        fail ("ioring_enter() came up short");
+      for (j = 0; j < cnt; j++)
+        {
+          struct io_cqe *cqe = &ring->cqes[ring->cq_head++ % IORING_ENTRIES];
+
+          if (cqe->user_data != (uint64_t) (i + j) || cqe->res != BLOCK_SIZE)
+            fail ("block %d failed", i + j);
+        }
+    }
+}
+
+/* Returns the number of system calls made so far. */
+static unsigned long long
+syscall_cnt (void)
+{
+  static struct syscall_stat stats[64];
+  unsigned long long total = 0;
+  int cnt, i;
+
+  cnt = syscall_stats (stats, 64);
+  if (cnt > 64)
+    cnt = 64;
+  for (i = 0; i < cnt; i++)
+    total += stats[i].cnt;
+  return total;
+}
+
+/* Runs RW over "data" PASSES times and reports. */
+static void
+run (const char *label, void (*rw) (int fd, bool writing), bool writing)
+{
+  unsigned long long bytes = (unsigned long long) FILE_SIZE * PASSES;
+  unsigned long long cycles, calls;
+  uint64_t start;
+  int fd;
+  int i;
+
+  if ((fd = open ("data")) < 2)
+    fail ("open failed");
+  memset (buf, 0, sizeof buf);
+  calls = syscall_cnt ();
+  start = rdtsc ();
+  for (i = 0; i < PASSES; i++)
+    rw (fd, writing);
+  cycles = rdtsc () - start;
+  calls = syscall_cnt () - calls - 1;
+  if (!writing)
+    compare_bytes (buf, data, FILE_SIZE, 0, "data");
+  close (fd);
+
+  msg ("%s: %llu kB in %llu kcycles, %llu syscalls (%llu bytes/kcycle)",
+       label, bytes / 1024, cycles / 1000, calls, bytes * 1000 / cycles);
+}
+
+void
+test_main (void)
+{
+  int i;
+
+  for (i = 0; i < FILE_SIZE; i++)
+    data[i] = i * 7 + i / 512;
+  if (!create ("data", FILE_SIZE))
+    fail ("create failed");
+  if ((ring = ioring_setup (RING_ADDR)) == NULL)
+    fail ("ioring_setup() failed");
+
+  run ("write, 512 B blocks", rw_syscall, true);
+  run ("ioring write, 512 B blocks", rw_ring, true);
+  run ("read, 512 B blocks", rw_syscall, false);
+  run ("ioring read, 512 B blocks", rw_ring, false);
+}
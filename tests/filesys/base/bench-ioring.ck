@@ -0,0 +1,40 @@
+# -*- perl -*-
+
+# The expected output looks like this, with varying numbers:
+#
+# (bench-ioring) begin
+# (bench-ioring) write, 512 B blocks: 256 kB in 91234 kcycles, 516 syscalls (2873 bytes/kcycle)
+# (bench-ioring) ioring write, 512 B blocks: 256 kB in 81234 kcycles, 12 syscalls (3227 bytes/kcycle)
+# (bench-ioring) read, 512 B blocks: 256 kB in 61234 kcycles, 516 syscalls (4281 bytes/kcycle)
+# (bench-ioring) ioring read, 512 B blocks: 256 kB in 51234 kcycles, 12 syscalls (5116 bytes/kcycle)
+# (bench-ioring) end
+
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+
+common_checks ("run", @output);
+
+my (@core) = get_core_output ("run", @output);
+fail "Missing \"begin\".\n" if !grep (/\(bench-ioring\) begin$/, @core);
+fail "Missing \"end\".\n" if !grep (/\(bench-ioring\) end$/, @core);
+
+# Each pass is a seek() plus one call per block, or one
+# ioring_enter() per 64 blocks.
+my (%calls) = ('write, 512 B blocks' => 516,
+	       'ioring write, 512 B blocks' => 12,
+	       'read, 512 B blocks' => 516,
+	       'ioring read, 512 B blocks' => 12);
+foreach my $run (sort keys %calls) {
+    my ($line) = grep (/^\(bench-ioring\) \Q$run\E: /, @core);
+    fail "No measurement for \"$run\".\n" if !defined $line;
+    my ($calls) = $line =~ /: 256 kB in \d+ kcycles, (\d+) syscalls \(\d+ bytes\/kcycle\)$/
+      or fail "Malformed measurement: $line\n";
+    fail "\"$run\" made $calls syscalls, expected $calls{$run}.\n"
+      if $calls != $calls{$run};
+}
+
+pass;
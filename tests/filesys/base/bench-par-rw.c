@@ -0,0 +1,99 @@
+/* Measures how file system throughput scales with the number of
+   processes using it at once.
+
+   Spawns 1, 2, 4 and 8 child processes that each read a file
+   from start to end several times, first each on a file of its
+   own and then all on the same file, and finally has the
+   readers share their file with a process that keeps
+   rewriting it.  Prints the aggregate throughput of each run in
+   bytes per thousand TSC cycles. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+#include "tests/filesys/base/bench-rw.h"
+
+static char buf[FILE_SIZE];
+
+static void
+file_name (char name[], int idx)
+{
+  snprintf (name, 16, "bench%d", idx);
+}
+
+/* Starts "child-bench-rw MODE FILE IDX" and returns its pid. */
+static pid_t
+spawn_child (char mode, int file, int idx)
+{
+  char cmd_line[64];
+  pid_t pid;
+
+  snprintf (cmd_line, sizeof cmd_line, "child-bench-rw %c %d %d",
+            mode, file, idx);
+  pid = fork ("child-bench-rw");
+  if (pid == 0)
+    exec (cmd_line);
+  if (pid == PID_ERROR)
+    fail ("fork for \"%s\" failed", cmd_line);
+  return pid;
+}
+
+/* Runs READER_CNT readers, on their own files or all on file 0
+   if SHARED, plus a writer on file 0 if WRITER, and reports the
+   time it took them all to finish. */
+static void
+run (const char *label, int reader_cnt, bool shared, bool writer)
+{
+  pid_t pids[FILE_CNT + 1];
+  int child_cnt = 0;
+  unsigned long long bytes, cycles;
+  uint64_t start;
+  int i;
+
+  start = rdtsc ();
+  for (i = 0; i < reader_cnt; i++)
+    pids[child_cnt++] = spawn_child ('r', shared ? 0 : i, i);
+  if (writer)
+    pids[child_cnt++] = spawn_child ('w', 0, reader_cnt);
+  for (i = 0; i < child_cnt; i++)
+    if (wait (pids[i]) != i)
+      fail ("%s: child %d failed", label, i);
+  cycles = rdtsc () - start;
+
+  bytes = (unsigned long long) child_cnt * FILE_SIZE * PASSES;
+  msg ("%s, %d readers%s: %llu kB in %llu kcycles (%llu bytes/kcycle)",
+       label, reader_cnt, writer ? " + 1 writer" : "", bytes / 1024,
+       cycles / 1000, bytes * 1000 / cycles);
+}
+
+void
+test_main (void)
+{
+  char name[16];
+  int i, n;
+
+  quiet = true;
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      int fd;
+
+      file_name (name, i);
+      for (n = 0; n < FILE_SIZE; n++)
+        buf[n] = bench_rw_byte (i, n);
+      if (!create (name, FILE_SIZE))
+        fail ("create \"%s\"", name);
+      if ((fd = open (name)) < 2)
+        fail ("open \"%s\"", name);
+      if (write (fd, buf, FILE_SIZE) != FILE_SIZE)
+        fail ("write \"%s\"", name);
+      close (fd);
+    }
+  quiet = false;
+
+  for (n = 1; n <= FILE_CNT; n *= 2)
+    run ("private files", n, false, false);
+  for (n = 1; n <= FILE_CNT; n *= 2)
+    run ("shared file", n, true, false);
+  run ("shared file", FILE_CNT / 2, true, true);
+}
@@ -0,0 +1,41 @@
+# -*- perl -*-
+
+# The expected output looks like this, with varying numbers:
+#
+# (bench-par-rw) begin
+# (bench-par-rw) private files, 1 readers: 64 kB in 51234 kcycles (1279 bytes/kcycle)
+# ...
+# (bench-par-rw) private files, 8 readers: 512 kB in ...
+# (bench-par-rw) shared file, 1 readers: 64 kB in ...
+# ...
+# (bench-par-rw) shared file, 8 readers: 512 kB in ...
+# (bench-par-rw) shared file, 4 readers + 1 writer: 320 kB in ...
+# (bench-par-rw) end
+
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+
+common_checks ("run", @output);
+
+my (@core) = get_core_output ("run", @output);
+fail "Missing \"begin\".\n" if !grep (/\(bench-par-rw\) begin$/, @core);
+fail "Missing \"end\".\n" if !grep (/\(bench-par-rw\) end$/, @core);
+
+my (@runs);
+foreach my $label ('private files', 'shared file') {
+    push (@runs, map ("$label, $_ readers", 1, 2, 4, 8));
+}
+push (@runs, "shared file, 4 readers \\+ 1 writer");
+
+foreach my $run (@runs) {
+    my ($line) = grep (/^\(bench-par-rw\) $run: /, @core);
+    fail "No measurement for \"$run\".\n" if !defined $line;
+    $line =~ /: \d+ kB in \d+ kcycles \(\d+ bytes\/kcycle\)$/
+      or fail "Malformed measurement: $line\n";
+}
+
+pass;
@@ -0,0 +1,18 @@
+#ifndef TESTS_FILESYS_BASE_BENCH_RW_H
+#define TESTS_FILESYS_BASE_BENCH_RW_H
+
+#define FILE_CNT 8              /* Files, one per private reader. */
+#define FILE_SIZE 16384         /* Bytes in each file. */
+#define CHUNK_SIZE 512          /* Bytes per read() or write(). */
+#define PASSES 4                /* Times each child goes over its file. */
+
+/* Byte expected at offset OFS in file IDX.  Each chunk is
+   uniform, so a reader that sees a chunk straddle two writes
+   notices. */
+static inline char
+bench_rw_byte (int idx, int ofs)
+{
+  return idx * 31 + ofs / CHUNK_SIZE;
+}
+
+#endif /* tests/filesys/base/bench-rw.h */
@@ -0,0 +1,58 @@
+/* Child process for bench-par-rw.
+   "child-bench-rw r FILE IDX" reads file FILE from start to end
+   PASSES times, checking its contents; "child-bench-rw w FILE
+   IDX" rewrites it with the same contents PASSES times.  Either
+   way, exits with IDX. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/filesys/base/bench-rw.h"
+
+const char *test_name = "child-bench-rw";
+
+static char buf[CHUNK_SIZE];
+
+int
+main (int argc, const char *argv[])
+{
+  char name[16];
+  bool writer;
+  int file, idx;
+  int fd, pass, ofs, i;
+
+  quiet = true;
+
+  CHECK (argc == 4, "argc must be 4, actually %d", argc);
+  writer = argv[1][0] == 'w';
+  file = atoi (argv[2]);
+  idx = atoi (argv[3]);
+
+  snprintf (name, sizeof name, "bench%d", file);
+  CHECK ((fd = open (name)) > 1, "open \"%s\"", name);
+  for (pass = 0; pass < PASSES; pass++)
+    {
+      seek (fd, 0);
+      for (ofs = 0; ofs < FILE_SIZE; ofs += CHUNK_SIZE)
+        if (writer)
+          {
+            for (i = 0; i < CHUNK_SIZE; i++)
+              buf[i] = bench_rw_byte (file, ofs);
+            if (write (fd, buf, CHUNK_SIZE) != CHUNK_SIZE)
+              fail ("write \"%s\" at %d", name, ofs);
+          }
+        else
+          {
+            if (read (fd, buf, CHUNK_SIZE) != CHUNK_SIZE)
+              fail ("read \"%s\" at %d", name, ofs);
+            for (i = 0; i < CHUNK_SIZE; i++)
+              if (buf[i] != bench_rw_byte (file, ofs))
+                fail ("\"%s\" byte %d is %d, expected %d", name, ofs + i,
+                      buf[i], bench_rw_byte (file, ofs));
+          }
+    }
+  close (fd);
+
+  return idx;
+}
@@ -0,0 +1,74 @@
+/* Measures console output throughput.
+
+   Writes the same BENCH_BYTES of filler text three ways: one
+   character at a time with putchar(), one line at a time with
+   printf(), and in big blocks with putbuf().  Every path ends
+   up in the serial transmit ring and the VGA text buffer; the
+   difference is how many times per byte it takes the console
+   lock and disables interrupts.
+
+   The TSC is calibrated against the timer first, so the rates
+   can be reported in bytes per second. */
+
+#include <stdio.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "devices/serial.h"
+#include "devices/timer.h"
+#include "intrinsic.h"
+
+#define BENCH_BYTES 16384       /* Bytes written per method. */
+#define LINE_LEN 64             /* Filler line length, with '\n'. */
+#define BLOCK_LEN 4096          /* Bytes per putbuf() call. */
+
+static char block[BLOCK_LEN];
+
+static void report (const char *name, uint64_t cycles,
+                    uint64_t cycles_per_sec);
+
+void
+test_bench_console (void)
+{
+  uint64_t cycles_per_sec;
+  uint64_t start;
+  int i;
+
+  /* Fill BLOCK with LINE_LEN-byte lines. */
+  for (i = 0; i < BLOCK_LEN; i++)
+    block[i] = i % LINE_LEN == LINE_LEN - 1 ? '\n' : '.';
+
+  start = rdtsc ();
+  timer_sleep (TIMER_FREQ / 10);
+  cycles_per_sec = (rdtsc () - start) * 10;
+
+  serial_flush ();
+  start = rdtsc ();
+  for (i = 0; i < BENCH_BYTES; i++)
+    putchar (block[i % BLOCK_LEN]);
+  serial_flush ();
+  report ("putchar", rdtsc () - start, cycles_per_sec);
+
+  start = rdtsc ();
+  for (i = 0; i < BENCH_BYTES / LINE_LEN; i++)
+    printf ("%.*s\n", LINE_LEN - 1, block);
+  serial_flush ();
+  report ("printf, one line", rdtsc () - start, cycles_per_sec);
+
+  start = rdtsc ();
+  for (i = 0; i < BENCH_BYTES / BLOCK_LEN; i++)
+    putbuf (block, BLOCK_LEN);
+  serial_flush ();
+  report ("putbuf, 4 kB", rdtsc () - start, cycles_per_sec);
+}
+
+/* Reports writing BENCH_BYTES in CYCLES. */
+static void
+report (const char *name, uint64_t cycles, uint64_t cycles_per_sec)
+{
+  if (cycles == 0)
+    cycles = 1;
+  msg ("%s: %d bytes, %llu cycles/byte (%llu bytes/s)",
+       name, BENCH_BYTES, cycles / BENCH_BYTES,
+       BENCH_BYTES * cycles_per_sec / cycles);
+}
@@ -0,0 +1,36 @@
+# -*- perl -*-
+
+# The expected output looks like this, with varying numbers and
+# lines of filler in between:
+#
+# (bench-console) begin
+# (bench-console) putchar: 16384 bytes, 5300 cycles/byte (377358 bytes/s)
+# (bench-console) printf, one line: 16384 bytes, 900 cycles/byte (2222222 bytes/s)
+# (bench-console) putbuf, 4 kB: 16384 bytes, 600 cycles/byte (3333333 bytes/s)
+# (bench-console) end
+
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+
+common_checks ("run", @output);
+
+my (@core) = get_core_output ("run", @output);
+fail "Missing \"begin\".\n" if !grep (/\(bench-console\) begin$/, @core);
+fail "Missing \"end\".\n" if !grep (/\(bench-console\) end$/, @core);
+
+foreach my $name ('putchar', 'printf, one line', 'putbuf, 4 kB') {
+    my ($line) = grep (/^\(bench-console\) \Q$name\E: /, @core);
+    fail "No $name measurement.\n" if !defined $line;
+    my ($bytes) = $line =~ /: (\d+) bytes, \d+ cycles\/byte \(\d+ bytes\/s\)$/
+      or fail "Malformed measurement: $line\n";
+    fail "Wrong byte count for $name: $bytes.\n" if $bytes != 16384;
+}
+
+my ($filler) = scalar (grep (/^\.{63}$/, @core));
+fail "Expected 768 lines of filler, got $filler.\n" if $filler != 768;
+
+pass;
@@ -0,0 +1,208 @@
+/* Measures the cost of the kernel's mutual exclusion primitives.
+
+   First, a single thread acquires and releases a plain lock, an
+   adaptive lock, and a reader-writer lock (in both modes) many
+   times, to measure the uncontended fast path in TSC cycles.
+
+   Then READER_CNT readers and WRITER_CNT writers contend for
+   each primitive in turn.  Each critical section sleeps for a
+   timer tick, standing in for disk I/O done under the lock, so
+   the total elapsed time shows how much the primitive lets the
+   readers overlap.  While they run, the threads check that no
+   reader ever shares the lock with a writer and that writers
+   are exclusive. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+#include "intrinsic.h"
+
+#define FAST_ITERS 10000        /* Uncontended acquire/release pairs. */
+#define READER_CNT 4            /* Contending reader threads. */
+#define WRITER_CNT 1            /* Contending writer threads. */
+#define ITERS 10                /* Critical sections per thread. */
+
+/* The primitive under test. */
+enum mode
+  {
+    MODE_LOCK,                  /* lock_acquire(). */
+    MODE_ADAPTIVE,              /* lock_acquire_adaptive(). */
+    MODE_RWLOCK,                /* rwlock_acquire_read/write(). */
+    MODE_CNT
+  };
+
+static const char *mode_names[MODE_CNT] = {"lock", "adaptive", "rwlock"};
+
+static enum mode mode;
+static struct lock lock;
+static struct rwlock rwlock;
+static struct semaphore done;
+
+/* Threads currently inside the critical section. */
+static int active_readers;
+static int active_writers;
+static int max_readers;
+
+static thread_func reader_func;
+static thread_func writer_func;
+
+static void measure_uncontended (void);
+static void measure_contended (enum mode);
+
+void
+test_bench_lock_contention (void)
+{
+  enum mode m;
+
+  lock_init (&lock);
+  rwlock_init (&rwlock);
+  sema_init (&done, 0);
+
+  measure_uncontended ();
+  for (m = 0; m < MODE_CNT; m++)
+    measure_contended (m);
+}
+
+static void
+measure_uncontended (void)
+{
+  uint64_t start;
+  int i;
+
+  start = rdtsc ();
+  for (i = 0; i < FAST_ITERS; i++)
+    {
+      lock_acquire (&lock);
+      lock_release (&lock);
+    }
+  msg ("uncontended lock: %llu cycles/op",
+       (rdtsc () - start) / FAST_ITERS);
+
+  start = rdtsc ();
+  for (i = 0; i < FAST_ITERS; i++)
+    {
+      lock_acquire_adaptive (&lock);
+      lock_release (&lock);
+    }
+  msg ("uncontended adaptive: %llu cycles/op",
+       (rdtsc () - start) / FAST_ITERS);
+
+  start = rdtsc ();
+  for (i = 0; i < FAST_ITERS; i++)
+    {
+      rwlock_acquire_read (&rwlock);
+      rwlock_release_read (&rwlock);
+    }
+  msg ("uncontended rwlock read: %llu cycles/op",
+       (rdtsc () - start) / FAST_ITERS);
+
+  start = rdtsc ();
+  for (i = 0; i < FAST_ITERS; i++)
+    {
+      rwlock_acquire_write (&rwlock);
+      rwlock_release_write (&rwlock);
+    }
+  msg ("uncontended rwlock write: %llu cycles/op",
+       (rdtsc () - start) / FAST_ITERS);
+}
+
+static void
+measure_contended (enum mode m)
+{
+  int64_t start_ticks;
+  uint64_t start;
+  int i;
+
+  mode = m;
+  max_readers = 0;
+
+  start_ticks = timer_ticks ();
+  start = rdtsc ();
+  for (i = 0; i < READER_CNT; i++)
+    thread_create ("reader", PRI_DEFAULT, reader_func, NULL);
+  for (i = 0; i < WRITER_CNT; i++)
+    thread_create ("writer", PRI_DEFAULT, writer_func, NULL);
+  for (i = 0; i < READER_CNT + WRITER_CNT; i++)
+    sema_down (&done);
+
+  msg ("contended %s: %d ops in %lld ticks (%llu cycles/op), "
+       "up to %d readers inside",
+       mode_names[m], (READER_CNT + WRITER_CNT) * ITERS,
+       timer_elapsed (start_ticks),
+       (rdtsc () - start) / ((READER_CNT + WRITER_CNT) * ITERS),
+       max_readers);
+}
+
+static void
+enter (bool writer)
+{
+  switch (mode)
+    {
+    case MODE_LOCK:
+      lock_acquire (&lock);
+      break;
+    case MODE_ADAPTIVE:
+      lock_acquire_adaptive (&lock);
+      break;
+    default:
+      if (writer)
+        rwlock_acquire_write (&rwlock);
+      else
+        rwlock_acquire_read (&rwlock);
+      break;
+    }
+}
+
+static void
+leave (bool writer)
+{
+  if (mode != MODE_RWLOCK)
+    lock_release (&lock);
+  else if (writer)
+    rwlock_release_write (&rwlock);
+  else
+    rwlock_release_read (&rwlock);
+}
+
+static void
+reader_func (void *aux UNUSED)
+{
+  int i;
+
+  for (i = 0; i < ITERS; i++)
+    {
+      enter (false);
+      if (active_writers != 0)
+        fail ("%s: reader entered while a writer was inside",
+              mode_names[mode]);
+      if (++active_readers > max_readers)
+        max_readers = active_readers;
+      timer_sleep (1);
+      active_readers--;
+      leave (false);
+    }
+  sema_up (&done);
+}
+
+static void
+writer_func (void *aux UNUSED)
+{
+  int i;
+
+  for (i = 0; i < ITERS; i++)
+    {
+      enter (true);
+      if (active_readers != 0 || active_writers != 0)
+        fail ("%s: writer entered while %d readers and %d writers "
+              "were inside", mode_names[mode], active_readers,
+              active_writers);
+      active_writers++;
+      timer_sleep (1);
+      active_writers--;
+      leave (true);
+    }
+  sema_up (&done);
+}
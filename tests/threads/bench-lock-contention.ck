@@ -0,0 +1,43 @@
+# -*- perl -*-
+
+# The expected output looks like this, with varying numbers:
+#
+# (bench-lock-contention) begin
+# (bench-lock-contention) uncontended lock: 210 cycles/op
+# (bench-lock-contention) uncontended adaptive: 230 cycles/op
+# (bench-lock-contention) uncontended rwlock read: 120 cycles/op
+# (bench-lock-contention) uncontended rwlock write: 260 cycles/op
+# (bench-lock-contention) contended lock: 50 ops in 51 ticks (...), up to 1 readers inside
+# (bench-lock-contention) contended adaptive: 50 ops in 51 ticks (...), up to 1 readers inside
+# (bench-lock-contention) contended rwlock: 50 ops in 21 ticks (...), up to 4 readers inside
+# (bench-lock-contention) end
+
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+
+common_checks ("run", @output);
+
+my (@core) = get_core_output ("run", @output);
+fail "Missing \"begin\".\n" if !grep (/\(bench-lock-contention\) begin$/, @core);
+fail "Missing \"end\".\n" if !grep (/\(bench-lock-contention\) end$/, @core);
+
+foreach my $name ('lock', 'adaptive', 'rwlock read', 'rwlock write') {
+    fail "No uncontended $name measurement.\n"
+      if !grep (/uncontended $name: \d+ cycles\/op$/, @core);
+}
+
+foreach my $name ('lock', 'adaptive', 'rwlock') {
+    my ($line) = grep (/^\(bench-lock-contention\) contended $name: /, @core);
+    fail "No contended $name measurement.\n" if !defined $line;
+    my ($ops, $readers) = $line =~ /: (\d+) ops in .*up to (\d+) readers/
+      or fail "Malformed measurement: $line\n";
+    fail "Wrong op count for $name: $ops.\n" if $ops != 50;
+    fail "$name let $readers readers in at once.\n"
+      if $name ne 'rwlock' && $readers != 1;
+}
+
+pass;
@@ -0,0 +1,69 @@
+/* Measures lock handoff latency: the TSC cycles from the moment
+   the holder of a lock starts lock_release() to the moment a
+   higher-priority thread blocked in lock_acquire() on it is
+   running with the lock.  The waiter donates its priority to
+   the holder while it waits, so this also covers undoing the
+   donation. */
+
+#include <stdio.h>
+#include "tests/threads/bench.h"
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "intrinsic.h"
+
+#define SAMPLES 1000
+
+static struct lock lock;
+static struct semaphore go;
+static struct semaphore done;
+static uint64_t release_tsc;
+static struct histogram hist;
+
+static thread_func waiter_func;
+
+void
+test_bench_lock_handoff (void)
+{
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  lock_init (&lock);
+  sema_init (&go, 0);
+  sema_init (&done, 0);
+  histogram_init (&hist);
+  thread_create ("waiter", PRI_DEFAULT + 1, waiter_func, NULL);
+
+  for (i = 0; i < SAMPLES; i++)
+    {
+      lock_acquire (&lock);
+
+      /* The waiter runs at once and blocks on LOCK. */
+      sema_up (&go);
+      if (thread_get_priority () != PRI_DEFAULT + 1)
+        fail ("waiter did not donate its priority");
+
+      release_tsc = rdtsc ();
+      lock_release (&lock);
+    }
+  sema_down (&done);
+  bench_report ("lock handoff", &hist, "cycles");
+}
+
+static void
+waiter_func (void *aux UNUSED)
+{
+  int i;
+
+  for (i = 0; i < SAMPLES; i++)
+    {
+      sema_down (&go);
+      lock_acquire (&lock);
+      histogram_add (&hist, rdtsc () - release_tsc);
+      lock_release (&lock);
+    }
+  sema_up (&done);
+}
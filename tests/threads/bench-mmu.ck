@@ -0,0 +1,34 @@
+# -*- perl -*-
+
+# The expected output looks like this, with varying numbers:
+#
+# (bench-mmu) begin
+# (bench-mmu) lookup, in order: 20 cycles/page
+# (bench-mmu) lookup, across regions: 60 cycles/page
+# (bench-mmu) clock sweep, per page: 150 cycles/page
+# (bench-mmu) clock sweep, by range: 10 cycles/page
+# (bench-mmu) unmap, per page: 110 cycles/page
+# (bench-mmu) unmap, by range: 8 cycles/page
+# (bench-mmu) end
+
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+
+common_checks ("run", @output);
+
+my (@core) = get_core_output ("run", @output);
+fail "Missing \"begin\".\n" if !grep (/\(bench-mmu\) begin$/, @core);
+fail "Missing \"end\".\n" if !grep (/\(bench-mmu\) end$/, @core);
+
+foreach my $name ('lookup, in order', 'lookup, across regions',
+                  'clock sweep, per page', 'clock sweep, by range',
+                  'unmap, per page', 'unmap, by range') {
+    fail "No $name measurement.\n"
+      if !grep (/^\(bench-mmu\) \Q$name\E: \d+ cycles\/page$/, @core);
+}
+
+pass;
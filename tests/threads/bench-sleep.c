@@ -0,0 +1,96 @@
+/* Measures timer_sleep() accuracy with many sleepers.
+
+   SLEEPER_CNT threads repeatedly sleep until the same future
+   tick.  Reports how many ticks late each one wakes (ideally
+   0), and, for each round, the TSC cycles from the first
+   sleeper running again to the last, which grows with the cost
+   of waking each sleeper. */
+
+#include <stdio.h>
+#include "tests/threads/bench.h"
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+#include "intrinsic.h"
+
+#define SLEEPER_CNT 32
+#define ROUNDS 20
+
+static int64_t target;                  /* Tick to wake up at. */
+static struct semaphore start[SLEEPER_CNT];
+static struct semaphore done;
+static uint64_t woke_tsc[SLEEPER_CNT];
+static struct histogram late_hist;
+
+static thread_func sleeper_func;
+
+void
+test_bench_sleep (void)
+{
+  static struct histogram spread_hist;
+  int round, i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  histogram_init (&late_hist);
+  histogram_init (&spread_hist);
+  sema_init (&done, 0);
+  for (i = 0; i < SLEEPER_CNT; i++)
+    {
+      char name[16];
+
+      sema_init (&start[i], 0);
+      snprintf (name, sizeof name, "sleeper %d", i);
+      thread_create (name, PRI_DEFAULT + 1, sleeper_func, &start[i]);
+    }
+
+  for (round = 0; round < ROUNDS; round++)
+    {
+      uint64_t first = UINT64_MAX, last = 0;
+
+      /* Each sleeper runs as soon as it is started, so all of
+         them are asleep long before TARGET. */
+      target = timer_ticks () + 5;
+      for (i = 0; i < SLEEPER_CNT; i++)
+        sema_up (&start[i]);
+      for (i = 0; i < SLEEPER_CNT; i++)
+        sema_down (&done);
+
+      for (i = 0; i < SLEEPER_CNT; i++)
+        {
+          if (woke_tsc[i] < first)
+            first = woke_tsc[i];
+          if (woke_tsc[i] > last)
+            last = woke_tsc[i];
+        }
+      histogram_add (&spread_hist, last - first);
+    }
+
+  bench_report ("ticks late", &late_hist, "ticks");
+  bench_report ("wakeup spread", &spread_hist, "cycles");
+}
+
+static void
+sleeper_func (void *start_)
+{
+  struct semaphore *start_sema = start_;
+  int idx = start_sema - start;
+  int round;
+
+  for (round = 0; round < ROUNDS; round++)
+    {
+      int64_t late;
+
+      sema_down (start_sema);
+      timer_sleep (target - timer_ticks ());
+      woke_tsc[idx] = rdtsc ();
+      late = timer_ticks () - target;
+
+      histogram_add_atomic (&late_hist, late > 0 ? late : 0);
+      sema_up (&done);
+    }
+}
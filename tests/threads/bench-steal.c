@@ -0,0 +1,94 @@
+/* Measures how well the load balancer spreads CPU-bound work.
+
+   The main thread creates WORKER_CNT kernel threads, all on its
+   own CPU's run queue, each of which does the same fixed amount
+   of computation.  Idle CPUs have to steal them to help.  The
+   test reports the elapsed time, how many CPUs the workers kept
+   busy on average (their total running time over the elapsed
+   time), and how many different CPUs they ran on. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/cpu.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+#include "intrinsic.h"
+
+#define WORKER_CNT 8            /* CPU-bound threads. */
+#define WORK_ITERS 10000000     /* Loop iterations per thread. */
+
+static struct semaphore done;
+static uint64_t run_cycles;     /* Workers' total running time. */
+static unsigned cpus_used;      /* Bitmap of CPUs the workers ran on. */
+static volatile uint64_t sink;
+
+static thread_func worker_func;
+
+void
+test_bench_steal (void)
+{
+  long long steals_before = 0, steals = 0;
+  int64_t start_ticks;
+  uint64_t start, elapsed;
+  unsigned i, cpu_used_cnt;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  sema_init (&done, 0);
+  for (i = 0; i < cpu_cnt; i++)
+    steals_before += cpus[i].steal_cnt;
+
+  start_ticks = timer_ticks ();
+  start = rdtsc ();
+  for (i = 0; i < WORKER_CNT; i++)
+    thread_create ("worker", PRI_DEFAULT, worker_func, NULL);
+  for (i = 0; i < WORKER_CNT; i++)
+    sema_down (&done);
+  elapsed = rdtsc () - start;
+
+  for (i = 0; i < cpu_cnt; i++)
+    steals += cpus[i].steal_cnt;
+  cpu_used_cnt = 0;
+  for (i = 0; i < CPU_MAX; i++)
+    if (cpus_used & (1u << i))
+      cpu_used_cnt++;
+
+  msg ("%d workers in %lld ticks, %llu.%02llu of %u CPUs busy",
+       WORKER_CNT, timer_elapsed (start_ticks), run_cycles / elapsed,
+       run_cycles * 100 / elapsed % 100, cpu_cnt);
+  msg ("workers ran on %u CPUs, %lld threads stolen",
+       cpu_used_cnt, steals - steals_before);
+}
+
+static void
+worker_func (void *aux UNUSED)
+{
+  struct thread *t = thread_current ();
+  enum intr_level old_level;
+  uint64_t x = t->tid;
+  int i;
+
+  for (i = 0; i < WORK_ITERS; i++)
+    {
+      /* xorshift64, so the loop cannot be optimized away. */
+      x ^= x << 13;
+      x ^= x >> 7;
+      x ^= x << 17;
+      if ((i & 0xffff) == 0)
+        __atomic_fetch_or (&cpus_used, 1u << t->cpu->id, __ATOMIC_RELAXED);
+    }
+  sink = x;
+
+  /* A switch between reading run_cycles and state_tsc would count
+     the last stretch twice. */
+  old_level = intr_disable ();
+  __atomic_fetch_or (&cpus_used, 1u << t->cpu->id, __ATOMIC_RELAXED);
+  __atomic_fetch_add (&run_cycles, t->run_cycles + (rdtsc () - t->state_tsc),
+                      __ATOMIC_RELAXED);
+  intr_set_level (old_level);
+  sema_up (&done);
+}
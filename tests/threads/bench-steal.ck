@@ -0,0 +1,37 @@
+# -*- perl -*-
+
+# The expected output looks like this, with varying numbers:
+#
+# (bench-steal) begin
+# (bench-steal) 8 workers in 120 ticks, 3.91 of 4 CPUs busy
+# (bench-steal) workers ran on 4 CPUs, 9 threads stolen
+# (bench-steal) end
+
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+
+common_checks ("run", @output);
+
+my (@core) = get_core_output ("run", @output);
+fail "Missing \"begin\".\n" if !grep (/\(bench-steal\) begin$/, @core);
+fail "Missing \"end\".\n" if !grep (/\(bench-steal\) end$/, @core);
+
+my ($busy) = grep (/ workers in \d+ ticks, /, @core);
+fail "No elapsed time measurement.\n" if !defined $busy;
+my ($cpus) = $busy =~ /of (\d+) CPUs busy$/
+  or fail "Malformed measurement: $busy\n";
+
+my ($spread) = grep (/workers ran on \d+ CPUs/, @core);
+fail "No CPU count.\n" if !defined $spread;
+my ($used) = $spread =~ /ran on (\d+) CPUs, \d+ threads stolen$/
+  or fail "Malformed measurement: $spread\n";
+fail "Only 1 CPU online; run with --smp of at least 2.\n" if $cpus < 2;
+fail "Workers ran on $used CPUs, but $cpus are online.\n"
+  if $used > $cpus;
+fail "Workers stayed on 1 of $cpus CPUs.\n" if $used < 2;
+
+pass;
@@ -0,0 +1,81 @@
+/* Measures how accurately timer_usleep() sleeps below a timer
+   tick.  Sleeps for each of several durations many times and
+   reports how many nanoseconds late, by timer_ns(), each one
+   wakes.  With a local APIC timer these sleeps block, so a
+   lower-priority thread spinning in the background also gets
+   the CPU while the main thread sleeps; the test reports its
+   share of the time. */
+
+#include <stdio.h>
+#include "tests/threads/bench.h"
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+#include "intrinsic.h"
+
+#define SAMPLES 100
+
+static const int64_t durations[] = {50, 200, 1000};   /* Microseconds. */
+
+static volatile bool stop;
+static struct semaphore done;
+static uint64_t spinner_cycles;         /* Background thread's run time. */
+
+static thread_func spinner_func;
+
+void
+test_bench_usleep (void)
+{
+  uint64_t start;
+  size_t d;
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  sema_init (&done, 0);
+  stop = false;
+  thread_create ("spinner", PRI_DEFAULT - 1, spinner_func, NULL);
+
+  start = timer_ns ();
+  for (d = 0; d < sizeof durations / sizeof *durations; d++)
+    {
+      static struct histogram hist;
+      char label[32];
+
+      histogram_init (&hist);
+      for (i = 0; i < SAMPLES; i++)
+        {
+          uint64_t before = timer_ns ();
+          uint64_t due = before + durations[d] * 1000;
+          uint64_t after;
+
+          timer_usleep (durations[d]);
+          after = timer_ns ();
+          if (after < due)
+            fail ("timer_usleep(%lld) woke %llu ns early",
+                  durations[d], due - after);
+          histogram_add (&hist, after - due);
+        }
+      snprintf (label, sizeof label, "usleep(%lld) late", durations[d]);
+      bench_report (label, &hist, "ns");
+    }
+
+  stop = true;
+  sema_down (&done);
+  msg ("background thread ran %llu%% of the time",
+       timer_cycles_to_ns (spinner_cycles) * 100 / (timer_ns () - start));
+}
+
+static void
+spinner_func (void *aux UNUSED)
+{
+  struct thread *t = thread_current ();
+
+  while (!stop)
+    barrier ();
+  spinner_cycles = t->run_cycles + (rdtsc () - t->state_tsc);
+  sema_up (&done);
+}
@@ -0,0 +1,7 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::threads::bench;
+check_bench ("usleep(50) late" => 100, "usleep(200) late" => 100,
+	     "usleep(1000) late" => 100);
@@ -0,0 +1,79 @@
+/* Measures wakeup-to-run latency: the TSC cycles from the moment
+   one thread ups a semaphore to the moment the thread waiting on
+   it is running again.
+
+   In the first run the waiter has higher priority than the
+   waker, so sema_up() should switch to it at once.  In the
+   second they have equal priority and the waker yields right
+   after the sema_up(), so the latency also includes a trip
+   through the ready queue. */
+
+#include <stdio.h>
+#include "tests/threads/bench.h"
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "intrinsic.h"
+
+#define SAMPLES 1000
+
+static struct semaphore wake;
+static struct semaphore done;
+static uint64_t wake_tsc;
+static struct histogram hist;
+
+static thread_func waiter_func;
+static void measure (const char *what, int priority, bool yield);
+
+void
+test_bench_wakeup (void)
+{
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  measure ("preempting wakeup", PRI_DEFAULT + 1, false);
+  measure ("wakeup and yield", PRI_DEFAULT, true);
+}
+
+/* Wakes a waiter running at PRIORITY SAMPLES times, yielding
+   after each wakeup if YIELD, and reports the latencies as
+   WHAT. */
+static void
+measure (const char *what, int priority, bool yield)
+{
+  int i;
+
+  sema_init (&wake, 0);
+  sema_init (&done, 0);
+  histogram_init (&hist);
+  thread_create ("waiter", priority, waiter_func, NULL);
+
+  for (i = 0; i < SAMPLES; i++)
+    {
+      /* Let the waiter get back to sema_down(). */
+      while (list_empty (&wake.waiters))
+        thread_yield ();
+
+      wake_tsc = rdtsc ();
+      sema_up (&wake);
+      if (yield)
+        thread_yield ();
+    }
+  sema_down (&done);
+  bench_report (what, &hist, "cycles");
+}
+
+static void
+waiter_func (void *aux UNUSED)
+{
+  int i;
+
+  for (i = 0; i < SAMPLES; i++)
+    {
+      sema_down (&wake);
+      histogram_add (&hist, rdtsc () - wake_tsc);
+    }
+  sema_up (&done);
+}
@@ -0,0 +1,63 @@
+/* Measures yield ping-pong: two threads of equal priority call
+   thread_yield() in turn, so that every yield is a context
+   switch to the other thread.  Reports the round trip (two
+   switches) as seen by one of them, and overall switches per
+   thousand cycles. */
+
+#include <stdio.h>
+#include "tests/threads/bench.h"
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "intrinsic.h"
+
+#define SAMPLES 10000
+
+static volatile bool stop;
+static struct semaphore done;
+
+static thread_func partner_func;
+
+void
+test_bench_yield (void)
+{
+  static struct histogram hist;
+  uint64_t start, total;
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  histogram_init (&hist);
+  sema_init (&done, 0);
+  stop = false;
+  thread_create ("partner", PRI_DEFAULT, partner_func, NULL);
+
+  /* Let the partner start yielding. */
+  thread_yield ();
+
+  start = rdtsc ();
+  for (i = 0; i < SAMPLES; i++)
+    {
+      uint64_t before = rdtsc ();
+      thread_yield ();
+      histogram_add (&hist, rdtsc () - before);
+    }
+  total = rdtsc () - start;
+
+  stop = true;
+  sema_down (&done);
+
+  bench_report ("yield round trip", &hist, "cycles");
+  msg ("yield throughput: %d switches in %llu cycles "
+       "(%llu cycles/switch)", 2 * SAMPLES, total, total / (2 * SAMPLES));
+}
+
+static void
+partner_func (void *aux UNUSED)
+{
+  while (!stop)
+    thread_yield ();
+  sema_up (&done);
+}
@@ -0,0 +1,18 @@
+/* Helpers shared by the scheduler benchmarks. */
+
+#include "tests/threads/bench.h"
+#include "tests/threads/tests.h"
+
+/* Prints a one-line percentile table for histogram H, whose
+   samples are in UNITs, labeled WHAT.  tests/threads/bench.pm
+   checks these lines and utils/bench-compare compares them
+   between runs. */
+void
+bench_report (const char *what, const struct histogram *h, const char *unit)
+{
+  msg ("%s: %llu samples, %s min %llu p50 %llu p90 %llu p99 %llu "
+       "p99.9 %llu max %llu mean %llu",
+       what, h->cnt, unit, h->min, histogram_percentile (h, 500),
+       histogram_percentile (h, 900), histogram_percentile (h, 990),
+       histogram_percentile (h, 999), h->max, histogram_mean (h));
+}
@@ -0,0 +1,9 @@
+#ifndef TESTS_THREADS_BENCH_H
+#define TESTS_THREADS_BENCH_H
+
+#include <histogram.h>
+
+void bench_report (const char *what, const struct histogram *,
+                   const char *unit);
+
+#endif /* tests/threads/bench.h */
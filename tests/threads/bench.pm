@@ -0,0 +1,35 @@
+use strict;
+use warnings;
+use tests::tests;
+
+# Checks that the benchmark output has a well-formed percentile
+# table from bench_report() for each label in %SAMPLES, with the
+# given number of samples, and passes if so.
+sub check_bench {
+    my (%samples) = @_;
+    our ($test);
+
+    my (@output) = read_text_file ("$test.output");
+    common_checks ("run", @output);
+    my (@core) = get_core_output ("run", @output);
+
+    my ($name) = $test =~ m|([^/]+)$|;
+    fail "Missing \"begin\".\n" if !grep (/^\($name\) begin$/, @core);
+    fail "Missing \"end\".\n" if !grep (/^\($name\) end$/, @core);
+
+    foreach my $label (sort keys %samples) {
+	my ($line) = grep (/^\($name\) \Q$label\E: /, @core);
+	fail "No measurement for \"$label\".\n" if !defined $line;
+	my ($cnt, @pcts) = $line =~ /: (\d+) samples, \w+ min (\d+) p50 (\d+) p90 (\d+) p99 (\d+) p99\.9 (\d+) max (\d+) mean \d+$/
+	  or fail "Malformed measurement: $line\n";
+	fail "\"$label\" has $cnt samples, expected $samples{$label}.\n"
+	  if $cnt != $samples{$label};
+	for my $i (1...$#pcts) {
+	    fail "Percentiles out of order: $line\n"
+	      if $pcts[$i] < $pcts[$i - 1];
+	}
+    }
+    pass;
+}
+
+1;
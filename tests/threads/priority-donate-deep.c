@@ -0,0 +1,91 @@
+/* Like priority-donate-chain, but with a chain of donors much
+   deeper than any fixed nesting limit.
+
+   The main thread sets its priority to PRI_MIN and acquires
+   lock 0.  It then creates DEPTH threads, where thread i has
+   priority PRI_MIN + 2 * i, acquires lock i (unless i == DEPTH),
+   and then blocks on lock i - 1.  Each new thread's priority
+   must travel down the whole chain to the main thread.
+
+   When the main thread releases lock 0, each thread in turn
+   gets its lock, still running at the top donor's priority
+   because it holds the lock its successor is waiting for,
+   releases that lock, and hands off to its successor.  The
+   threads then finish in reverse order at their own
+   priorities. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+#define DEPTH 20
+
+struct lock_pair
+  {
+    struct lock *second;
+    struct lock *first;
+  };
+
+static thread_func donor_thread_func;
+
+void
+test_priority_donate_deep (void) 
+{
+  struct lock locks[DEPTH];
+  struct lock_pair lock_pairs[DEPTH + 1];
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  thread_set_priority (PRI_MIN);
+
+  for (i = 0; i < DEPTH; i++)
+    lock_init (&locks[i]);
+
+  lock_acquire (&locks[0]);
+  msg ("%s got lock.", thread_name ());
+
+  for (i = 1; i <= DEPTH; i++)
+    {
+      char name[16];
+      int thread_priority;
+
+      snprintf (name, sizeof name, "thread %d", i);
+      thread_priority = PRI_MIN + i * 2;
+      lock_pairs[i].first = i < DEPTH ? locks + i : NULL;
+      lock_pairs[i].second = locks + i - 1;
+
+      thread_create (name, thread_priority, donor_thread_func, lock_pairs + i);
+      msg ("%s should have priority %d.  Actual priority: %d.",
+           thread_name (), thread_priority, thread_get_priority ());
+    }
+
+  lock_release (&locks[0]);
+  msg ("%s finishing with priority %d.", thread_name (),
+       thread_get_priority ());
+}
+
+static void
+donor_thread_func (void *locks_) 
+{
+  struct lock_pair *locks = locks_;
+
+  if (locks->first)
+    lock_acquire (locks->first);
+
+  lock_acquire (locks->second);
+  msg ("%s got lock", thread_name ());
+
+  lock_release (locks->second);
+  msg ("%s should have priority %d. Actual priority: %d", 
+       thread_name (), PRI_MIN + DEPTH * 2, thread_get_priority ());
+
+  if (locks->first)
+    lock_release (locks->first);
+
+  msg ("%s finishing with priority %d.", thread_name (),
+       thread_get_priority ());
+}
@@ -0,0 +1,22 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+my ($depth) = 20;
+my (@expected) = ("(priority-donate-deep) begin",
+		  "(priority-donate-deep) main got lock.");
+push (@expected, map ("(priority-donate-deep) main should have priority "
+		      . 2 * $_ . ".  Actual priority: " . 2 * $_ . ".",
+		      1...$depth));
+foreach my $i (1...$depth) {
+    push (@expected, "(priority-donate-deep) thread $i got lock",
+	  "(priority-donate-deep) thread $i should have priority "
+	  . 2 * $depth . ". Actual priority: " . 2 * $depth);
+}
+push (@expected, map ("(priority-donate-deep) thread $_ finishing with "
+		      . "priority " . 2 * $_ . ".", reverse (1...$depth)));
+push (@expected, "(priority-donate-deep) main finishing with priority 0.",
+      "(priority-donate-deep) end");
+
+check_expected ([join ("\n", @expected) . "\n"]);
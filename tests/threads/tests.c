@@ -25,6 +25,7 @@ static const struct test tests[] =
     {"priority-donate-sema", test_priority_donate_sema},
     {"priority-donate-lower", test_priority_donate_lower},
     {"priority-donate-chain", test_priority_donate_chain},
+    {"priority-donate-deep", test_priority_donate_deep},
     {"priority-fifo", test_priority_fifo},
     {"priority-preempt", test_priority_preempt},
     {"priority-sema", test_priority_sema},
@@ -38,6 +39,15 @@ static const struct test tests[] =
     {"mlfqs-nice-2", test_mlfqs_nice_2},
     {"mlfqs-nice-10", test_mlfqs_nice_10},
     {"mlfqs-block", test_mlfqs_block},
+    {"bench-lock-contention", test_bench_lock_contention},
+    {"bench-wakeup", test_bench_wakeup},
+    {"bench-yield", test_bench_yield},
+    {"bench-lock-handoff", test_bench_lock_handoff},
+    {"bench-sleep", test_bench_sleep},
+    {"bench-console", test_bench_console},
+    {"bench-mmu", test_bench_mmu},
+    {"bench-steal", test_bench_steal},
+    {"bench-usleep", test_bench_usleep},
   };
 
 static const char *test_name;
@@ -19,6 +19,7 @@ extern test_func test_priority_donate_sema;
 extern test_func test_priority_donate_nest;
 extern test_func test_priority_donate_lower;
 extern test_func test_priority_donate_chain;
+extern test_func test_priority_donate_deep;
 extern test_func test_priority_fifo;
 extern test_func test_priority_preempt;
 extern test_func test_priority_sema;
@@ -32,6 +33,15 @@ extern test_func test_mlfqs_fair_20;
 extern test_func test_mlfqs_nice_2;
 extern test_func test_mlfqs_nice_10;
 extern test_func test_mlfqs_block;
+extern test_func test_bench_lock_contention;
+extern test_func test_bench_wakeup;
+extern test_func test_bench_yield;
+extern test_func test_bench_lock_handoff;
+extern test_func test_bench_sleep;
+extern test_func test_bench_console;
+extern test_func test_bench_mmu;
+extern test_func test_bench_steal;
+extern test_func test_bench_usleep;
 
 void msg (const char *, ...);
 void fail (const char *, ...);
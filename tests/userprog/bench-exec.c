@@ -0,0 +1,57 @@
+/* Measures how long exec() takes.  A child that exits straight
+   after fork() gives the cost of fork(), wait() and exit() alone,
+   then children that exec() child-nop, first with no arguments
+   and then with ARG_CNT of them, add the cost of exec().  Each
+   run prints the mean time per child in thousands of TSC
+   cycles. */
+
+#include <stdio.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define CHILD_CNT 20            /* Children started per run. */
+#define ARG_CNT 32              /* Arguments in the long command line. */
+
+/* Starts CHILD_CNT children, each of which runs CMD_LINE or, if
+   it is null, exits at once, and waits for each.  Prints the mean
+   cost of one child, labelled WHAT. */
+static void
+run (const char *what, const char *cmd_line)
+{
+  uint64_t start;
+  int i;
+
+  start = rdtsc ();
+  for (i = 0; i < CHILD_CNT; i++)
+    {
+      pid_t pid = fork ("child-nop");
+      if (pid == 0)
+        {
+          if (cmd_line == NULL)
+            exit (0);
+          exec (cmd_line);
+        }
+      else if (pid < 0 || wait (pid) != 0)
+        fail ("%s: child %d failed", what, i);
+    }
+  msg ("%s: %llu kcycles/child", what,
+       (unsigned long long) ((rdtsc () - start) / CHILD_CNT / 1000));
+}
+
+void
+test_main (void)
+{
+  char cmd_line[ARG_CNT * 8];
+  int i;
+
+  strlcpy (cmd_line, "child-nop", sizeof cmd_line);
+  for (i = 1; i < ARG_CNT; i++)
+    snprintf (cmd_line + strlen (cmd_line), sizeof cmd_line - strlen (cmd_line),
+              " arg%d", i);
+
+  run ("fork+exit", NULL);
+  run ("fork+exec", "child-nop");
+  run ("fork+exec, 32 args", cmd_line);
+}
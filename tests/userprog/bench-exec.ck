@@ -0,0 +1,34 @@
+# -*- perl -*-
+
+# The expected output looks like this, with varying numbers and
+# a "child-nop: exit(0)" line from each child:
+#
+# (bench-exec) begin
+# (bench-exec) fork+exit: 640 kcycles/child
+# (bench-exec) fork+exec: 1480 kcycles/child
+# (bench-exec) fork+exec, 32 args: 1510 kcycles/child
+# (bench-exec) end
+
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+
+common_checks ("run", @output);
+
+my (@core) = get_core_output ("run", @output);
+fail "Missing \"begin\".\n" if !grep (/\(bench-exec\) begin$/, @core);
+fail "Missing \"end\".\n" if !grep (/\(bench-exec\) end$/, @core);
+
+foreach my $what ('fork+exit', 'fork+exec', 'fork+exec, 32 args') {
+    fail "No measurement for \"$what\".\n"
+      if !grep (/^\(bench-exec\) \Q$what\E: \d+ kcycles\/child$/, @core);
+}
+
+my ($children) = scalar (grep (/^child-nop: exit\(0\)$/, @core));
+fail "$children children exited cleanly, expected 60.\n"
+  if $children != 60;
+
+pass;
@@ -0,0 +1,157 @@
+/* Measures what lazy FPU switching costs processes that do and do
+   not use the FPU.  Each run forks PROC_CNT workers that take
+   turns with yield(), each doing a fixed amount of arithmetic per
+   turn: FP workers on the SSE registers, integer workers on
+   general-purpose registers only.  Runs with no, half and all FP
+   workers are timed from the first fork to the last wait.
+
+   Integer workers should cost the same in every run, since they
+   never trap or have their state saved.  Every switch to an FP
+   worker from another FP worker costs a #NM trap and a save and
+   restore.  FP workers also check after each turn that their
+   registers still hold their own values. */
+
+#include <stdint.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PROC_CNT 4              /* Workers per run. */
+#define TURNS 500               /* Turns per worker. */
+#define WORK 200                /* Loop iterations per turn. */
+
+#define ONE 0x3ff0000000000000ULL       /* 1.0 as a double. */
+
+/* xmm8-xmm15, which FP workers check, as 64-bit halves. */
+typedef uint64_t check_regs[16];
+
+static void
+load_regs (const uint64_t work[2], const check_regs v)
+{
+  asm volatile ("movdqu (%0), %%xmm0\n\t"
+                "movdqu (%0), %%xmm1\n\t"
+                "movdqu (%0), %%xmm2\n\t"
+                "movdqu (%0), %%xmm3\n\t"
+                "movdqu 0(%1), %%xmm8\n\t"
+                "movdqu 16(%1), %%xmm9\n\t"
+                "movdqu 32(%1), %%xmm10\n\t"
+                "movdqu 48(%1), %%xmm11\n\t"
+                "movdqu 64(%1), %%xmm12\n\t"
+                "movdqu 80(%1), %%xmm13\n\t"
+                "movdqu 96(%1), %%xmm14\n\t"
+                "movdqu 112(%1), %%xmm15"
+                : : "r" (work), "r" (v) : "memory");
+}
+
+static void
+store_regs (check_regs v)
+{
+  asm volatile ("movdqu %%xmm8, 0(%0)\n\t"
+                "movdqu %%xmm9, 16(%0)\n\t"
+                "movdqu %%xmm10, 32(%0)\n\t"
+                "movdqu %%xmm11, 48(%0)\n\t"
+                "movdqu %%xmm12, 64(%0)\n\t"
+                "movdqu %%xmm13, 80(%0)\n\t"
+                "movdqu %%xmm14, 96(%0)\n\t"
+                "movdqu %%xmm15, 112(%0)"
+                : : "r" (v) : "memory");
+}
+
+/* Multiplies and adds doubles in xmm0-xmm3.  The values stay
+   normal numbers, so no microcode assists skew the timing. */
+static void
+fp_work (void)
+{
+  int n = WORK;
+
+  asm volatile ("1:\n\t"
+                "mulpd %%xmm1, %%xmm0\n\t"
+                "addpd %%xmm1, %%xmm2\n\t"
+                "mulpd %%xmm3, %%xmm1\n\t"
+                "dec %0\n\t"
+                "jnz 1b"
+                : "+r" (n));
+}
+
+static void
+int_work (void)
+{
+  uint64_t x = 1, y = 3;
+  int n = WORK;
+
+  asm volatile ("1:\n\t"
+                "imul %2, %1\n\t"
+                "add %2, %1\n\t"
+                "imul %1, %2\n\t"
+                "dec %0\n\t"
+                "jnz 1b"
+                : "+r" (n), "+r" (x), "+r" (y));
+}
+
+/* Runs a worker process and exits with 0 if it saw no corruption. */
+static void
+worker (bool fp, int id)
+{
+  static const uint64_t work[2] = {ONE, ONE};
+  check_regs expect, actual;
+  int i, j;
+
+  if (fp)
+    {
+      for (i = 0; i < 16; i++)
+        expect[i] = (uint64_t) id << 32 | i;
+      load_regs (work, expect);
+    }
+
+  for (i = 0; i < TURNS; i++)
+    {
+      if (fp)
+        {
+          fp_work ();
+          store_regs (actual);
+          for (j = 0; j < 16; j++)
+            if (actual[j] != expect[j])
+              exit (1);
+        }
+      else
+        int_work ();
+      yield ();
+    }
+  exit (0);
+}
+
+/* Runs PROC_CNT workers, FP_CNT of them FP workers, and reports
+   the cycles per turn as NAME. */
+static void
+run (const char *name, int fp_cnt)
+{
+  pid_t pids[PROC_CNT];
+  uint64_t start;
+  int i;
+
+  start = rdtsc ();
+  for (i = 0; i < PROC_CNT; i++)
+    {
+      bool fp = i < fp_cnt;
+
+      pids[i] = fork (fp ? "fp-worker" : "int-worker");
+      if (pids[i] == 0)
+        worker (fp, i);
+      if (pids[i] < 0)
+        fail ("fork() returned %d", pids[i]);
+    }
+  for (i = 0; i < PROC_CNT; i++)
+    if (wait (pids[i]) != 0)
+      fail ("%s: worker %d saw corrupted registers", name, i);
+
+  msg ("%s, %d of %d FP: %llu cycles/turn", name, fp_cnt, PROC_CNT,
+       (unsigned long long) ((rdtsc () - start) / (PROC_CNT * TURNS)));
+}
+
+void
+test_main (void)
+{
+  run ("integer only", 0);
+  run ("mixed", PROC_CNT / 2);
+  run ("FP only", PROC_CNT);
+}
@@ -0,0 +1,40 @@
+# -*- perl -*-
+
+# The expected output looks like this, with varying numbers and
+# the workers' exit lines in any order:
+#
+# (bench-fpu) begin
+# int-worker: exit(0)
+# ...
+# (bench-fpu) integer only, 0 of 4 FP: 2500 cycles/turn
+# fp-worker: exit(0)
+# ...
+# (bench-fpu) mixed, 2 of 4 FP: 2900 cycles/turn
+# ...
+# (bench-fpu) FP only, 4 of 4 FP: 3400 cycles/turn
+# (bench-fpu) end
+
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+
+common_checks ("run", @output);
+
+my (@core) = get_core_output ("run", @output);
+fail "Missing \"begin\".\n" if !grep (/\(bench-fpu\) begin$/, @core);
+fail "Missing \"end\".\n" if !grep (/\(bench-fpu\) end$/, @core);
+
+my ($fp) = scalar (grep (/^fp-worker: exit\(0\)$/, @core));
+my ($int) = scalar (grep (/^int-worker: exit\(0\)$/, @core));
+fail "Expected 6 clean FP worker exits, got $fp.\n" if $fp != 6;
+fail "Expected 6 clean integer worker exits, got $int.\n" if $int != 6;
+
+foreach my $name ('integer only, 0', 'mixed, 2', 'FP only, 4') {
+    fail "No $name measurement.\n"
+      if !grep (/^\(bench-fpu\) \Q$name\E of 4 FP: \d+ cycles\/turn$/, @core);
+}
+
+pass;
@@ -0,0 +1,193 @@
+/* Measures how many system calls it takes to move a megabyte
+   of small records, and what that costs, with and without the
+   vectored and positional I/O calls.
+
+   Every record is a HDR_SIZE-byte header followed by its
+   payload, the way a log writes them.  The records are written
+   with one write() for each header and each payload, with one
+   writev() per record, and with one writev() per BATCH records,
+   then read back in shuffled order with seek() and read() and
+   with pread(), and in order with one readv() per BATCH
+   records.  Each run prints the system calls it made and the
+   TSC cycles it took, both scaled to a megabyte. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define RECORD_SIZE 512                         /* Bytes per record. */
+#define HDR_SIZE 16                             /* Bytes of header. */
+#define PAYLOAD_SIZE (RECORD_SIZE - HDR_SIZE)   /* Bytes of payload. */
+#define RECORD_CNT 256                          /* Records in file. */
+#define FILE_SIZE (RECORD_CNT * RECORD_SIZE)
+#define BATCH (IOV_MAX / 2)                     /* Records per vector. */
+#define MB (1024 * 1024)
+
+static char data[RECORD_CNT][RECORD_SIZE];
+static char buf[RECORD_CNT][RECORD_SIZE];
+static struct iovec iov[IOV_MAX];
+static int order[RECORD_CNT];
+static int handle;
+
+/* Prints WHAT's cost for one pass over the file. */
+static void
+report (const char *what, long long calls, uint64_t cycles)
+{
+  msg ("%s: %lld syscalls/MB, %llu kcycles/MB", what,
+       calls * MB / FILE_SIZE,
+       (unsigned long long) (cycles / 1000 * MB / FILE_SIZE));
+}
+
+/* Points IOV at the headers and payloads of the BATCH records
+   of RECORDS starting at FIRST. */
+static void
+fill_iov (char records[][RECORD_SIZE], int first)
+{
+  int i;
+
+  for (i = 0; i < BATCH; i++)
+    {
+      iov[2 * i].iov_base = records[first + i];
+      iov[2 * i].iov_len = HDR_SIZE;
+      iov[2 * i + 1].iov_base = records[first + i] + HDR_SIZE;
+      iov[2 * i + 1].iov_len = PAYLOAD_SIZE;
+    }
+}
+
+static void
+write_split (void)
+{
+  uint64_t start = rdtsc ();
+  int i;
+
+  for (i = 0; i < RECORD_CNT; i++)
+    if (write (handle, data[i], HDR_SIZE) != HDR_SIZE
+        || write (handle, data[i] + HDR_SIZE, PAYLOAD_SIZE) != PAYLOAD_SIZE)
+      fail ("write() of record %d failed", i);
+  report ("write, header and payload", 2 * RECORD_CNT, rdtsc () - start);
+}
+
+static void
+writev_record (void)
+{
+  uint64_t start = rdtsc ();
+  int i;
+
+  for (i = 0; i < RECORD_CNT; i++)
+    {
+      iov[0].iov_base = data[i];
+      iov[0].iov_len = HDR_SIZE;
+      iov[1].iov_base = data[i] + HDR_SIZE;
+      iov[1].iov_len = PAYLOAD_SIZE;
+      if (writev (handle, iov, 2) != RECORD_SIZE)
+        fail ("writev() of record %d failed", i);
+    }
+  report ("writev, one record", RECORD_CNT, rdtsc () - start);
+}
+
+static void
+writev_batch (void)
+{
+  uint64_t start = rdtsc ();
+  int i;
+
+  for (i = 0; i < RECORD_CNT; i += BATCH)
+    {
+      fill_iov (data, i);
+      if (writev (handle, iov, IOV_MAX) != BATCH * RECORD_SIZE)
+        fail ("writev() of records %d..%d failed", i, i + BATCH - 1);
+    }
+  report ("writev, batched records", RECORD_CNT / BATCH, rdtsc () - start);
+}
+
+static void
+read_seek (void)
+{
+  uint64_t start = rdtsc ();
+  int i;
+
+  for (i = 0; i < RECORD_CNT; i++)
+    {
+      seek (handle, order[i] * RECORD_SIZE);
+      if (read (handle, buf[order[i]], RECORD_SIZE) != RECORD_SIZE)
+        fail ("read() of record %d failed", order[i]);
+    }
+  report ("seek and read, shuffled", 2 * RECORD_CNT, rdtsc () - start);
+}
+
+static void
+read_pread (void)
+{
+  uint64_t start = rdtsc ();
+  int i;
+
+  for (i = 0; i < RECORD_CNT; i++)
+    if (pread (handle, buf[order[i]], RECORD_SIZE, order[i] * RECORD_SIZE)
+        != RECORD_SIZE)
+      fail ("pread() of record %d failed", order[i]);
+  report ("pread, shuffled", RECORD_CNT, rdtsc () - start);
+}
+
+static void
+readv_batch (void)
+{
+  uint64_t start = rdtsc ();
+  int i;
+
+  for (i = 0; i < RECORD_CNT; i += BATCH)
+    {
+      fill_iov (buf, i);
+      if (readv (handle, iov, IOV_MAX) != BATCH * RECORD_SIZE)
+        fail ("readv() of records %d..%d failed", i, i + BATCH - 1);
+    }
+  report ("readv, batched records", RECORD_CNT / BATCH, rdtsc () - start);
+}
+
+/* Rewinds the file, runs WRITER, and makes sure it wrote every
+   record. */
+static void
+run_write (void (*writer) (void))
+{
+  seek (handle, 0);
+  writer ();
+  if (tell (handle) != FILE_SIZE)
+    fail ("file position %u after writing %d bytes",
+          tell (handle), FILE_SIZE);
+}
+
+/* Rewinds the file, runs READER, and checks what it read. */
+static void
+run_read (void (*reader) (void))
+{
+  memset (buf, 0, sizeof buf);
+  seek (handle, 0);
+  reader ();
+  compare_bytes (buf, data, FILE_SIZE, 0, "bench");
+}
+
+void
+test_main (void) 
+{
+  int i;
+
+  for (i = 0; i < RECORD_CNT; i++)
+    {
+      memset (data[i], 'A' + i % 26, HDR_SIZE);
+      memset (data[i] + HDR_SIZE, 'a' + i % 26, PAYLOAD_SIZE);
+      order[i] = i;
+    }
+  shuffle (order, RECORD_CNT, sizeof *order);
+
+  if (!create ("bench", FILE_SIZE))
+    fail ("create \"bench\" failed");
+  if ((handle = open ("bench")) < 2)
+    fail ("open \"bench\" failed");
+
+  run_write (write_split);
+  run_write (writev_record);
+  run_write (writev_batch);
+  run_read (read_seek);
+  run_read (read_pread);
+  run_read (readv_batch);
+}
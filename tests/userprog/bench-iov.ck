@@ -0,0 +1,42 @@
+# -*- perl -*-
+
+# The expected output looks like this, with varying cycle counts:
+#
+# (bench-iov) begin
+# (bench-iov) write, header and payload: 4096 syscalls/MB, 81234 kcycles/MB
+# (bench-iov) writev, one record: 2048 syscalls/MB, 61234 kcycles/MB
+# (bench-iov) writev, batched records: 64 syscalls/MB, 41234 kcycles/MB
+# (bench-iov) seek and read, shuffled: 4096 syscalls/MB, 71234 kcycles/MB
+# (bench-iov) pread, shuffled: 2048 syscalls/MB, 61234 kcycles/MB
+# (bench-iov) readv, batched records: 64 syscalls/MB, 31234 kcycles/MB
+# (bench-iov) end
+
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+
+common_checks ("run", @output);
+
+my (@core) = get_core_output ("run", @output);
+fail "Missing \"begin\".\n" if !grep (/\(bench-iov\) begin$/, @core);
+fail "Missing \"end\".\n" if !grep (/\(bench-iov\) end$/, @core);
+
+my (%calls) = ('write, header and payload' => 4096,
+	       'writev, one record' => 2048,
+	       'writev, batched records' => 64,
+	       'seek and read, shuffled' => 4096,
+	       'pread, shuffled' => 2048,
+	       'readv, batched records' => 64);
+foreach my $run (sort keys %calls) {
+    my ($line) = grep (/^\(bench-iov\) \Q$run\E: /, @core);
+    fail "No measurement for \"$run\".\n" if !defined $line;
+    my ($n) = $line =~ /: (\d+) syscalls\/MB, \d+ kcycles\/MB$/
+      or fail "Malformed measurement: $line\n";
+    fail "\"$run\" made $n system calls per MB, expected $calls{$run}.\n"
+      if $n != $calls{$run};
+}
+
+pass;
@@ -0,0 +1,60 @@
+/* Measures switching back and forth between two processes.  The
+   parent forks a child and the two take turns with yield(), each
+   touching TOUCH_PAGES pages of its own memory before handing
+   over, so that every switch also pays for whatever TLB entries
+   loading CR3 threw away.  With PCIDs, a process finds its
+   entries still there when it runs again.  Booting with
+   -no-pcid flushes them on every switch, so saving a run made
+   that way as the baseline (`make bench-save
+   KERNELFLAGS=-no-pcid') gives before and after numbers. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define ROUNDS 2000             /* Round trips measured. */
+#define TOUCH_PAGES 32          /* Pages touched per turn. */
+#define PAGE_SIZE 4096
+
+static volatile char buf[TOUCH_PAGES * PAGE_SIZE];
+
+/* Touches each page of BUF, then lets the other process run. */
+static void
+take_turn (void)
+{
+  int i;
+
+  for (i = 0; i < TOUCH_PAGES; i++)
+    buf[i * PAGE_SIZE]++;
+  yield ();
+}
+
+void
+test_main (void)
+{
+  uint64_t start, cycles;
+  pid_t pid;
+  int i;
+
+  pid = fork ("pingpong-child");
+  if (pid == 0)
+    {
+      /* Keep going after the parent stops measuring, so that it
+         never yields to nobody. */
+      for (i = 0; i < 2 * ROUNDS; i++)
+        take_turn ();
+      exit (0);
+    }
+  if (pid < 0)
+    fail ("fork() returned %d", pid);
+
+  start = rdtsc ();
+  for (i = 0; i < ROUNDS; i++)
+    take_turn ();
+  cycles = rdtsc () - start;
+
+  if (wait (pid) != 0)
+    fail ("child failed");
+  msg ("yield ping-pong, %d pages per turn: %llu cycles/round trip",
+       TOUCH_PAGES, (unsigned long long) (cycles / ROUNDS));
+}
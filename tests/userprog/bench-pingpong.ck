@@ -0,0 +1,27 @@
+# -*- perl -*-
+
+# The expected output looks like this, with varying numbers:
+#
+# (bench-pingpong) begin
+# pingpong-child: exit(0)
+# (bench-pingpong) yield ping-pong, 32 pages per turn: 21400 cycles/round trip
+# (bench-pingpong) end
+
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+
+common_checks ("run", @output);
+
+my (@core) = get_core_output ("run", @output);
+fail "Missing \"begin\".\n" if !grep (/\(bench-pingpong\) begin$/, @core);
+fail "Missing \"end\".\n" if !grep (/\(bench-pingpong\) end$/, @core);
+fail "Child did not exit cleanly.\n"
+  if !grep (/^pingpong-child: exit\(0\)$/, @core);
+fail "No measurement.\n"
+  if !grep (/^\(bench-pingpong\) yield ping-pong, \d+ pages per turn: \d+ cycles\/round trip$/, @core);
+
+pass;
@@ -0,0 +1,57 @@
+/* Measures the cost of starting a child program and waiting for
+   it, first with fork() followed by exec() in the child and then
+   with a single spawn().  fork() copies every page of the parent
+   only for exec() to throw them away, so the parent first
+   touches a buffer of BUF_SIZE bytes to give fork() a realistic
+   amount of memory to copy.  Each run prints the mean time per
+   child in thousands of TSC cycles. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define CHILD_CNT 20            /* Children started per run. */
+#define BUF_SIZE (256 * 1024)   /* Parent memory, in bytes. */
+
+static char buf[BUF_SIZE];
+
+/* Prints the mean cost of one child, given CYCLES for
+   CHILD_CNT. */
+static void
+report (const char *what, uint64_t cycles)
+{
+  msg ("%s: %llu kcycles/child", what,
+       (unsigned long long) (cycles / CHILD_CNT / 1000));
+}
+
+void
+test_main (void)
+{
+  char *argv[] = {"child-nop", NULL};
+  uint64_t start;
+  size_t ofs;
+  int i;
+
+  for (ofs = 0; ofs < BUF_SIZE; ofs += 4096)
+    buf[ofs] = 1;
+
+  start = rdtsc ();
+  for (i = 0; i < CHILD_CNT; i++)
+    {
+      pid_t pid = fork ("child-nop");
+      if (pid == 0)
+        exec ("child-nop");
+      else if (pid < 0 || wait (pid) != 0)
+        fail ("fork and exec of child %d failed", i);
+    }
+  report ("fork+exec", rdtsc () - start);
+
+  start = rdtsc ();
+  for (i = 0; i < CHILD_CNT; i++)
+    {
+      pid_t pid = spawn ("child-nop", argv);
+      if (pid < 0 || wait (pid) != 0)
+        fail ("spawn of child %d failed", i);
+    }
+  report ("spawn", rdtsc () - start);
+}
@@ -0,0 +1,33 @@
+# -*- perl -*-
+
+# The expected output looks like this, with varying numbers and
+# a "child-nop: exit(0)" line from each child:
+#
+# (bench-spawn) begin
+# (bench-spawn) fork+exec: 2150 kcycles/child
+# (bench-spawn) spawn: 610 kcycles/child
+# (bench-spawn) end
+
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+
+common_checks ("run", @output);
+
+my (@core) = get_core_output ("run", @output);
+fail "Missing \"begin\".\n" if !grep (/\(bench-spawn\) begin$/, @core);
+fail "Missing \"end\".\n" if !grep (/\(bench-spawn\) end$/, @core);
+
+foreach my $what ('fork+exec', 'spawn') {
+    fail "No measurement for \"$what\".\n"
+      if !grep (/^\(bench-spawn\) \Q$what\E: \d+ kcycles\/child$/, @core);
+}
+
+my ($children) = scalar (grep (/^child-nop: exit\(0\)$/, @core));
+fail "$children children exited cleanly, expected 40.\n"
+  if $children != 40;
+
+pass;
@@ -0,0 +1,55 @@
+/* Measures the round trip of system calls that do almost no
+   work, which is the cost of entering and leaving the kernel.
+
+   getpid(), tell() and seek() take the fast entry path, which
+   saves only the registers the handler may clobber.  An empty
+   syscall_stats() does as little work but always takes the full
+   path that builds a struct intr_frame.  Booting the kernel with
+   -no-fast-syscall sends every call down the full path, so
+   saving a run made that way as the baseline (`make bench-save
+   KERNELFLAGS=-no-fast-syscall') gives before and after numbers
+   for the same calls. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define ITERS 20000             /* Calls per measurement. */
+
+/* Prints the mean cost of one call, given CYCLES for ITERS. */
+static void
+report (const char *what, uint64_t cycles)
+{
+  msg ("%s: %llu cycles/call", what,
+       (unsigned long long) (cycles / ITERS));
+}
+
+void
+test_main (void)
+{
+  uint64_t start;
+  int handle;
+  int i;
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+
+  start = rdtsc ();
+  for (i = 0; i < ITERS; i++)
+    getpid ();
+  report ("getpid", rdtsc () - start);
+
+  start = rdtsc ();
+  for (i = 0; i < ITERS; i++)
+    tell (handle);
+  report ("tell", rdtsc () - start);
+
+  start = rdtsc ();
+  for (i = 0; i < ITERS; i++)
+    seek (handle, i);
+  report ("seek", rdtsc () - start);
+
+  start = rdtsc ();
+  for (i = 0; i < ITERS; i++)
+    syscall_stats (NULL, 0);
+  report ("empty syscall_stats, full path", rdtsc () - start);
+}
@@ -0,0 +1,32 @@
+# -*- perl -*-
+
+# The expected output looks like this, with varying numbers:
+#
+# (bench-syscall) begin
+# (bench-syscall) open "sample.txt"
+# (bench-syscall) getpid: 412 cycles/call
+# (bench-syscall) tell: 431 cycles/call
+# (bench-syscall) seek: 440 cycles/call
+# (bench-syscall) empty syscall_stats, full path: 690 cycles/call
+# (bench-syscall) end
+
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+
+common_checks ("run", @output);
+
+my (@core) = get_core_output ("run", @output);
+fail "Missing \"begin\".\n" if !grep (/\(bench-syscall\) begin$/, @core);
+fail "Missing \"end\".\n" if !grep (/\(bench-syscall\) end$/, @core);
+
+foreach my $what ('getpid', 'tell', 'seek',
+		  'empty syscall_stats, full path') {
+    fail "No measurement for \"$what\".\n"
+      if !grep (/^\(bench-syscall\) \Q$what\E: \d+ cycles\/call$/, @core);
+}
+
+pass;
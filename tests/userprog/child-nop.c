@@ -0,0 +1,9 @@
+/* Child process run by bench-spawn.  Exits at once without
+   printing anything, so that starting it is all that gets
+   measured. */
+
+int
+main (void) 
+{
+  return 0;
+}
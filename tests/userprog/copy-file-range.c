@@ -0,0 +1,40 @@
+/* Copies "sample.txt" into a new file with two copy_file_range()
+   calls, the second asking for more than is left, and checks the
+   result, both files' positions, and that copying a file onto an
+   overlapping range of itself is refused. */
+
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FIRST 100
+
+void
+test_main (void) 
+{
+  int in, out, byte_cnt;
+
+  CHECK (create ("test.txt", sizeof sample - 1), "create \"test.txt\"");
+  CHECK ((in = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK ((out = open ("test.txt")) > 1, "open \"test.txt\"");
+
+  byte_cnt = copy_file_range (in, out, FIRST);
+  if (byte_cnt != FIRST)
+    fail ("copy_file_range() returned %d instead of %d", byte_cnt, FIRST);
+  byte_cnt = copy_file_range (in, out, sizeof sample);
+  if (byte_cnt != sizeof sample - 1 - FIRST)
+    fail ("copy_file_range() returned %d instead of %zu",
+          byte_cnt, sizeof sample - 1 - FIRST);
+  if (tell (in) != sizeof sample - 1 || tell (out) != sizeof sample - 1)
+    fail ("positions are %u and %u after copying %zu bytes",
+          tell (in), tell (out), sizeof sample - 1);
+
+  seek (out, 0);
+  CHECK (copy_file_range (out, out, FIRST) == -1,
+         "copy \"test.txt\" onto itself");
+  close (in);
+  close (out);
+
+  check_file ("test.txt", sample, sizeof sample - 1);
+}
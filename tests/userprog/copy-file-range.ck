@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(copy-file-range) begin
+(copy-file-range) create "test.txt"
+(copy-file-range) open "sample.txt"
+(copy-file-range) open "test.txt"
+(copy-file-range) copy "test.txt" onto itself
+(copy-file-range) open "test.txt" for verification
+(copy-file-range) verified contents of "test.txt"
+(copy-file-range) close "test.txt"
+(copy-file-range) end
+copy-file-range: exit(0)
+EOF
+pass;
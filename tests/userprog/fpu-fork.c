@@ -0,0 +1,120 @@
+/* Checks that each process keeps its own SSE registers.  The
+   parent fills xmm0-xmm15 and forks.  The child checks that it
+   inherited the parent's values, loads its own, and then the two
+   take turns with yield(), each checking after every switch that
+   nobody else's values have leaked into its registers. */
+
+#include <stdint.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SWITCHES 100
+
+/* Values for xmm0-xmm15, two 64-bit halves each. */
+typedef uint64_t xmm_regs[32];
+
+/* Fills V with a pattern based on SEED. */
+static void
+make_regs (xmm_regs v, uint64_t seed)
+{
+  int i;
+
+  for (i = 0; i < 32; i++)
+    v[i] = seed * 0x0101010101010101ULL + i;
+}
+
+static void
+load_regs (const xmm_regs v)
+{
+  asm volatile ("movdqu 0(%0), %%xmm0\n\t"
+                "movdqu 16(%0), %%xmm1\n\t"
+                "movdqu 32(%0), %%xmm2\n\t"
+                "movdqu 48(%0), %%xmm3\n\t"
+                "movdqu 64(%0), %%xmm4\n\t"
+                "movdqu 80(%0), %%xmm5\n\t"
+                "movdqu 96(%0), %%xmm6\n\t"
+                "movdqu 112(%0), %%xmm7\n\t"
+                "movdqu 128(%0), %%xmm8\n\t"
+                "movdqu 144(%0), %%xmm9\n\t"
+                "movdqu 160(%0), %%xmm10\n\t"
+                "movdqu 176(%0), %%xmm11\n\t"
+                "movdqu 192(%0), %%xmm12\n\t"
+                "movdqu 208(%0), %%xmm13\n\t"
+                "movdqu 224(%0), %%xmm14\n\t"
+                "movdqu 240(%0), %%xmm15"
+                : : "r" (v) : "memory");
+}
+
+static void
+store_regs (xmm_regs v)
+{
+  asm volatile ("movdqu %%xmm0, 0(%0)\n\t"
+                "movdqu %%xmm1, 16(%0)\n\t"
+                "movdqu %%xmm2, 32(%0)\n\t"
+                "movdqu %%xmm3, 48(%0)\n\t"
+                "movdqu %%xmm4, 64(%0)\n\t"
+                "movdqu %%xmm5, 80(%0)\n\t"
+                "movdqu %%xmm6, 96(%0)\n\t"
+                "movdqu %%xmm7, 112(%0)\n\t"
+                "movdqu %%xmm8, 128(%0)\n\t"
+                "movdqu %%xmm9, 144(%0)\n\t"
+                "movdqu %%xmm10, 160(%0)\n\t"
+                "movdqu %%xmm11, 176(%0)\n\t"
+                "movdqu %%xmm12, 192(%0)\n\t"
+                "movdqu %%xmm13, 208(%0)\n\t"
+                "movdqu %%xmm14, 224(%0)\n\t"
+                "movdqu %%xmm15, 240(%0)"
+                : : "r" (v) : "memory");
+}
+
+/* Fails with message WHO if the registers do not hold EXPECT. */
+static void
+check_regs (const xmm_regs expect, const char *who)
+{
+  xmm_regs actual;
+  int i;
+
+  store_regs (actual);
+  for (i = 0; i < 32; i++)
+    if (actual[i] != expect[i])
+      fail ("%s: xmm%d is %llx, not %llx", who, i / 2,
+            (unsigned long long) actual[i], (unsigned long long) expect[i]);
+}
+
+void
+test_main (void)
+{
+  xmm_regs parent, child;
+  pid_t pid;
+  int i;
+
+  make_regs (parent, 1);
+  make_regs (child, 2);
+  load_regs (parent);
+
+  pid = fork ("fpu-child");
+  if (pid == 0)
+    {
+      check_regs (parent, "child after fork");
+      load_regs (child);
+      for (i = 0; i < SWITCHES; i++)
+        {
+          yield ();
+          check_regs (child, "child");
+        }
+      exit (0);
+    }
+  if (pid < 0)
+    fail ("fork() returned %d", pid);
+
+  for (i = 0; i < SWITCHES; i++)
+    {
+      yield ();
+      check_regs (parent, "parent");
+    }
+  if (wait (pid) != 0)
+    fail ("child failed");
+  check_regs (parent, "parent after wait");
+  msg ("registers intact");
+}
@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(fpu-fork) begin
+fpu-child: exit(0)
+(fpu-fork) registers intact
+(fpu-fork) end
+fpu-fork: exit(0)
+EOF
+pass;
@@ -0,0 +1,91 @@
+/* Sets up a batched I/O ring, opens "sample.txt" through it,
+   then reads the file in one batch of several operations and
+   checks each completion and the data read. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define RING_ADDR ((void *) 0x20000000)
+
+static struct io_ring *ring;
+
+/* Queues an operation. */
+static void
+queue (int op, int fd, void *addr, unsigned len, int off, uint64_t user_data)
+{
+  struct io_sqe *sqe = &ring->sqes[ring->sq_tail % IORING_ENTRIES];
+
+  memset (sqe, 0, sizeof *sqe);
+  sqe->op = op;
+  sqe->fd = fd;
+  sqe->addr = (uintptr_t) addr;
+  sqe->len = len;
+  sqe->off = off;
+  sqe->user_data = user_data;
+  ring->sq_tail++;
+}
+
+/* Takes the next completion, checks it, and returns its result. */
+static int64_t
+reap (uint64_t user_data)
+{
+  struct io_cqe *cqe;
+
+  if (ring->cq_head == ring->cq_tail)
+    fail ("no completion for %lld", (long long) user_data);
+  cqe = &ring->cqes[ring->cq_head++ % IORING_ENTRIES];
+  if (cqe->user_data != user_data)
+    fail ("completion for %lld, expected %lld",
+          (long long) cqe->user_data, (long long) user_data);
+  return cqe->res;
+}
+
+void
+test_main (void) 
+{
+  char head[10], rest[sizeof sample], again[10];
+  int fd;
+
+  CHECK (ioring_setup ((char *) RING_ADDR + 1) == NULL,
+         "ioring_setup() at unaligned address fails");
+  CHECK ((ring = ioring_setup (RING_ADDR)) == RING_ADDR, "ioring_setup()");
+  CHECK (ioring_setup ((char *) RING_ADDR + 4096) == NULL,
+         "second ioring_setup() fails");
+  CHECK (ioring_enter (8) == 0, "ioring_enter() with nothing queued");
+
+  queue (IORING_OP_OPEN, 0, (void *) "sample.txt", 0, 0, 1);
+  CHECK (ioring_enter (1) == 1, "ioring_enter() one open");
+  fd = reap (1);
+  if (fd < 2)
+    fail ("open through ring returned %d", fd);
+
+  queue (IORING_OP_PREAD, fd, head, sizeof head, 0, 2);
+  queue (IORING_OP_READ, fd, rest, sizeof sample - 1, 0, 3);
+  queue (IORING_OP_SEEK, fd, NULL, 0, 0, 4);
+  queue (IORING_OP_READ, fd, again, sizeof again, 0, 5);
+  queue (IORING_OP_CLOSE, fd, NULL, 0, 0, 6);
+  queue (IORING_OP_READ, fd, again, sizeof again, 0, 7);
+  queue (IORING_OP_NOP, 0, NULL, 0, 0, 8);
+  CHECK (ioring_enter (16) == 7, "ioring_enter() seven operations");
+
+  if (reap (2) != sizeof head || memcmp (head, sample, sizeof head))
+    fail ("pread through ring failed");
+  if (reap (3) != sizeof sample - 1 || memcmp (rest, sample, sizeof sample - 1))
+    fail ("read through ring failed");
+  if (reap (4) != 0)
+    fail ("seek through ring failed");
+  if (reap (5) != sizeof again || memcmp (again, sample, sizeof again))
+    fail ("read after seek through ring failed");
+  if (reap (6) != 0)
+    fail ("close through ring failed");
+  if (reap (7) != -1)
+    fail ("read of closed fd through ring succeeded");
+  if (reap (8) != 0)
+    fail ("nop through ring failed");
+  if (ring->cq_head != ring->cq_tail)
+    fail ("extra completions");
+  msg ("completions as expected");
+}
@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(ioring-normal) begin
+(ioring-normal) ioring_setup() at unaligned address fails
+(ioring-normal) ioring_setup()
+(ioring-normal) second ioring_setup() fails
+(ioring-normal) ioring_enter() with nothing queued
+(ioring-normal) ioring_enter() one open
+(ioring-normal) ioring_enter() seven operations
+(ioring-normal) completions as expected
+(ioring-normal) end
+ioring-normal: exit(0)
+EOF
+pass;
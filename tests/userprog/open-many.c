@@ -0,0 +1,49 @@
+/* Opens "sample.txt" many times, enough to make the kernel grow
+   the file descriptor table, and checks that each open returns
+   the lowest free descriptor.  Then forks and checks that the
+   child has every descriptor, with file positions of its own. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_CNT 200
+
+static int fds[FILE_CNT];
+
+void
+test_main (void) 
+{
+  char buf[10];
+  pid_t pid;
+  int i;
+
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      fds[i] = open ("sample.txt");
+      if (fds[i] != i + 2)
+        fail ("open #%d returned %d, not %d", i, fds[i], i + 2);
+    }
+  msg ("opened \"sample.txt\" %d times", FILE_CNT);
+
+  close (fds[100]);
+  CHECK (open ("sample.txt") == fds[100], "reopen reuses closed fd");
+
+  CHECK (read (fds[150], buf, 10) == 10, "read from fd %d", fds[150]);
+  if ((pid = fork ("child")) == 0)
+    {
+      CHECK (read (fds[150], buf, 10) == 10, "child read");
+      if (memcmp (buf, sample + 10, 10))
+        fail ("child read wrong data");
+      CHECK (filesize (fds[FILE_CNT - 1]) == sizeof sample - 1,
+             "child filesize of last fd");
+      exit (0);
+    }
+  CHECK (wait (pid) == 0, "wait for child");
+
+  CHECK (read (fds[150], buf, 10) == 10, "parent read");
+  if (memcmp (buf, sample + 10, 10))
+    fail ("child's read moved parent's position");
+}
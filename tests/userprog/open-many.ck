@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(open-many) begin
+(open-many) opened "sample.txt" 200 times
+(open-many) reopen reuses closed fd
+(open-many) read from fd 152
+(open-many) child read
+(open-many) child filesize of last fd
+child: exit(0)
+(open-many) wait for child
+(open-many) parent read
+(open-many) end
+open-many: exit(0)
+EOF
+pass;
@@ -0,0 +1,43 @@
+/* Reads "sample.txt" a chunk at a time with pread(), in
+   shuffled order, and checks that every chunk matches and that
+   the file position never moved. */
+
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define CHUNK_SIZE 37
+#define CHUNK_CNT ((sizeof sample - 1 + CHUNK_SIZE - 1) / CHUNK_SIZE)
+
+void
+test_main (void) 
+{
+  char buf[sizeof sample];
+  size_t order[CHUNK_CNT];
+  int handle;
+  size_t i;
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+
+  for (i = 0; i < CHUNK_CNT; i++)
+    order[i] = i;
+  shuffle (order, CHUNK_CNT, sizeof *order);
+  for (i = 0; i < CHUNK_CNT; i++)
+    {
+      size_t ofs = order[i] * CHUNK_SIZE;
+      int byte_cnt = pread (handle, buf + ofs, CHUNK_SIZE, ofs);
+      int expected = ofs + CHUNK_SIZE <= sizeof sample - 1
+                     ? CHUNK_SIZE : (int) (sizeof sample - 1 - ofs);
+
+      if (byte_cnt != expected)
+        fail ("pread() at offset %zu returned %d instead of %d",
+              ofs, byte_cnt, expected);
+    }
+  compare_bytes (buf, sample, sizeof sample - 1, 0, "sample.txt");
+
+  if (tell (handle) != 0)
+    fail ("pread() moved the file position to %u", tell (handle));
+  if (pread (handle, buf, 1, sizeof sample - 1) != 0)
+    fail ("pread() at end of file read something");
+}
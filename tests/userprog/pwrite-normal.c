@@ -0,0 +1,37 @@
+/* Writes "sample.txt"'s contents to a new file a chunk at a
+   time with pwrite(), last chunk first, checks that the file
+   position never moved, and then checks the file. */
+
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define CHUNK_SIZE 37
+
+void
+test_main (void) 
+{
+  int handle;
+  int ofs;
+
+  CHECK (create ("test.txt", sizeof sample - 1), "create \"test.txt\"");
+  CHECK ((handle = open ("test.txt")) > 1, "open \"test.txt\"");
+
+  for (ofs = (sizeof sample - 2) / CHUNK_SIZE * CHUNK_SIZE; ofs >= 0;
+       ofs -= CHUNK_SIZE)
+    {
+      int expected = ofs + CHUNK_SIZE <= (int) sizeof sample - 1
+                     ? CHUNK_SIZE : (int) sizeof sample - 1 - ofs;
+      int byte_cnt = pwrite (handle, sample + ofs, expected, ofs);
+
+      if (byte_cnt != expected)
+        fail ("pwrite() at offset %d returned %d instead of %d",
+              ofs, byte_cnt, expected);
+    }
+  if (tell (handle) != 0)
+    fail ("pwrite() moved the file position to %u", tell (handle));
+  close (handle);
+
+  check_file ("test.txt", sample, sizeof sample - 1);
+}
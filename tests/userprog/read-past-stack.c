@@ -0,0 +1,33 @@
+/* In a child process, reads from a file into a buffer that
+   starts 10 bytes below the top of the user stack, so that all
+   but its first few bytes are unmapped.  The child must be
+   terminated with exit code -1.  The parent then writes to the
+   same file, which hangs if the kernel left the child's read
+   holding a lock on it. */
+
+#include <stdint.h>
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  int handle;
+  pid_t pid;
+
+  if ((pid = fork ("child")) == 0)
+    {
+      char *top = (char *) (((uintptr_t) &handle + 4095) & ~(uintptr_t) 4095);
+
+      CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+      read (handle, top - 10, 100);
+      fail ("should not have survived read()");
+    }
+  CHECK (wait (pid) == -1, "wait for child");
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK (write (handle, sample, sizeof sample - 1) == sizeof sample - 1,
+         "write \"sample.txt\"");
+}
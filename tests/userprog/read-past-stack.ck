@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(read-past-stack) begin
+(read-past-stack) open "sample.txt"
+child: exit(-1)
+(read-past-stack) wait for child
+(read-past-stack) open "sample.txt"
+(read-past-stack) write "sample.txt"
+(read-past-stack) end
+read-past-stack: exit(0)
+EOF
+pass;
@@ -0,0 +1,44 @@
+/* Reads "sample.txt" with readv() into buffers of uneven sizes,
+   including an empty one, and checks that they hold the file's
+   contents in order and that the file position moved past
+   them. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  char a[10], b[100], c[sizeof sample];
+  struct iovec iov[4];
+  int handle, byte_cnt;
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+
+  iov[0].iov_base = a;
+  iov[0].iov_len = sizeof a;
+  iov[1].iov_base = NULL;
+  iov[1].iov_len = 0;
+  iov[2].iov_base = b;
+  iov[2].iov_len = sizeof b;
+  iov[3].iov_base = c;
+  iov[3].iov_len = sizeof c;
+  byte_cnt = readv (handle, iov, 4);
+  if (byte_cnt != sizeof sample - 1)
+    fail ("readv() returned %d instead of %zu", byte_cnt, sizeof sample - 1);
+
+  compare_bytes (a, sample, sizeof a, 0, "sample.txt");
+  compare_bytes (b, sample + sizeof a, sizeof b, sizeof a, "sample.txt");
+  compare_bytes (c, sample + sizeof a + sizeof b,
+                 sizeof sample - 1 - sizeof a - sizeof b,
+                 sizeof a + sizeof b, "sample.txt");
+
+  if (tell (handle) != sizeof sample - 1)
+    fail ("tell() returned %u after readv()", tell (handle));
+  byte_cnt = readv (handle, iov, 4);
+  if (byte_cnt != 0)
+    fail ("readv() at end of file returned %d", byte_cnt);
+}
@@ -0,0 +1,17 @@
+/* Tests argument passing to a child started with spawn(),
+   including an argument with a space in it, which exec() has no
+   way to pass. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  char *argv[] = {"child-args", "spawn", "with space", NULL};
+  pid_t pid;
+
+  CHECK ((pid = spawn ("child-args", argv)) > 0, "spawn child-args");
+  msg ("wait(spawn()) = %d", wait (pid));
+}
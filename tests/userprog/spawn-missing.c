@@ -0,0 +1,13 @@
+/* Tries to spawn a nonexistent program.
+   The spawn system call must return -1, and the caller must
+   keep running. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  msg ("spawn(\"no-such-file\"): %d", spawn ("no-such-file", NULL));
+}
@@ -0,0 +1,42 @@
+/* Makes a known number of filesize() calls and checks that
+   syscall_stats() counted them, with sane latencies. */
+
+#include <syscall.h>
+#include <syscall-nr.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define CALL_CNT 100
+
+static struct syscall_stat before[64], after[64];
+
+void
+test_main (void) 
+{
+  const struct syscall_stat *s;
+  int cnt, i;
+
+  cnt = syscall_stats (before, 64);
+  if (cnt <= SYS_SYSCALL_STATS || cnt > 64)
+    fail ("syscall_stats() returned %d", cnt);
+  for (i = 0; i < CALL_CNT; i++)
+    filesize (1000);
+  if (syscall_stats (after, 64) != cnt)
+    fail ("syscall_stats() changed its count");
+
+  if (after[SYS_FILESIZE].cnt - before[SYS_FILESIZE].cnt != CALL_CNT)
+    fail ("%d filesize() calls counted as %lld", CALL_CNT,
+          after[SYS_FILESIZE].cnt - before[SYS_FILESIZE].cnt);
+  if (after[SYS_SYSCALL_STATS].cnt < 2)
+    fail ("syscall_stats() did not count itself");
+  msg ("filesize() counted %d times", CALL_CNT);
+
+  s = &after[SYS_FILESIZE];
+  if (s->p50 > s->p99 || s->p99 > s->max || s->mean > s->max)
+    fail ("bad latencies: mean %lld, p50 %lld, p99 %lld, max %lld",
+          s->mean, s->p50, s->p99, s->max);
+  msg ("latencies in order");
+
+  if (syscall_stats (after, 0) != cnt)
+    fail ("0-entry syscall_stats() did not return the count");
+}
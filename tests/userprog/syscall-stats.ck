@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(syscall-stats) begin
+(syscall-stats) filesize() counted 100 times
+(syscall-stats) latencies in order
+(syscall-stats) end
+syscall-stats: exit(0)
+EOF
+pass;
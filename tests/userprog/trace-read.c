@@ -0,0 +1,47 @@
+/* Reads the scheduler trace and checks that it holds whole
+   events in time order, at least one of which is a context
+   switch (booting this process takes several). */
+
+#include <stdint.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+/* Must match struct trace_event in threads/trace.h. */
+struct trace_event
+  {
+    uint64_t tsc;
+    uint16_t tid;
+    uint16_t other;
+    uint8_t type;
+    uint8_t arg;
+    uint16_t reserved;
+  };
+
+static struct trace_event events[64];
+
+void
+test_main (void) 
+{
+  int byte_cnt, cnt, switches, i;
+
+  byte_cnt = trace_read (events, sizeof events);
+  if (byte_cnt <= 0 || byte_cnt % sizeof *events != 0)
+    fail ("trace_read() returned %d", byte_cnt);
+  cnt = byte_cnt / sizeof *events;
+
+  switches = 0;
+  for (i = 0; i < cnt; i++)
+    {
+      if (i > 0 && events[i].tsc < events[i - 1].tsc)
+        fail ("event %d happened before event %d", i, i - 1);
+      if (events[i].type == 0)
+        switches++;
+    }
+  if (switches == 0)
+    fail ("no context switches in %d events", cnt);
+  msg ("trace_read() returned events in order");
+
+  if (trace_read (events, 0) != 0)
+    fail ("0-byte trace_read() did not return 0");
+}
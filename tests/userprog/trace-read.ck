@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(trace-read) begin
+(trace-read) trace_read() returned events in order
+(trace-read) end
+trace-read: exit(0)
+EOF
+pass;
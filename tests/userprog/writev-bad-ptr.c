@@ -0,0 +1,40 @@
+/* Passes writev() a vector whose first buffer is fine but whose
+   second points into kernel space, in a child process.  The
+   child must be terminated with exit code -1, and since every
+   buffer in the vector is checked against the kernel boundary
+   before anything is written, the file must be left
+   untouched. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  char zeros[16], buf[16];
+  struct iovec iov[2];
+  int handle;
+  pid_t pid;
+
+  memset (zeros, 0, sizeof zeros);
+  CHECK (create ("test.txt", sizeof buf), "create \"test.txt\"");
+
+  if ((pid = fork ("child")) == 0)
+    {
+      CHECK ((handle = open ("test.txt")) > 1, "open \"test.txt\"");
+      iov[0].iov_base = "good";
+      iov[0].iov_len = 4;
+      iov[1].iov_base = (char *) 0x8004000000;
+      iov[1].iov_len = 123;
+      writev (handle, iov, 2);
+      fail ("should not have survived writev()");
+    }
+  CHECK (wait (pid) == -1, "wait for child");
+
+  CHECK ((handle = open ("test.txt")) > 1, "open \"test.txt\"");
+  if (read (handle, buf, sizeof buf) != sizeof buf)
+    fail ("read() of \"test.txt\" came up short");
+  compare_bytes (buf, zeros, sizeof buf, 0, "test.txt");
+}
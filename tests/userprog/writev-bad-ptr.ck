@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(writev-bad-ptr) begin
+(writev-bad-ptr) create "test.txt"
+(writev-bad-ptr) open "test.txt"
+child: exit(-1)
+(writev-bad-ptr) wait for child
+(writev-bad-ptr) open "test.txt"
+(writev-bad-ptr) end
+writev-bad-ptr: exit(0)
+EOF
+pass;
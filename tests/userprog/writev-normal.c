@@ -0,0 +1,31 @@
+/* Writes "sample.txt"'s contents to a new file with a single
+   writev() of a header and two payload pieces, then checks the
+   file. */
+
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  struct iovec iov[3];
+  int handle, byte_cnt;
+
+  CHECK (create ("test.txt", sizeof sample - 1), "create \"test.txt\"");
+  CHECK ((handle = open ("test.txt")) > 1, "open \"test.txt\"");
+
+  iov[0].iov_base = sample;
+  iov[0].iov_len = 1;
+  iov[1].iov_base = sample + 1;
+  iov[1].iov_len = 99;
+  iov[2].iov_base = sample + 100;
+  iov[2].iov_len = sizeof sample - 1 - 100;
+  byte_cnt = writev (handle, iov, 3);
+  if (byte_cnt != sizeof sample - 1)
+    fail ("writev() returned %d instead of %zu", byte_cnt, sizeof sample - 1);
+  close (handle);
+
+  check_file ("test.txt", sample, sizeof sample - 1);
+}
@@ -0,0 +1,294 @@
+#include "threads/cpu.h"
+#include <debug.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/lapic.h"
+#include "devices/timer.h"
+#include "threads/fpu.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/mmu.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#ifdef USERPROG
+#include "userprog/gdt.h"
+#include "userprog/syscall.h"
+#include "userprog/tss.h"
+#endif
+#include "intrinsic.h"
+
+/* Multiprocessor startup.
+
+   The CPUs are found in the MP configuration table that the BIOS
+   leaves in low memory for the Intel MultiProcessor Specification
+   [MP].  smp_init() starts each application processor (AP) in
+   turn through its local APIC.  An AP runs the trampoline in
+   ap-start.S into long mode and then ap_main(), which loads the
+   kernel's descriptor tables and control registers and settles
+   into the idle thread that smp_init() made for it, with a run
+   queue of its own.
+
+   Each CPU schedules from its own run queue, under its own
+   spinlock, so another CPU can hand it a thread and wake it with
+   an IPI.  New threads go on the run queue of the CPU that made
+   them. */
+
+struct cpu cpus[CPU_MAX];
+unsigned cpu_cnt;
+bool smp_disabled;
+
+/* Physical address that the trampoline is copied to.  It must be
+   page-aligned and below 1 MB, since the start-up IPI carries its
+   page number. */
+#define AP_START 0x8000
+
+/* Set up by smp_init() for the AP being started, for ap-start.S. */
+uint64_t ap_boot_cr3;                   /* base_pml4. */
+uint64_t ap_boot_stack;                 /* Top of its idle thread's page. */
+struct desc_ptr ap_boot_gdt;            /* The BSP's GDT. */
+static uint64_t ap_boot_cr4;            /* The BSP's CR4. */
+
+/* Trampoline, in ap-start.S. */
+extern const char ap_start[], ap_start_end[];
+
+/* MP floating pointer structure, [MP] 4.1. */
+struct mp_fps {
+	char signature[4];                  /* "_MP_". */
+	uint32_t config;                    /* Configuration table address. */
+	uint8_t length;                     /* In 16-byte units. */
+	uint8_t spec_rev;
+	uint8_t checksum;                   /* Makes all bytes sum to 0. */
+	uint8_t type;                       /* Default configuration, or 0. */
+	uint8_t features[4];
+} __attribute__ ((packed));
+
+/* MP configuration table header, [MP] 4.2. */
+struct mp_config {
+	char signature[4];                  /* "PCMP". */
+	uint16_t length;                    /* Including the entries. */
+	uint8_t spec_rev;
+	uint8_t checksum;                   /* Makes all bytes sum to 0. */
+	char oem_id[8];
+	char product_id[12];
+	uint32_t oem_table;
+	uint16_t oem_table_size;
+	uint16_t entry_cnt;
+	uint32_t lapic_addr;                /* Local APICs' physical address. */
+	uint16_t ext_length;
+	uint8_t ext_checksum;
+	uint8_t reserved;
+} __attribute__ ((packed));
+
+/* MP configuration table processor entry, [MP] 4.3.1.  Entries of
+   every other type are 8 bytes long. */
+#define MP_PROC 0
+#define MP_PROC_ENABLED 0x01
+#define MP_PROC_BSP 0x02
+struct mp_proc {
+	uint8_t type;                       /* MP_PROC. */
+	uint8_t apic_id;                    /* Local APIC ID. */
+	uint8_t apic_version;
+	uint8_t flags;                      /* MP_PROC_* bits. */
+	uint32_t signature;
+	uint32_t features;
+	uint64_t reserved;
+} __attribute__ ((packed));
+#define MP_ENTRY_SIZE 8
+
+void ap_main (void) NO_RETURN;
+static void init_cpu (struct cpu *, unsigned id, uint8_t apic_id);
+static struct mp_config *mp_find_config (void);
+static bool start_ap (uint8_t apic_id);
+static intr_handler_func resched_interrupt;
+
+/* Sets up cpus[0] for the BSP and returns it.  Called by
+   thread_init(), before any other CPU is running. */
+struct cpu *
+cpu_init_bsp (void) {
+	init_cpu (&cpus[0], 0, 0);
+	cpus[0].online = true;
+	cpu_cnt = 1;
+	return &cpus[0];
+}
+
+/* Returns the running CPU.  Interrupts should be off, or the
+   answer may be stale by the time the caller looks at it. */
+struct cpu *
+cpu_current (void) {
+	return ((struct thread *) pg_round_down (rrsp ()))->cpu;
+}
+
+/* Finds the other CPUs and starts them.  Interrupts must be on,
+   since starting a CPU takes a few timer ticks. */
+void
+smp_init (void) {
+	struct mp_config *mpc;
+	uint8_t *p, *end;
+	unsigned found = 1;
+
+	ASSERT (intr_get_level () == INTR_ON);
+
+	mpc = mp_find_config ();
+	if (mpc == NULL) {
+		printf ("SMP: no MP configuration table, 1 CPU online\n");
+		return;
+	}
+	lapic_init (mpc->lapic_addr);
+	cpus[0].apic_id = lapic_id ();
+	timer_lapic_init ();
+	intr_register_ext (LAPIC_VEC_RESCHED, resched_interrupt,
+			"Reschedule IPI");
+
+	memcpy (ptov (AP_START), ap_start, ap_start_end - ap_start);
+	ap_boot_cr3 = vtop (base_pml4);
+	ap_boot_cr4 = rcr4 ();
+	asm volatile ("sgdt %0" : "=m" (ap_boot_gdt));
+
+	p = (uint8_t *) (mpc + 1);
+	end = (uint8_t *) mpc + mpc->length;
+	while (p < end) {
+		struct mp_proc *proc = (struct mp_proc *) p;
+
+		if (proc->type != MP_PROC) {
+			p += MP_ENTRY_SIZE;
+			continue;
+		}
+		p += sizeof *proc;
+
+		if (!(proc->flags & MP_PROC_ENABLED)
+				|| proc->apic_id == cpus[0].apic_id)
+			continue;
+		found++;
+		if (smp_disabled || cpu_cnt == CPU_MAX)
+			continue;
+		if (!start_ap (proc->apic_id)) {
+			/* It may yet come up on its own and take over the
+			   slot, so do not reuse the slot for another one. */
+			printf ("SMP: CPU with APIC ID %u did not start\n",
+					proc->apic_id);
+			smp_disabled = true;
+		}
+	}
+
+	printf ("SMP: %u of %u CPUs online\n", cpu_cnt, found);
+}
+
+/* Starts the AP whose local APIC ID is APIC_ID as cpus[cpu_cnt]
+   and waits for it to come online.  Returns true if it does. */
+static bool
+start_ap (uint8_t apic_id) {
+	struct cpu *c = &cpus[cpu_cnt];
+	struct thread *idle;
+	int64_t start;
+
+	init_cpu (c, cpu_cnt, apic_id);
+	idle = thread_create_idle (c);
+	if (idle == NULL)
+		return false;
+	ap_boot_stack = (uint64_t) idle + PGSIZE;
+
+	lapic_start_ap (apic_id, AP_START);
+	start = timer_ticks ();
+	while (!c->online && timer_elapsed (start) < TIMER_FREQ / 10)
+		timer_sleep (1);
+	if (!c->online)
+		return false;
+
+	cpu_cnt++;
+	return true;
+}
+
+/* C entry point of an AP, from ap_entry in ap-start.S, running on
+   its idle thread's stack with interrupts off and the kernel's
+   page table and GDT loaded. */
+void
+ap_main (void) {
+	struct cpu *c = cpu_current ();
+
+	intr_init_ap ();
+	lcr4 (ap_boot_cr4);
+	fpu_init_ap ();
+	lapic_init_ap ();
+	timer_init_ap ();
+#ifdef USERPROG
+	tss_init ();
+	gdt_init_ap ();
+	syscall_init_ap ();
+#endif
+
+	c->online = true;
+	thread_start_ap ();
+}
+
+/* Interrupt sent by another CPU that has put a thread on our run
+   queue. */
+static void
+resched_interrupt (struct intr_frame *f UNUSED) {
+	intr_yield_on_return ();
+}
+
+/* Initializes C as the CPU with index ID and local APIC ID
+   APIC_ID, not yet online. */
+static void
+init_cpu (struct cpu *c, unsigned id, uint8_t apic_id) {
+	memset (c, 0, sizeof *c);
+	c->id = id;
+	c->apic_id = apic_id;
+	spinlock_init (&c->rq_lock);
+	list_init (&c->ready_list);
+	list_init (&c->destruction_req);
+}
+
+/* Returns true if the SIZE bytes at P sum to 0. */
+static bool
+checksum_ok (const void *p, size_t size) {
+	const uint8_t *b = p;
+	uint8_t sum = 0;
+
+	while (size-- > 0)
+		sum += *b++;
+	return sum == 0;
+}
+
+/* Looks for the MP floating pointer structure in the SIZE bytes
+   at physical address PA. */
+static struct mp_fps *
+mp_search (uint64_t pa, size_t size) {
+	uint8_t *p = ptov (pa);
+	uint8_t *end = p + size;
+
+	for (; p + sizeof (struct mp_fps) <= end; p += 16) {
+		struct mp_fps *fps = (struct mp_fps *) p;
+		if (!memcmp (fps->signature, "_MP_", 4)
+				&& checksum_ok (fps, sizeof *fps))
+			return fps;
+	}
+	return NULL;
+}
+
+/* Returns the MP configuration table, or a null pointer if the
+   BIOS did not provide one.  [MP] 4 says the floating pointer is
+   in the first kB of the extended BIOS data area, or the last kB
+   of base memory, or the BIOS ROM. */
+static struct mp_config *
+mp_find_config (void) {
+	uint64_t ebda = (uint64_t) *(uint16_t *) ptov (0x40e) << 4;
+	uint64_t base_end = (uint64_t) *(uint16_t *) ptov (0x413) * 1024;
+	struct mp_fps *fps = NULL;
+	struct mp_config *mpc;
+
+	if (ebda != 0)
+		fps = mp_search (ebda, 1024);
+	if (fps == NULL && base_end >= 1024)
+		fps = mp_search (base_end - 1024, 1024);
+	if (fps == NULL)
+		fps = mp_search (0xf0000, 0x10000);
+	if (fps == NULL || fps->config == 0)
+		return NULL;
+
+	mpc = ptov (fps->config);
+	if (memcmp (mpc->signature, "PCMP", 4)
+			|| !checksum_ok (mpc, mpc->length))
+		return NULL;
+	return mpc;
+}
@@ -0,0 +1,260 @@
+#include "threads/fpu.h"
+#include <debug.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/cpu.h"
+#include "threads/interrupt.h"
+#include "threads/palloc.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#ifdef USERPROG
+#include "userprog/syscall.h"
+#endif
+#include "intrinsic.h"
+
+/* Lazy x87/SSE context switching.
+
+   The kernel itself is built without floating point, so only user
+   code touches the FPU, and most threads never do.  Rather than
+   save and restore FPU registers on every switch, the registers
+   are left holding the state of one thread, the CPU's FPU_OWNER.
+   Switching to any other thread sets CR0.TS, so that its first
+   FPU instruction raises #NM.  The #NM handler saves the owner's
+   registers into the owner's state area, loads the current
+   thread's, clears TS and makes it the owner.  A thread that
+   never uses the FPU costs at most a CR0 write per switch, and
+   one that uses it while nobody else does never traps at all.
+
+   Each thread's state area is a page allocated on its first #NM,
+   which also loads it from INIT_STATE, a clean FPU image.  State
+   is kept with XSAVE for every component the CPU has among x87,
+   SSE and AVX, or with FXSAVE if XSAVE is missing.
+
+   Every CPU has its own registers, so FPU_OWNER and the cached
+   CR0.TS live in struct cpu.  A thread whose state is loaded on
+   one CPU must not run on another until it is saved, so the load
+   balancer leaves such threads alone (see fpu_loaded()). */
+
+#define CR0_MP (1 << 1)                 /* Monitor coprocessor. */
+#define CR0_EM (1 << 2)                 /* Emulate FPU. */
+#define CR0_TS (1 << 3)                 /* Task switched. */
+#define CR0_NE (1 << 5)                 /* Native FPU errors. */
+#define CR4_OSFXSR (1 << 9)             /* FXSAVE and SSE enabled. */
+#define CR4_OSXMMEXCPT (1 << 10)        /* SSE errors raise #XF. */
+#define CR4_OSXSAVE (1 << 18)           /* XSAVE enabled. */
+#define CPUID_1_ECX_XSAVE (1 << 26)
+#define CPUID_1_ECX_AVX (1 << 28)
+#define XCR0_X87 (1 << 0)
+#define XCR0_SSE (1 << 1)
+#define XCR0_AVX (1 << 2)
+#define FXSAVE_SIZE 512
+
+static uint64_t xsave_mask;             /* Components saved, 0 for FXSAVE. */
+static size_t state_size;               /* Bytes in a state area. */
+static uint8_t init_state[PGSIZE] __attribute__ ((aligned (64)));
+
+/* Statistics. */
+static long long trap_cnt;              /* #NM exceptions. */
+static long long save_cnt;              /* States saved to make room. */
+
+static void fpu_trap (struct intr_frame *);
+
+/* Saves the FPU registers into AREA.  CR0.TS must be clear. */
+static void
+save (void *area) {
+	if (xsave_mask != 0)
+		xsave (area, xsave_mask);
+	else
+		fxsave (area);
+}
+
+/* Loads the FPU registers from AREA.  CR0.TS must be clear. */
+static void
+restore (const void *area) {
+	if (xsave_mask != 0)
+		xrstor (area, xsave_mask);
+	else
+		fxrstor (area);
+}
+
+/* Sets CR0.TS to TS, if it is not already. */
+static void
+set_ts (bool ts) {
+	struct cpu *c = cpu_current ();
+
+	if (ts == c->fpu_ts)
+		return;
+	if (ts)
+		lcr0 (rcr0 () | CR0_TS);
+	else
+		clts ();
+	c->fpu_ts = ts;
+}
+
+/* Enables the FPU and SSE, and XSAVE if the CPU has it, records a
+   clean FPU state, and takes over #NM. */
+void
+fpu_init (void) {
+	uint32_t regs[4];
+
+	lcr0 ((rcr0 () & ~(CR0_EM | CR0_TS)) | CR0_MP | CR0_NE);
+	lcr4 (rcr4 () | CR4_OSFXSR | CR4_OSXMMEXCPT);
+
+	cpuid (1, 0, regs);
+	if (regs[2] & CPUID_1_ECX_XSAVE) {
+		xsave_mask = XCR0_X87 | XCR0_SSE;
+		if (regs[2] & CPUID_1_ECX_AVX)
+			xsave_mask |= XCR0_AVX;
+		lcr4 (rcr4 () | CR4_OSXSAVE);
+		xsetbv (0, xsave_mask);
+
+		/* EBX is the size for the components enabled in XCR0. */
+		cpuid (0xd, 0, regs);
+		state_size = regs[1];
+		if (state_size > PGSIZE) {
+			xsave_mask = 0;
+			state_size = FXSAVE_SIZE;
+		}
+	} else
+		state_size = FXSAVE_SIZE;
+
+	asm volatile ("fninit");
+	save (init_state);
+
+	cpu_current ()->fpu_ts = false;
+	set_ts (true);
+	intr_register_int (7, 0, INTR_OFF, fpu_trap,
+			"#NM Device Not Available Exception");
+
+	printf ("FPU: lazy switching, %zu-byte state with %s\n",
+			state_size, xsave_mask != 0 ? "XSAVE" : "FXSAVE");
+}
+
+/* Sets up an application processor's FPU the way fpu_init() set
+   up the bootstrap processor's, which must already have copied
+   its CR4 over. */
+void
+fpu_init_ap (void) {
+	lcr0 ((rcr0 () & ~CR0_EM) | CR0_MP | CR0_NE | CR0_TS);
+	if (xsave_mask != 0)
+		xsetbv (0, xsave_mask);
+	cpu_current ()->fpu_ts = true;
+}
+
+/* Called by the scheduler before switching to NEXT, with
+   interrupts off.  Leaves the FPU usable only if it holds NEXT's
+   state. */
+void
+fpu_switch (struct thread *next) {
+	set_ts (next != cpu_current ()->fpu_owner);
+}
+
+/* Returns true if T's FPU state is in the registers of the CPU
+   whose run queue T is on, which is then the only CPU T may run
+   on.  The caller must hold that CPU's rq_lock, or T could start
+   running and change the answer. */
+bool
+fpu_loaded (const struct thread *t) {
+	return t->cpu->fpu_owner == t;
+}
+
+/* #NM handler: gives the FPU to the running thread. */
+static void
+fpu_trap (struct intr_frame *f) {
+	struct thread *cur = thread_current ();
+	struct cpu *c;
+
+	if (f->cs != SEL_UCSEG) {
+		intr_dump_frame (f);
+		PANIC ("Kernel bug - FPU used in kernel");
+	}
+
+	if (cur->fpu_state == NULL) {
+		/* May sleep, so another thread may take the FPU
+		   meanwhile; nothing below depends on who owns it now.
+		   Without memory for the state, the process dies the way
+		   it would on a bad pointer. */
+		cur->fpu_state = palloc_get_page (0);
+		if (cur->fpu_state == NULL) {
+#ifdef USERPROG
+			exit (-1);
+#else
+			thread_exit ();
+#endif
+		}
+		memcpy (cur->fpu_state, init_state, state_size);
+	}
+
+	c = cpu_current ();
+	ASSERT (c->fpu_owner != cur);
+	__atomic_fetch_add (&trap_cnt, 1, __ATOMIC_RELAXED);
+	set_ts (false);
+	if (c->fpu_owner != NULL) {
+		save (c->fpu_owner->fpu_state);
+		__atomic_fetch_add (&save_cnt, 1, __ATOMIC_RELAXED);
+	}
+	restore (cur->fpu_state);
+	c->fpu_owner = cur;
+}
+
+/* Writes the running thread's FPU registers to its state area,
+   if they are loaded, so that another thread can read them.  The
+   thread stays the owner, so CR0.TS stays clear. */
+void
+fpu_flush (void) {
+	struct thread *cur = thread_current ();
+	enum intr_level old_level;
+
+	old_level = intr_disable ();
+	if (cpu_current ()->fpu_owner == cur) {
+		set_ts (false);
+		save (cur->fpu_state);
+	}
+	intr_set_level (old_level);
+}
+
+/* Gives the running thread, a new child of PARENT, a copy of
+   PARENT's FPU state.  Returns false if memory runs out.  PARENT
+   must have called fpu_flush() before creating the child, since
+   the child may run on another CPU than the one holding PARENT's
+   registers. */
+bool
+fpu_fork (struct thread *parent) {
+	struct thread *cur = thread_current ();
+
+	if (parent->fpu_state == NULL)
+		return true;
+	cur->fpu_state = palloc_get_page (0);
+	if (cur->fpu_state == NULL)
+		return false;
+
+	memcpy (cur->fpu_state, parent->fpu_state, state_size);
+	return true;
+}
+
+/* Drops the running thread's FPU state, for a new program or
+   because the thread is exiting. */
+void
+fpu_reset (void) {
+	struct thread *cur = thread_current ();
+	enum intr_level old_level;
+	void *state;
+
+	old_level = intr_disable ();
+	if (cpu_current ()->fpu_owner == cur) {
+		cpu_current ()->fpu_owner = NULL;
+		set_ts (true);
+	}
+	state = cur->fpu_state;
+	cur->fpu_state = NULL;
+	intr_set_level (old_level);
+
+	palloc_free_page (state);
+}
+
+/* Prints FPU statistics. */
+void
+fpu_print_stats (void) {
+	printf ("FPU: %lld traps, %lld states saved\n", trap_cnt, save_cnt);
+}
@@ -13,6 +13,8 @@
 #include "devices/serial.h"
 #include "devices/timer.h"
 #include "devices/vga.h"
+#include "threads/cpu.h"
+#include "threads/fpu.h"
 #include "threads/interrupt.h"
 #include "threads/io.h"
 #include "threads/loader.h"
@@ -21,6 +23,8 @@
 #include "threads/palloc.h"
 #include "threads/pte.h"
 #include "threads/thread.h"
+#include "threads/trace.h"
+#include "intrinsic.h"
 #ifdef USERPROG
 #include "userprog/process.h"
 #include "userprog/exception.h"
@@ -49,6 +53,9 @@ static bool format_filesys;
 /* -q: Power off after kernel tasks complete? */
 bool power_off_when_done;
 
+/* -no-large-pages: Map physical memory with 4 kB pages only? */
+static bool no_large_pages;
+
 bool thread_tests;
 
 static void bss_init (void);
@@ -94,6 +101,7 @@ main (void) {
 
 	/* Initialize interrupt handlers. */
 	intr_init ();
+	fpu_init ();
 	timer_init ();
 	kbd_init ();
 	input_init ();
@@ -105,6 +113,10 @@ main (void) {
 	thread_start ();
 	serial_init_queue ();
 	timer_calibrate ();
+	smp_init ();
+#ifdef USERPROG
+	pml4_reaper_init ();
+#endif
 
 #ifdef FILESYS
 	/* Initialize file system. */
@@ -140,31 +152,88 @@ bss_init (void) {
 	memset (&_start_bss, 0, &_end_bss - &_start_bss);
 }
 
+/* Size of a page mapped by a single page directory entry. */
+#define LARGE_PGSIZE (1UL << PDXSHIFT)
+
+/* Returns the entry for VA in PML4 at the level of the page
+ * tables that SHIFT indexes: PTXSHIFT for a 4 kB page, PDXSHIFT
+ * for a 2 MB one.  Creates the tables above it as needed, adding
+ * the number created to *TABLE_CNT. */
+static uint64_t *
+kernel_pte (uint64_t *pml4, uint64_t va, unsigned shift, size_t *table_cnt) {
+	uint64_t *table = pml4;
+	unsigned level;
+
+	for (level = PML4SHIFT; level > shift; level -= 9) {
+		uint64_t *e = &table[(va >> level) & 0x1FF];
+
+		if (!(*e & PTE_P)) {
+			*e = vtop (palloc_get_page (PAL_ASSERT | PAL_ZERO)) | PTE_W | PTE_P;
+			(*table_cnt)++;
+		}
+		table = ptov (PTE_ADDR (*e));
+	}
+	return &table[(va >> shift) & 0x1FF];
+}
+
 /* Populates the page table with the kernel virtual mapping,
  * and then sets up the CPU to use the new page directory.
- * Points base_pml4 to the pml4 it creates. */
+ * Points base_pml4 to the pml4 it creates.
+ *
+ * Physical memory is mapped with 2 MB pages, one page directory
+ * entry each, so the page tables stay small and kernel accesses
+ * through ptov() need few TLB entries.  Only the 2 MB regions
+ * holding kernel text are split into 4 kB pages, so that the text
+ * can be mapped read-only, along with any partial region at the
+ * end of memory.  start.S sets CR0.WP, so a stray kernel write to
+ * the text faults instead of succeeding.  1 GB pages would need
+ * KERN_BASE to be 1 GB aligned relative to physical address 0,
+ * which it is not.
+ *
+ * All of these mappings are global, so switching between user
+ * address spaces never flushes them from the TLB. */
 static void
 paging_init (uint64_t mem_end) {
-	uint64_t *pml4, *pte;
-	int perm;
+	extern char start, _end_kernel_text;
+	uint64_t text_start = vtop (&start);
+	uint64_t text_end = vtop (&_end_kernel_text);
+	size_t large_cnt = 0, small_cnt = 0, table_cnt = 1;
+	uint64_t begin = rdtsc ();
+	uint64_t *pml4;
+	uint64_t pa;
+
 	pml4 = base_pml4 = palloc_get_page (PAL_ASSERT | PAL_ZERO);
 
-	extern char start, _end_kernel_text;
 	// Maps physical address [0 ~ mem_end] to
 	//   [LOADER_KERN_BASE ~ LOADER_KERN_BASE + mem_end].
-	for (uint64_t pa = 0; pa < mem_end; pa += PGSIZE) {
-		uint64_t va = (uint64_t) ptov(pa);
-
-		perm = PTE_P | PTE_W;
-		if ((uint64_t) &start <= va && va < (uint64_t) &_end_kernel_text)
-			perm &= ~PTE_W;
-
-		if ((pte = pml4e_walk (pml4, va, 1)) != NULL)
-			*pte = pa | perm;
+	for (pa = 0; pa < mem_end; ) {
+		uint64_t va = (uint64_t) ptov (pa);
+
+		if (!no_large_pages && pa % LARGE_PGSIZE == 0
+				&& pa + LARGE_PGSIZE <= mem_end
+				&& (pa + LARGE_PGSIZE <= text_start || pa >= text_end)) {
+			*kernel_pte (pml4, va, PDXSHIFT, &table_cnt) =
+				pa | PTE_G | PTE_PS | PTE_W | PTE_P;
+			large_cnt++;
+			pa += LARGE_PGSIZE;
+		} else {
+			int perm = PTE_G | PTE_P | PTE_W;
+			if (text_start <= pa && pa < text_end)
+				perm &= ~PTE_W;
+
+			*kernel_pte (pml4, va, PTXSHIFT, &table_cnt) = pa | perm;
+			small_cnt++;
+			pa += PGSIZE;
+		}
 	}
 
+	printf ("Direct map: %zu 2 MB and %zu 4 kB pages, "
+			"%zu page-table pages, %'llu cycles\n",
+			large_cnt, small_cnt, table_cnt, rdtsc () - begin);
+
 	// reload cr3
 	pml4_activate(0);
+	mmu_init ();
 }
 
 /* Breaks the kernel command line into words and returns them as
@@ -221,11 +290,21 @@ parse_options (char **argv) {
 			random_init (atoi (value));
 		else if (!strcmp (name, "-mlfqs"))
 			thread_mlfqs = true;
+		else if (!strcmp (name, "-trace"))
+			trace_dump_on_exit = true;
+		else if (!strcmp (name, "-no-large-pages"))
+			no_large_pages = true;
+		else if (!strcmp (name, "-no-pcid"))
+			mmu_no_pcid = true;
+		else if (!strcmp (name, "-no-smp"))
+			smp_disabled = true;
 #ifdef USERPROG
 		else if (!strcmp (name, "-ul"))
 			user_page_limit = atoi (value);
 		else if (!strcmp (name, "-threads-tests"))
 			thread_tests = true;
+		else if (!strcmp (name, "-no-fast-syscall"))
+			syscall_no_fast = true;
 #endif
 		else
 			PANIC ("unknown option `%s' (use -h for help)", name);
@@ -326,8 +405,13 @@ usage (void) {
 			"  -f                 Format file system disk during startup.\n"
 			"  -rs=SEED           Set random number seed to SEED.\n"
 			"  -mlfqs             Use multi-level feedback queue scheduler.\n"
+			"  -trace             Dump the scheduler trace on shutdown.\n"
+			"  -no-large-pages    Map physical memory with 4 kB pages only.\n"
+			"  -no-pcid           Flush the TLB on every address space switch.\n"
+			"  -no-smp            Run on the bootstrap processor only.\n"
 #ifdef USERPROG
 			"  -ul=COUNT          Limit user memory to COUNT pages.\n"
+			"  -no-fast-syscall   Use the full system call entry path only.\n"
 #endif
 			);
 	power_off ();
@@ -353,7 +437,10 @@ power_off (void) {
 static void
 print_stats (void) {
 	timer_print_stats ();
+	intr_print_stats ();
 	thread_print_stats ();
+	fpu_print_stats ();
+	trace_print_stats ();
 #ifdef FILESYS
 	disk_print_stats ();
 #endif
@@ -361,5 +448,6 @@ print_stats (void) {
 	kbd_print_stats ();
 #ifdef USERPROG
 	exception_print_stats ();
+	syscall_print_stats ();
 #endif
 }
@@ -3,12 +3,14 @@
 #include <inttypes.h>
 #include <stdint.h>
 #include <stdio.h>
+#include "threads/cpu.h"
 #include "threads/flags.h"
 #include "threads/intr-stubs.h"
 #include "threads/io.h"
 #include "threads/thread.h"
 #include "threads/mmu.h"
 #include "threads/vaddr.h"
+#include "devices/lapic.h"
 #include "devices/timer.h"
 #include "intrinsic.h"
 #ifdef USERPROG
@@ -94,14 +96,55 @@ static intr_handler_func *intr_handlers[INTR_CNT];
 static const char *intr_names[INTR_CNT];
 
 /* External interrupts are those generated by devices outside the
-   CPU, such as the timer.  External interrupts run with
-   interrupts turned off, so they never nest, nor are they ever
-   pre-empted.  Handlers for external interrupts also may not
-   sleep, although they may invoke intr_yield_on_return() to
-   request that a new process be scheduled just before the
-   interrupt returns. */
-static bool in_external_intr;   /* Are we processing an external interrupt? */
-static bool yield_on_return;    /* Should we yield on interrupt return? */
+   CPU, such as the timer, and by the local APIC, such as IPIs
+   from other CPUs.  External interrupts run with interrupts
+   turned off, so they never nest, nor are they ever pre-empted.
+   Handlers for external interrupts also may not sleep, although
+   they may invoke intr_yield_on_return() to request that a new
+   process be scheduled just before the interrupt returns.  Each
+   CPU keeps track of its own in its struct cpu. */
+
+/* Turning interrupts off keeps out nothing but the running CPU's
+   own interrupt handlers and other threads.  Data that another
+   CPU may touch at the same time has a spinlock of its own (see
+   synch.h). */
+
+/* Statistics.
+
+   For each vector, the number of interrupts and the TSC cycles
+   spent in its handler, in total and at most.
+
+   Also the longest time any CPU has run with interrupts off, and
+   where they went off and came back on.  Each end is the caller
+   of intr_disable(), intr_enable() or intr_set_level(), or, if an
+   interrupt turned them off, the interrupted instruction, and if
+   the return from one turned them on, intr_handler() itself.
+   Each CPU times its current stretch in its struct cpu.  The
+   counters are updated with atomic operations, since every CPU
+   takes interrupts, and the longest stretch under OFF_LOCK. */
+struct intr_stat {
+	long long cnt;                      /* Interrupts. */
+	uint64_t cycles;                    /* Total cycles in the handler. */
+	uint64_t max_cycles;                /* Most cycles in one call. */
+};
+static struct intr_stat intr_stats[INTR_CNT];
+static uint64_t off_max_cycles;         /* Longest time off. */
+static void *off_max_from;              /* Where it began. */
+static void *off_max_to;                /* Where it ended. */
+static struct spinlock off_lock;
+
+static enum intr_level enable (void *caller);
+static enum intr_level disable (void *caller);
+static void off_begin (void *from);
+static void off_end (void *to);
+
+/* Returns true if VEC is an external interrupt vector: one of
+   the 8259A PICs' or one of the local APIC's. */
+static inline bool
+is_external (uint64_t vec) {
+	return (vec >= 0x20 && vec < 0x30)
+		|| (vec >= LAPIC_VEC_FIRST && vec < LAPIC_VEC_SPURIOUS);
+}
 
 /* Programmable Interrupt Controller helpers. */
 static void pic_init (void);
@@ -128,15 +171,33 @@ intr_get_level (void) {
    returns the previous interrupt status. */
 enum intr_level
 intr_set_level (enum intr_level level) {
-	return level == INTR_ON ? intr_enable () : intr_disable ();
+	void *caller = __builtin_return_address (0);
+
+	return level == INTR_ON ? enable (caller) : disable (caller);
 }
 
 /* Enables interrupts and returns the previous interrupt status. */
 enum intr_level
 intr_enable (void) {
+	return enable (__builtin_return_address (0));
+}
+
+/* Disables interrupts and returns the previous interrupt status. */
+enum intr_level
+intr_disable (void) {
+	return disable (__builtin_return_address (0));
+}
+
+/* Enables interrupts on behalf of CALLER and returns the previous
+   interrupt status. */
+static enum intr_level
+enable (void *caller) {
 	enum intr_level old_level = intr_get_level ();
 	ASSERT (!intr_context ());
 
+	if (old_level == INTR_OFF)
+		off_end (caller);
+
 	/* Enable interrupts by setting the interrupt flag.
 
 	   See [IA32-v2b] "STI" and [IA32-v3a] 5.8.1 "Masking Maskable
@@ -146,9 +207,10 @@ intr_enable (void) {
 	return old_level;
 }
 
-/* Disables interrupts and returns the previous interrupt status. */
-enum intr_level
-intr_disable (void) {
+/* Disables interrupts on behalf of CALLER and returns the
+   previous interrupt status. */
+static enum intr_level
+disable (void *caller) {
 	enum intr_level old_level = intr_get_level ();
 
 	/* Disable interrupts by clearing the interrupt flag.
@@ -156,9 +218,83 @@ intr_disable (void) {
 	   Hardware Interrupts". */
 	asm volatile ("cli" : : : "memory");
 
+	if (old_level == INTR_ON)
+		off_begin (caller);
 	return old_level;
 }
 
+/* Starts timing a stretch with interrupts off on the running CPU,
+   which just turned them off at FROM. */
+static void
+off_begin (void *from) {
+	struct cpu *c;
+
+	/* Before thread_init(), there is no struct cpu to go by. */
+	if (cpu_cnt == 0)
+		return;
+	c = cpu_current ();
+	c->off_tsc = rdtsc ();
+	c->off_from = from;
+}
+
+/* Ends the running CPU's stretch with interrupts off, which is
+   about to turn them on at TO, and records it if it is the
+   longest yet.  A stretch that began untimed, such as an
+   application processor's startup, is ignored. */
+static void
+off_end (void *to) {
+	struct cpu *c;
+	uint64_t cycles;
+
+	if (cpu_cnt == 0)
+		return;
+	c = cpu_current ();
+	if (c->off_from == NULL)
+		return;
+	cycles = rdtsc () - c->off_tsc;
+	if (cycles > __atomic_load_n (&off_max_cycles, __ATOMIC_RELAXED)) {
+		spinlock_acquire (&off_lock);
+		if (cycles > off_max_cycles) {
+			off_max_cycles = cycles;
+			off_max_from = c->off_from;
+			off_max_to = to;
+		}
+		spinlock_release (&off_lock);
+	}
+	c->off_from = NULL;
+}
+
+/* Enables interrupts and waits for the next one.  Interrupts must
+   be off.
+
+   The `sti' instruction disables interrupts until the
+   completion of the next instruction, so these two instructions
+   are executed atomically.  This atomicity is important;
+   otherwise, an interrupt could be handled between re-enabling
+   interrupts and waiting for the next one to occur, wasting as
+   much as one clock tick worth of time.
+
+   See [IA32-v2a] "HLT", [IA32-v2b] "STI", and [IA32-v3a] 7.11.1
+   "HLT Instruction". */
+void
+intr_wait (void) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	off_end (__builtin_return_address (0));
+	asm volatile ("sti; hlt" : : : "memory");
+}
+
+/* Ends the running CPU's stretch with interrupts off, leaving
+   them off, just before the CPU leaves the kernel with an
+   instruction that turns them back on, such as `iretq' to user
+   mode. */
+void
+intr_leave (void) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	off_end (__builtin_return_address (0));
+}
+
 /* Initializes the interrupt system. */
 void
 intr_init (void) {
@@ -166,6 +302,7 @@ intr_init (void) {
 
 	/* Initialize interrupt controller. */
 	pic_init ();
+	spinlock_init (&off_lock);
 
 	/* Initialize IDT. */
 	for (i = 0; i < INTR_CNT; i++) {
@@ -203,6 +340,15 @@ intr_init (void) {
 	intr_names[19] = "#XF SIMD Floating-Point Exception";
 }
 
+/* Loads the IDT on an application processor.  Every CPU shares
+   the one IDT and the same handlers. */
+void
+intr_init_ap (void) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	lidt (&idt_desc);
+}
+
 /* Registers interrupt VEC_NO to invoke HANDLER with descriptor
    privilege level DPL.  Names the interrupt NAME for debugging
    purposes.  The interrupt handler will be invoked with
@@ -227,7 +373,7 @@ register_handler (uint8_t vec_no, int dpl, enum intr_level level,
 void
 intr_register_ext (uint8_t vec_no, intr_handler_func *handler,
 		const char *name) {
-	ASSERT (vec_no >= 0x20 && vec_no <= 0x2f);
+	ASSERT (is_external (vec_no));
 	register_handler (vec_no, 0, INTR_OFF, handler, name);
 }
 
@@ -248,7 +394,7 @@ void
 intr_register_int (uint8_t vec_no, int dpl, enum intr_level level,
 		intr_handler_func *handler, const char *name)
 {
-	ASSERT (vec_no < 0x20 || vec_no > 0x2f);
+	ASSERT (!is_external (vec_no));
 	register_handler (vec_no, dpl, level, handler, name);
 }
 
@@ -256,7 +402,9 @@ intr_register_int (uint8_t vec_no, int dpl, enum intr_level level,
    and false at all other times. */
 bool
 intr_context (void) {
-	return in_external_intr;
+	/* Nothing is interrupted before thread_init() sets up the
+	   first CPU. */
+	return cpu_cnt != 0 && cpu_current ()->in_external_intr;
 }
 
 /* During processing of an external interrupt, directs the
@@ -266,7 +414,7 @@ intr_context (void) {
 void
 intr_yield_on_return (void) {
 	ASSERT (intr_context ());
-	yield_on_return = true;
+	cpu_current ()->yield_on_return = true;
 }
 
 /* 8259A Programmable Interrupt Controller. */
@@ -332,25 +480,39 @@ void
 intr_handler (struct intr_frame *frame) {
 	bool external;
 	intr_handler_func *handler;
+	struct cpu *c = NULL;
+	bool was_on = (frame->eflags & FLAG_IF) != 0;
+	struct intr_stat *stat = &intr_stats[frame->vec_no];
+	uint64_t start, cycles, max;
+
+	/* The gate turned interrupts off, so start timing. */
+	if (was_on && intr_get_level () == INTR_OFF)
+		off_begin ((void *) frame->rip);
+
+	__atomic_fetch_add (&stat->cnt, 1, __ATOMIC_RELAXED);
 
 	/* External interrupts are special.
 	   We only handle one at a time (so interrupts must be off)
-	   and they need to be acknowledged on the PIC (see below).
-	   An external interrupt handler cannot sleep. */
-	external = frame->vec_no >= 0x20 && frame->vec_no < 0x30;
+	   and they need to be acknowledged on the PIC or the local
+	   APIC (see below).  An external interrupt handler cannot
+	   sleep. */
+	external = is_external (frame->vec_no);
 	if (external) {
 		ASSERT (intr_get_level () == INTR_OFF);
 		ASSERT (!intr_context ());
 
-		in_external_intr = true;
-		yield_on_return = false;
+		c = cpu_current ();
+		c->in_external_intr = true;
+		c->yield_on_return = false;
 	}
 
 	/* Invoke the interrupt's handler. */
 	handler = intr_handlers[frame->vec_no];
+	start = rdtsc ();
 	if (handler != NULL)
 		handler (frame);
-	else if (frame->vec_no == 0x27 || frame->vec_no == 0x2f) {
+	else if (frame->vec_no == 0x27 || frame->vec_no == 0x2f
+			|| frame->vec_no == LAPIC_VEC_SPURIOUS) {
 		/* There is no handler, but this interrupt can trigger
 		   spuriously due to a hardware fault or hardware race
 		   condition.  Ignore it. */
@@ -361,17 +523,56 @@ intr_handler (struct intr_frame *frame) {
 		PANIC ("Unexpected interrupt");
 	}
 
+	cycles = rdtsc () - start;
+	__atomic_fetch_add (&stat->cycles, cycles, __ATOMIC_RELAXED);
+	max = __atomic_load_n (&stat->max_cycles, __ATOMIC_RELAXED);
+	while (cycles > max
+			&& !__atomic_compare_exchange_n (&stat->max_cycles, &max, cycles,
+				false, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+		continue;
+
 	/* Complete the processing of an external interrupt. */
 	if (external) {
 		ASSERT (intr_get_level () == INTR_OFF);
 		ASSERT (intr_context ());
 
-		in_external_intr = false;
-		pic_end_of_interrupt (frame->vec_no);
+		c->in_external_intr = false;
+		if (frame->vec_no < 0x30)
+			pic_end_of_interrupt (frame->vec_no);
+		else
+			lapic_eoi ();
 
-		if (yield_on_return)
+		if (c->yield_on_return)
 			thread_yield ();
 	}
+
+	/* `iretq' turns interrupts back on.  The handler may have
+	   done so already, if it turned interrupts on itself. */
+	if (was_on && intr_get_level () == INTR_OFF)
+		off_end (intr_handler);
+}
+
+/* Prints interrupt statistics: the longest time with interrupts
+   off, and each vector's count and cycles in its handler. */
+void
+intr_print_stats (void) {
+	long long total = 0;
+	int i;
+
+	for (i = 0; i < INTR_CNT; i++)
+		total += intr_stats[i].cnt;
+	printf ("Interrupt: %lld handled, longest off %"PRIu64" cycles "
+			"from %p to %p\n", total, off_max_cycles, off_max_from,
+			off_max_to);
+	for (i = 0; i < INTR_CNT; i++) {
+		const struct intr_stat *s = &intr_stats[i];
+
+		if (s->cnt == 0)
+			continue;
+		printf ("Interrupt: %#04x (%s): %lld times, cycles mean %"PRIu64
+				", max %"PRIu64", total %"PRIu64"\n", i, intr_names[i],
+				s->cnt, s->cycles / s->cnt, s->max_cycles, s->cycles);
+	}
 }
 
 /* Dumps interrupt frame F to the console, for debugging. */
@@ -1,13 +1,253 @@
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdio.h>
 #include <string.h>
+#include "threads/cpu.h"
 #include "threads/init.h"
+#include "threads/interrupt.h"
 #include "threads/pte.h"
 #include "threads/palloc.h"
+#include "threads/synch.h"
 #include "threads/thread.h"
 #include "threads/mmu.h"
 #include "intrinsic.h"
 
+/* Process-context identifiers (PCIDs).
+
+   With CR4.PCIDE set, the CPU tags each TLB entry with the PCID
+   in the low 12 bits of CR3, so loading CR3 need not throw away
+   the entries of other address spaces.  A pml4 gets a PCID by
+   hashing its physical address into one of PCID_CNT slots; PCID
+   0 belongs to base_pml4.  If the slot still belongs to the same
+   pml4 when it is activated, CR3 is loaded with CR3_NOFLUSH and
+   its entries from last time are still good.  Otherwise the pml4
+   takes the slot over and CR3 is loaded without it, which
+   flushes whatever the previous owner left under that PCID.
+
+   Each CPU has its own TLB, so each has its own slot owners.
+   After a change to a pml4's PTEs, CPUs where the pml4 is not
+   active just give up its slot, so that they flush its entries
+   the next time they activate it.  A user pml4 is only changed
+   by the one thread that runs on it, or by its creator before
+   that thread exists, so it is never active on a CPU other than
+   the one making the change.
+
+   The kernel's own mappings are global (PTE_G), so they survive
+   CR3 loads whether or not PCIDs are in use. */
+#define PCID_CNT 256                    /* Slots, including PCID 0. */
+#define CR3_NOFLUSH (1ULL << 63)        /* Keep the new PCID's entries. */
+#define CR4_PGE (1 << 7)                /* Enable global pages. */
+#define CR4_PCIDE (1 << 17)             /* Enable PCIDs. */
+#define CPUID_1_ECX_PCID (1 << 17)
+#define CPUID_1_EDX_PGE (1 << 13)
+#define CPUID_7_EBX_INVPCID (1 << 10)
+#define INVPCID_ADDR 0                  /* Invalidate one address. */
+
+/* A range operation that changes more PTEs than this flushes
+   PML4's whole TLB once instead of invalidating page by page,
+   since refilling the TLB costs less than that many INVLPGs. */
+#define TLB_FLUSH_MIN 32
+
+bool mmu_no_pcid;
+static bool pcid_enabled;
+static bool invpcid_supported;
+
+/* The pml4 that owns each PCID's TLB entries on each CPU, or
+   null. */
+static uint64_t *pcid_owner[CPU_MAX][PCID_CNT];
+
+/* Bumped whenever page tables are freed, which makes every
+   thread's pde_cache stale. */
+static unsigned pt_gen;
+
+/* Page-table pages.
+
+   Page tables freed by pml4_destroy() are zeroed and kept in a
+   pool of up to PT_POOL_MAX pages, and new tables come from the
+   pool, so a fork or exec right after an exit need not go back
+   to palloc for every level.  When the pool runs below
+   PT_POOL_LOW, the reaper tops it up to PT_POOL_FILL.
+
+   An exiting process hands its pml4 to pml4_destroy_deferred(),
+   which queues it for the reaper thread instead of tearing it
+   down on the spot.  The reaper runs at PRI_MIN, so the work is
+   done when the CPU would otherwise idle and process_exit() does
+   not keep the waiting parent.  If palloc runs dry first, it
+   calls pml4_reclaim() to tear down the queued pml4s right away
+   and, for the kernel pool, to hand the pool's pages back.  A
+   pml4 the reaper has already taken off the queue is freed by
+   the reaper alone, so an allocation made meanwhile can still
+   fail for want of the memory it holds.  The reaper's own
+   refills pass PAL_NORECLAIM, so that they stop at the first
+   failure instead of draining the pool they are filling. */
+#define PT_POOL_MAX 64
+#define PT_POOL_LOW 16
+#define PT_POOL_FILL 32
+
+/* A queued pml4's kernel half is dead, so its last entry links
+   it to the next one. */
+#define PML4_LINK (PGSIZE / sizeof (uint64_t) - 1)
+
+static uint64_t *pt_pool;               /* Linked through word 0. */
+static size_t pt_pool_cnt;
+static uint64_t *reap_list;             /* pml4s for the reaper. */
+static struct semaphore reaper_sema;    /* Ups on work for the reaper. */
+static bool reaper_running;
+static bool refill_wanted;              /* Reaper asked to refill? */
+static struct spinlock pt_lock;         /* Protects the ones above. */
+
+/* Returns the PCID slot for PML4, other than base_pml4. */
+static unsigned
+pcid_slot (uint64_t *pml4) {
+	return 1 + pg_no (vtop (pml4)) % (PCID_CNT - 1);
+}
+
+/* Makes every CPU but the running one give up PML4's PCID, if it
+ * has it, so that none of them keeps stale entries for PML4. */
+static void
+pcid_release_others (uint64_t *pml4) {
+	unsigned pcid = pcid_slot (pml4);
+	unsigned self = cpu_current ()->id;
+	enum intr_level old_level;
+	unsigned i;
+
+	old_level = intr_disable ();
+	for (i = 0; i < cpu_cnt; i++)
+		if (i != self && pcid_owner[i][pcid] == pml4)
+			pcid_owner[i][pcid] = NULL;
+	intr_set_level (old_level);
+}
+
+/* Turns on global pages and, unless -no-pcid was given, PCIDs,
+ * if the CPU has them.  Must be called with base_pml4 active
+ * and, as CR4.PCIDE requires, PCID 0 in CR3. */
+void
+mmu_init (void) {
+	uint32_t regs[4];
+	uint32_t max_leaf;
+
+	spinlock_init (&pt_lock);
+	cpuid (0, 0, regs);
+	max_leaf = regs[0];
+
+	cpuid (1, 0, regs);
+	if (regs[3] & CPUID_1_EDX_PGE)
+		lcr4 (rcr4 () | CR4_PGE);
+	if (!mmu_no_pcid && (regs[2] & CPUID_1_ECX_PCID)) {
+		lcr4 (rcr4 () | CR4_PCIDE);
+		pcid_enabled = true;
+		if (max_leaf >= 7) {
+			cpuid (7, 0, regs);
+			invpcid_supported = (regs[1] & CPUID_7_EBX_INVPCID) != 0;
+		}
+	}
+
+	printf ("TLB: global pages %s, PCIDs %s, INVPCID %s\n",
+			rcr4 () & CR4_PGE ? "on" : "off",
+			pcid_enabled ? "on" : "off",
+			invpcid_supported ? "on" : "off");
+}
+
+/* Removes any TLB entry for VA in PML4's address space, after
+ * its PTE has changed.  If PML4 is not active but may still have
+ * entries under its PCID, those go too: with INVPCID just the one,
+ * otherwise all of them, by giving up the PCID.  Other CPUs give
+ * up the PCID in any case. */
+static void
+tlb_invalidate (uint64_t *pml4, const void *va) {
+	uint64_t **owner;
+	unsigned pcid;
+
+	if (PTE_ADDR (rcr3 ()) == vtop (pml4))
+		invlpg ((uint64_t) va);
+	else if (pcid_enabled) {
+		pcid = pcid_slot (pml4);
+		owner = pcid_owner[cpu_current ()->id];
+		if (owner[pcid] == pml4) {
+			if (invpcid_supported)
+				invpcid (INVPCID_ADDR, pcid, (uint64_t) va);
+			else
+				owner[pcid] = NULL;
+		}
+	}
+	if (pcid_enabled && cpu_cnt > 1)
+		pcid_release_others (pml4);
+}
+
+/* Removes all of PML4's TLB entries other than global ones: if
+ * PML4 is active, by reloading CR3 without CR3_NOFLUSH, otherwise
+ * by giving up its PCID, as other CPUs do in any case. */
+static void
+tlb_flush (uint64_t *pml4) {
+	uint64_t **owner;
+	unsigned pcid;
+
+	if (PTE_ADDR (rcr3 ()) == vtop (pml4))
+		lcr3 (rcr3 () & ~CR3_NOFLUSH);
+	else if (pcid_enabled) {
+		pcid = pcid_slot (pml4);
+		owner = pcid_owner[cpu_current ()->id];
+		if (owner[pcid] == pml4)
+			owner[pcid] = NULL;
+	}
+	if (pcid_enabled && cpu_cnt > 1)
+		pcid_release_others (pml4);
+}
+
+/* Takes a zeroed page for a page table from the pool, or from
+ * palloc if the pool is empty.  Returns a null pointer if memory
+ * is exhausted. */
+static void *
+pt_alloc (void) {
+	enum intr_level old_level = intr_disable ();
+	uint64_t *page;
+	bool refill = false;
+
+	spinlock_acquire (&pt_lock);
+	page = pt_pool;
+	if (page != NULL) {
+		pt_pool = (uint64_t *) page[0];
+		page[0] = 0;
+		pt_pool_cnt--;
+	}
+	if (pt_pool_cnt < PT_POOL_LOW && reaper_running && !refill_wanted) {
+		refill_wanted = true;
+		refill = true;
+	}
+	spinlock_release (&pt_lock);
+	if (refill)
+		sema_up (&reaper_sema);
+	intr_set_level (old_level);
+
+	return page != NULL ? page : palloc_get_page (PAL_ZERO);
+}
+
+/* Adds zeroed PAGE to the pool. */
+static void
+pt_push (void *page) {
+	enum intr_level old_level = intr_disable ();
+	uint64_t *p = page;
+
+	spinlock_acquire (&pt_lock);
+	p[0] = (uint64_t) pt_pool;
+	pt_pool = p;
+	pt_pool_cnt++;
+	spinlock_release (&pt_lock);
+	intr_set_level (old_level);
+}
+
+/* Frees page-table page PAGE into the pool, or back to palloc if
+ * the pool is full. */
+static void
+pt_free (void *page) {
+	if (pt_pool_cnt >= PT_POOL_MAX) {
+		palloc_free_page (page);
+		return;
+	}
+	memset (page, 0, PGSIZE);
+	pt_push (page);
+}
+
 static uint64_t *
 pgdir_walk (uint64_t *pdp, const uint64_t va, int create) {
 	int idx = PDX (va);
@@ -15,7 +255,7 @@ pgdir_walk (uint64_t *pdp, const uint64_t va, int create) {
 		uint64_t *pte = (uint64_t *) pdp[idx];
 		if (!((uint64_t) pte & PTE_P)) {
 			if (create) {
-				uint64_t *new_page = palloc_get_page (PAL_ZERO);
+				uint64_t *new_page = pt_alloc ();
 				if (new_page)
 					pdp[idx] = vtop (new_page) | PTE_U | PTE_W | PTE_P;
 				else
@@ -23,6 +263,9 @@ pgdir_walk (uint64_t *pdp, const uint64_t va, int create) {
 			} else
 				return NULL;
 		}
+		/* A 2 MB page has no page table below it. */
+		if (pdp[idx] & PTE_PS)
+			return NULL;
 		return (uint64_t *) ptov (PTE_ADDR (pdp[idx]) + 8 * PTX (va));
 	}
 	return NULL;
@@ -37,7 +280,7 @@ pdpe_walk (uint64_t *pdpe, const uint64_t va, int create) {
 		uint64_t *pde = (uint64_t *) pdpe[idx];
 		if (!((uint64_t) pde & PTE_P)) {
 			if (create) {
-				uint64_t *new_page = palloc_get_page (PAL_ZERO);
+				uint64_t *new_page = pt_alloc ();
 				if (new_page) {
 					pdpe[idx] = vtop (new_page) | PTE_U | PTE_W | PTE_P;
 					allocated = 1;
@@ -49,20 +292,14 @@ pdpe_walk (uint64_t *pdpe, const uint64_t va, int create) {
 		pte = pgdir_walk (ptov (PTE_ADDR (pdpe[idx])), va, create);
 	}
 	if (pte == NULL && allocated) {
-		palloc_free_page ((void *) ptov (PTE_ADDR (pdpe[idx])));
+		pt_free ((void *) ptov (PTE_ADDR (pdpe[idx])));
 		pdpe[idx] = 0;
 	}
 	return pte;
 }
 
-/* Returns the address of the page table entry for virtual
- * address VADDR in page map level 4, pml4.
- * If PML4E does not have a page table for VADDR, behavior depends
- * on CREATE.  If CREATE is true, then a new page table is
- * created and a pointer into it is returned.  Otherwise, a null
- * pointer is returned. */
-uint64_t *
-pml4e_walk (uint64_t *pml4e, const uint64_t va, int create) {
+static uint64_t *
+pml4e_walk_uncached (uint64_t *pml4e, const uint64_t va, int create) {
 	uint64_t *pte = NULL;
 	int idx = PML4 (va);
 	int allocated = 0;
@@ -70,7 +307,7 @@ pml4e_walk (uint64_t *pml4e, const uint64_t va, int create) {
 		uint64_t *pdpe = (uint64_t *) pml4e[idx];
 		if (!((uint64_t) pdpe & PTE_P)) {
 			if (create) {
-				uint64_t *new_page = palloc_get_page (PAL_ZERO);
+				uint64_t *new_page = pt_alloc ();
 				if (new_page) {
 					pml4e[idx] = vtop (new_page) | PTE_U | PTE_W | PTE_P;
 					allocated = 1;
@@ -82,19 +319,49 @@ pml4e_walk (uint64_t *pml4e, const uint64_t va, int create) {
 		pte = pdpe_walk (ptov (PTE_ADDR (pml4e[idx])), va, create);
 	}
 	if (pte == NULL && allocated) {
-		palloc_free_page ((void *) ptov (PTE_ADDR (pml4e[idx])));
+		pt_free ((void *) ptov (PTE_ADDR (pml4e[idx])));
 		pml4e[idx] = 0;
 	}
 	return pte;
 }
 
+/* Returns the address of the page table entry for virtual
+ * address VADDR in page map level 4, pml4.
+ * If PML4E does not have a page table for VADDR, behavior depends
+ * on CREATE.  If CREATE is true, then a new page table is
+ * created and a pointer into it is returned.  Otherwise, a null
+ * pointer is returned.
+ *
+ * The page table found is remembered in the running thread's
+ * pde_cache, so that the next lookup in the same 2 MB region
+ * goes straight to it. */
+uint64_t *
+pml4e_walk (uint64_t *pml4e, const uint64_t va, int create) {
+	struct pde_cache *c = &thread_current ()->pde_cache;
+	uint64_t region = va & ~((1ULL << PDXSHIFT) - 1);
+	uint64_t *pte;
+
+	if (pml4e != NULL && c->pml4 == pml4e && c->va == region
+			&& c->gen == pt_gen)
+		return &c->pt[PTX (va)];
+
+	pte = pml4e_walk_uncached (pml4e, va, create);
+	if (pte != NULL) {
+		c->pml4 = pml4e;
+		c->va = region;
+		c->pt = pte - PTX (va);
+		c->gen = pt_gen;
+	}
+	return pte;
+}
+
 /* Creates a new page map level 4 (pml4) has mappings for kernel
  * virtual addresses, but none for user virtual addresses.
  * Returns the new page directory, or a null pointer if memory
  * allocation fails. */
 uint64_t *
 pml4_create (void) {
-	uint64_t *pml4 = palloc_get_page (0);
+	uint64_t *pml4 = pt_alloc ();
 	if (pml4)
 		memcpy (pml4, base_pml4, PGSIZE);
 	return pml4;
@@ -122,7 +389,7 @@ pgdir_for_each (uint64_t *pdp, pte_for_each_func *func, void *aux,
 		unsigned pml4_index, unsigned pdp_index) {
 	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++) {
 		uint64_t *pte = ptov((uint64_t *) pdp[i]);
-		if (((uint64_t) pte) & PTE_P)
+		if ((((uint64_t) pte) & PTE_P) && !(pdp[i] & PTE_PS))
 			if (!pt_for_each ((uint64_t *) PTE_ADDR (pte), func, aux,
 					pml4_index, pdp_index, i))
 				return false;
@@ -143,7 +410,9 @@ pdp_for_each (uint64_t *pdp,
 	return true;
 }
 
-/* Apply FUNC to each available pte entries including kernel's. */
+/* Apply FUNC to each available pte entries including kernel's.
+ * The 2 MB pages of the kernel's direct map have no PTEs and are
+ * skipped. */
 bool
 pml4_for_each (uint64_t *pml4, pte_for_each_func *func, void *aux) {
 	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++) {
@@ -155,6 +424,56 @@ pml4_for_each (uint64_t *pml4, pte_for_each_func *func, void *aux) {
 	return true;
 }
 
+/* Returns the first address past VA's region at the level whose
+ * entries each map 1 << SHIFT bytes. */
+static inline uint64_t
+level_end (uint64_t va, unsigned shift) {
+	return (va | ((1ULL << shift) - 1)) + 1;
+}
+
+/* Apply FUNC to each present PTE that maps a page in [START, END),
+ * in address order, stopping early if FUNC returns false.
+ * Each page table is reached once, and absent tables skip their
+ * whole region, so the cost follows the tables that exist rather
+ * than the length of the range.  2 MB pages are skipped.
+ * Returns false if FUNC did. */
+bool
+pml4_for_each_range (uint64_t *pml4, const void *start, const void *end,
+		pte_for_each_func *func, void *aux) {
+	uint64_t va = (uint64_t) pg_round_down (start);
+	uint64_t end_va = (uint64_t) end;
+
+	while (va < end_va) {
+		uint64_t e = pml4[PML4 (va)];
+		unsigned skip = PML4SHIFT;
+
+		if (e & PTE_P) {
+			e = ((uint64_t *) ptov (PTE_ADDR (e)))[PDPE (va)];
+			skip = PDPESHIFT;
+			if ((e & (PTE_P | PTE_PS)) == PTE_P) {
+				e = ((uint64_t *) ptov (PTE_ADDR (e)))[PDX (va)];
+				skip = PDXSHIFT;
+				if ((e & (PTE_P | PTE_PS)) == PTE_P) {
+					uint64_t *pt = ptov (PTE_ADDR (e));
+					uint64_t *pte = &pt[PTX (va)];
+					uint64_t p = va;
+
+					for (; pte < pt + PGSIZE / sizeof *pt && p < end_va;
+							pte++, p += PGSIZE)
+						if ((*pte & PTE_P) && !func (pte, (void *) p, aux))
+							return false;
+				}
+			}
+		}
+
+		/* Past the top of the address space, VA wraps to 0. */
+		va = level_end (va, skip);
+		if (va == 0)
+			break;
+	}
+	return true;
+}
+
 static void
 pt_destroy (uint64_t *pt) {
 	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++) {
@@ -162,7 +481,7 @@ pt_destroy (uint64_t *pt) {
 		if (((uint64_t) pte) & PTE_P)
 			palloc_free_page ((void *) PTE_ADDR (pte));
 	}
-	palloc_free_page ((void *) pt);
+	pt_free ((void *) pt);
 }
 
 static void
@@ -172,7 +491,7 @@ pgdir_destroy (uint64_t *pdp) {
 		if (((uint64_t) pte) & PTE_P)
 			pt_destroy (PTE_ADDR (pte));
 	}
-	palloc_free_page ((void *) pdp);
+	pt_free ((void *) pdp);
 }
 
 static void
@@ -182,12 +501,16 @@ pdpe_destroy (uint64_t *pdpe) {
 		if (((uint64_t) pde) & PTE_P)
 			pgdir_destroy ((void *) PTE_ADDR (pde));
 	}
-	palloc_free_page ((void *) pdpe);
+	pt_free ((void *) pdpe);
 }
 
 /* Destroys pml4e, freeing all the pages it references. */
 void
 pml4_destroy (uint64_t *pml4) {
+	enum intr_level old_level;
+	unsigned pcid;
+	unsigned i;
+
 	if (pml4 == NULL)
 		return;
 	ASSERT (pml4 != base_pml4);
@@ -196,14 +519,184 @@ pml4_destroy (uint64_t *pml4) {
 	uint64_t *pdpe = ptov ((uint64_t *) pml4[0]);
 	if (((uint64_t) pdpe) & PTE_P)
 		pdpe_destroy ((void *) PTE_ADDR (pdpe));
-	palloc_free_page ((void *) pml4);
+	__atomic_fetch_add (&pt_gen, 1, __ATOMIC_RELAXED);
+
+	/* A new pml4 in the same page must not inherit our PCID's
+	 * entries, on any CPU. */
+	pcid = pcid_slot (pml4);
+	old_level = intr_disable ();
+	for (i = 0; i < cpu_cnt; i++)
+		if (pcid_owner[i][pcid] == pml4)
+			pcid_owner[i][pcid] = NULL;
+	intr_set_level (old_level);
+	pt_free ((void *) pml4);
+}
+
+/* Queues PML4 for pml4_destroy() by the reaper thread, or
+ * destroys it now if the reaper has not been started.  PML4 must
+ * not be active. */
+void
+pml4_destroy_deferred (uint64_t *pml4) {
+	enum intr_level old_level;
+
+	if (pml4 == NULL)
+		return;
+	ASSERT (pml4 != base_pml4);
+	if (!reaper_running) {
+		pml4_destroy (pml4);
+		return;
+	}
+
+	old_level = intr_disable ();
+	spinlock_acquire (&pt_lock);
+	pml4[PML4_LINK] = (uint64_t) reap_list;
+	reap_list = pml4;
+	spinlock_release (&pt_lock);
+	intr_set_level (old_level);
+	sema_up (&reaper_sema);
+}
+
+/* Destroys every pml4 queued for the reaper, in the calling
+ * thread.  Returns true if there were any. */
+static bool
+reap_queued (void) {
+	enum intr_level old_level;
+	uint64_t *pml4;
+	bool reclaimed = false;
+
+	for (;;) {
+		old_level = intr_disable ();
+		spinlock_acquire (&pt_lock);
+		pml4 = reap_list;
+		if (pml4 != NULL)
+			reap_list = (uint64_t *) pml4[PML4_LINK];
+		spinlock_release (&pt_lock);
+		intr_set_level (old_level);
+
+		if (pml4 == NULL)
+			return reclaimed;
+		pml4_destroy (pml4);
+		reclaimed = true;
+	}
+}
+
+/* Returns every page in the page-table pool to palloc.  Returns
+ * true if there were any. */
+static bool
+pt_pool_drain (void) {
+	enum intr_level old_level;
+	uint64_t *page;
+	bool drained = false;
+
+	for (;;) {
+		old_level = intr_disable ();
+		spinlock_acquire (&pt_lock);
+		page = pt_pool;
+		if (page != NULL) {
+			pt_pool = (uint64_t *) page[0];
+			pt_pool_cnt--;
+		}
+		spinlock_release (&pt_lock);
+		intr_set_level (old_level);
+
+		if (page == NULL)
+			return drained;
+		palloc_free_page (page);
+		drained = true;
+	}
+}
+
+/* Frees what memory page tables hold on to, for palloc when it
+ * runs dry: destroys every pml4 queued for the reaper, in the
+ * calling thread, and empties the page-table pool unless USER is
+ * true, since the pool's pages come from the kernel pool and
+ * would not help.  Returns true if that freed anything. */
+bool
+pml4_reclaim (bool user) {
+	bool reaped = reap_queued ();
+	bool drained = !user && pt_pool_drain ();
+
+	return reaped || drained;
+}
+
+/* Tears down queued pml4s and keeps the page-table pool filled. */
+static void
+reaper (void *aux UNUSED) {
+	enum intr_level old_level;
+	void *page;
+
+	for (;;) {
+		sema_down (&reaper_sema);
+		reap_queued ();
+
+		old_level = intr_disable ();
+		spinlock_acquire (&pt_lock);
+		refill_wanted = false;
+		spinlock_release (&pt_lock);
+		intr_set_level (old_level);
+		while (pt_pool_cnt < PT_POOL_FILL
+				&& (page = palloc_get_page (PAL_ZERO | PAL_NORECLAIM))
+				!= NULL)
+			pt_push (page);
+	}
+}
+
+/* Starts the reaper thread.  Until then, pml4_destroy_deferred()
+ * destroys synchronously. */
+void
+pml4_reaper_init (void) {
+	sema_init (&reaper_sema, 0);
+	if (thread_create ("pt-reaper", PRI_MIN, reaper, NULL) != TID_ERROR)
+		reaper_running = true;
+}
+
+/* Maps the SIZE bytes of device registers at physical address
+ * PA, which paging_init() left out because they lie past the end
+ * of RAM, at ptov (PA) in the kernel half of every address space,
+ * uncached.  Returns the kernel virtual address. */
+void *
+mmu_map_device (uint64_t pa, size_t size) {
+	uint64_t first = (uint64_t) pg_round_down (pa);
+	uint64_t page;
+
+	for (page = first; page < pa + size; page += PGSIZE) {
+		uint64_t va = (uint64_t) ptov (page);
+		uint64_t *pte = pml4e_walk (base_pml4, va, 1);
+
+		ASSERT (pte != NULL);
+		*pte = page | PTE_PCD | PTE_PWT | PTE_G | PTE_W | PTE_P;
+		invlpg (va);
+	}
+	return ptov (pa);
 }
 
 /* Loads page directory PD into the CPU's page directory base
- * register. */
+ * register, keeping its TLB entries from the last time it was
+ * active if it still owns its PCID. */
 void
 pml4_activate (uint64_t *pml4) {
-	lcr3 (vtop (pml4 ? pml4 : base_pml4));
+	uint64_t **owner;
+	uint64_t cr3;
+	unsigned pcid;
+
+	if (pml4 == NULL)
+		pml4 = base_pml4;
+	cr3 = vtop (pml4);
+
+	if (pcid_enabled) {
+		/* base_pml4 maps nothing but global pages. */
+		if (pml4 == base_pml4)
+			cr3 |= CR3_NOFLUSH;
+		else {
+			pcid = pcid_slot (pml4);
+			owner = pcid_owner[cpu_current ()->id];
+			if (owner[pcid] == pml4)
+				cr3 |= CR3_NOFLUSH;
+			owner[pcid] = pml4;
+			cr3 |= pcid;
+		}
+	}
+	lcr3 (cr3);
 }
 
 /* Looks up the physical address that corresponds to user virtual
@@ -257,8 +750,7 @@ pml4_clear_page (uint64_t *pml4, void *upage) {
 
 	if (pte != NULL && (*pte & PTE_P) != 0) {
 		*pte &= ~PTE_P;
-		if (rcr3 () == vtop (pml4))
-			invlpg ((uint64_t) upage);
+		tlb_invalidate (pml4, upage);
 	}
 }
 
@@ -283,8 +775,7 @@ pml4_set_dirty (uint64_t *pml4, const void *vpage, bool dirty) {
 		else
 			*pte &= ~(uint32_t) PTE_D;
 
-		if (rcr3 () == vtop (pml4))
-			invlpg ((uint64_t) vpage);
+		tlb_invalidate (pml4, vpage);
 	}
 }
 
@@ -309,7 +800,84 @@ pml4_set_accessed (uint64_t *pml4, const void *vpage, bool accessed) {
 		else
 			*pte &= ~(uint32_t) PTE_A;
 
-		if (rcr3 () == vtop (pml4))
-			invlpg ((uint64_t) vpage);
+		tlb_invalidate (pml4, vpage);
+	}
+}
+
+/* Changes made by a range operation, for deciding how to update
+ * the TLB afterward. */
+struct range_aux {
+	uint64_t *pml4;
+	uint64_t base;              /* First page of the range. */
+	size_t cnt;                 /* PTEs changed so far. */
+	uint64_t mask;              /* For pml4_clear_accessed_range(). */
+};
+
+/* Invalidates VA's TLB entry for the first TLB_FLUSH_MIN pages
+ * of a range operation.  Past that, finish_range() flushes. */
+static void
+range_invalidate (struct range_aux *r, void *va) {
+	if (++r->cnt <= TLB_FLUSH_MIN)
+		tlb_invalidate (r->pml4, va);
+}
+
+static void
+finish_range (struct range_aux *r) {
+	if (r->cnt > TLB_FLUSH_MIN)
+		tlb_flush (r->pml4);
+}
+
+static bool
+clear_present (uint64_t *pte, void *va, void *aux) {
+	*pte &= ~PTE_P;
+	range_invalidate (aux, va);
+	return true;
+}
+
+/* Marks every user page in [START, END) "not present" in PML4,
+ * as pml4_clear_page() does for one, and returns how many were
+ * present.  Walks the page tables once for the whole range. */
+size_t
+pml4_clear_range (uint64_t *pml4, const void *start, const void *end) {
+	struct range_aux r = {pml4, 0, 0, 0};
+
+	ASSERT (pg_ofs (start) == 0);
+	ASSERT (end <= (void *) KERN_BASE);
+
+	pml4_for_each_range (pml4, start, end, clear_present, &r);
+	finish_range (&r);
+	return r.cnt;
+}
+
+static bool
+clear_accessed (uint64_t *pte, void *va, void *aux) {
+	struct range_aux *r = aux;
+
+	if (*pte & PTE_A) {
+		*pte &= ~(uint64_t) PTE_A;
+		r->mask |= 1ULL << (((uint64_t) va - r->base) >> PGBITS);
+		range_invalidate (r, va);
 	}
+	return true;
+}
+
+/* Clears the accessed bit of each of the PAGE_CNT pages starting
+ * at user page UPAGE in PML4, which may be at most 64.  Returns a
+ * mask in which bit I is set if page I had been accessed.  Lets a
+ * clock hand sweep a run of pages with one walk and at most one
+ * TLB flush, instead of a walk and an INVLPG per page through
+ * pml4_is_accessed() and pml4_set_accessed(). */
+uint64_t
+pml4_clear_accessed_range (uint64_t *pml4, const void *upage,
+		size_t page_cnt) {
+	struct range_aux r = {pml4, (uint64_t) upage, 0, 0};
+
+	ASSERT (pg_ofs (upage) == 0);
+	ASSERT (page_cnt <= 64);
+	ASSERT (is_user_vaddr (upage + page_cnt * PGSIZE - 1));
+
+	pml4_for_each_range (pml4, upage, upage + page_cnt * PGSIZE,
+			clear_accessed, &r);
+	finish_range (&r);
+	return r.mask;
 }
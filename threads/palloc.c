@@ -8,7 +8,9 @@
 #include <stdio.h>
 #include <string.h>
 #include "threads/init.h"
+#include "threads/interrupt.h"
 #include "threads/loader.h"
+#include "threads/mmu.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
 
@@ -28,7 +30,7 @@
 
 /* A memory pool. */
 struct pool {
-	struct lock lock;               /* Mutual exclusion. */
+	struct spinlock lock;           /* Mutual exclusion. */
 	struct bitmap *used_map;        /* Bitmap of free pages. */
 	uint8_t *base;                  /* Base of pool. */
 };
@@ -42,6 +44,7 @@ static void
 init_pool (struct pool *p, void **bm_base, uint64_t start, uint64_t end);
 
 static bool page_from_pool (const struct pool *, void *page);
+static size_t pool_take (struct pool *, size_t page_cnt);
 
 /* multiboot info */
 struct multiboot_info {
@@ -258,16 +261,22 @@ palloc_init (void) {
    otherwise from the kernel pool.  If PAL_ZERO is set in FLAGS,
    then the pages are filled with zeros.  If too few pages are
    available, returns a null pointer, unless PAL_ASSERT is set in
-   FLAGS, in which case the kernel panics. */
+   FLAGS, in which case the kernel panics.  If PAL_NORECLAIM is
+   set, fails without first calling pml4_reclaim(). */
 void *
 palloc_get_multiple (enum palloc_flags flags, size_t page_cnt) {
 	struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
 
-	lock_acquire (&pool->lock);
-	size_t page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
-	lock_release (&pool->lock);
+	size_t page_idx = pool_take (pool, page_cnt);
 	void *pages;
 
+	/* Exited processes' pages may still be waiting for the page
+	   table reaper, and the page-table pool keeps free pages of
+	   its own.  Return them now and try again. */
+	if (page_idx == BITMAP_ERROR && !(flags & PAL_NORECLAIM)
+			&& pml4_reclaim (flags & PAL_USER))
+		page_idx = pool_take (pool, page_cnt);
+
 	if (page_idx != BITMAP_ERROR)
 		pages = pool->base + PGSIZE * page_idx;
 	else
@@ -337,7 +346,7 @@ init_pool (struct pool *p, void **bm_base, uint64_t start, uint64_t end) {
 	uint64_t pgcnt = (end - start) / PGSIZE;
 	size_t bm_pages = DIV_ROUND_UP (bitmap_buf_size (pgcnt), PGSIZE) * PGSIZE;
 
-	lock_init(&p->lock);
+	spinlock_init (&p->lock);
 	p->used_map = bitmap_create_in_buf (pgcnt, *bm_base, bm_pages);
 	p->base = (void *) start;
 
@@ -347,6 +356,21 @@ init_pool (struct pool *p, void **bm_base, uint64_t start, uint64_t end) {
 	*bm_base += bm_pages;
 }
 
+/* Finds PAGE_CNT free pages in a row in POOL and marks them
+   used.  Returns the index of the first, or BITMAP_ERROR if there
+   is no such run. */
+static size_t
+pool_take (struct pool *pool, size_t page_cnt) {
+	enum intr_level old_level = intr_disable ();
+	size_t page_idx;
+
+	spinlock_acquire (&pool->lock);
+	page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
+	spinlock_release (&pool->lock);
+	intr_set_level (old_level);
+	return page_idx;
+}
+
 /* Returns true if PAGE was allocated from POOL,
    false otherwise. */
 static bool
@@ -29,8 +29,13 @@
 #include "threads/synch.h"
 #include <stdio.h>
 #include <string.h>
+#include "threads/cpu.h"
 #include "threads/interrupt.h"
 #include "threads/thread.h"
+#include "threads/trace.h"
+
+static void sema_down_locked (struct semaphore *);
+static void sema_up_locked (struct semaphore *);
 
 /* Initializes semaphore SEMA to VALUE.  A semaphore is a
    nonnegative integer along with two atomic operators for
@@ -47,6 +52,7 @@ sema_init (struct semaphore *sema, unsigned value) {
 
 	sema->value = value;
 	list_init (&sema->waiters);
+	spinlock_init (&sema->lock);
 }
 
 /* Down or "P" operation on a semaphore.  Waits for SEMA's value
@@ -65,13 +71,27 @@ sema_down (struct semaphore *sema) {
 	ASSERT (!intr_context ());
 
 	old_level = intr_disable ();
+	spinlock_acquire (&sema->lock);
+	sema_down_locked (sema);
+	spinlock_release (&sema->lock);
+	intr_set_level (old_level);
+}
+
+/* Does sema_down() on SEMA, whose spinlock the caller holds.  The
+   spinlock is released while the thread sleeps, and held again
+   on return. */
+static void
+sema_down_locked (struct semaphore *sema) {
 	while (sema->value == 0) {
 		//list_push_back (&sema->waiters, &thread_current ()->elem); 
 		list_insert_ordered(&sema->waiters, &thread_current ()->elem,cmp_priority,NULL);
-		thread_block ();
+		trace_record (TRACE_BLOCK, thread_current (),
+				thread_current ()->wait_on_lock != NULL
+				? TRACE_WAIT_LOCK : TRACE_WAIT_SEMA, NULL);
+		thread_block_unlock (&sema->lock);
+		spinlock_acquire (&sema->lock);
 	}
 	sema->value--;
-	intr_set_level (old_level);
 }
 
 /* Down or "P" operation on a semaphore, but only if the
@@ -87,6 +107,7 @@ sema_try_down (struct semaphore *sema) {
 	ASSERT (sema != NULL);
 
 	old_level = intr_disable ();
+	spinlock_acquire (&sema->lock);
 	if (sema->value > 0)
 	{
 		sema->value--;
@@ -94,6 +115,7 @@ sema_try_down (struct semaphore *sema) {
 	}
 	else
 		success = false;
+	spinlock_release (&sema->lock);
 	intr_set_level (old_level);
 
 	return success;
@@ -110,14 +132,24 @@ sema_up (struct semaphore *sema) {
 	ASSERT (sema != NULL);
 
 	old_level = intr_disable ();
+	spinlock_acquire (&sema->lock);
+	sema_up_locked (sema);
+	spinlock_release (&sema->lock);
+	thread_compare_priority();
+	intr_set_level (old_level);
+}
+
+/* Does sema_up() on SEMA, whose spinlock the caller holds, except
+   that it leaves it to the caller to yield to a thread of higher
+   priority, once the spinlock is released. */
+static void
+sema_up_locked (struct semaphore *sema) {
+	sema->value++;
 	if (!list_empty (&sema->waiters)){
 		list_sort(&sema->waiters,cmp_priority,NULL);
 		thread_unblock (list_entry (list_pop_front (&sema->waiters),
 					struct thread, elem));
 	}
-	sema->value++;
-	thread_compare_priority();
-	intr_set_level (old_level);
 }
 
 static void sema_test_helper (void *sema_);
@@ -175,9 +207,41 @@ lock_init (struct lock *lock) {
 	ASSERT (lock != NULL);
 
 	lock->holder = NULL;
+	lock->max_priority = PRI_MIN;
 	sema_init (&lock->semaphore, 1);
 }
 
+/* Makes the current thread the holder of LOCK, which it has just
+   downed.  The threads still waiting for LOCK now donate to the
+   current thread.  The caller must hold LOCK's semaphore's
+   spinlock. */
+static void
+lock_take (struct lock *lock) {
+	struct thread *curr = thread_current ();
+	struct list_elem *e;
+
+	ASSERT (spinlock_held_by_current_cpu (&lock->semaphore.lock));
+
+	lock->holder = curr;
+	list_push_back (&curr->locks, &lock->elem);
+	if (list_empty (&lock->semaphore.waiters)) {
+		lock->max_priority = PRI_MIN;
+		return;
+	}
+
+	spinlock_acquire (&donate_lock);
+	lock->max_priority = PRI_MIN;
+	for (e = list_begin (&lock->semaphore.waiters);
+			e != list_end (&lock->semaphore.waiters); e = list_next (e)) {
+		struct thread *t = list_entry (e, struct thread, elem);
+		if (lock->max_priority < t->priority)
+			lock->max_priority = t->priority;
+	}
+	if (!thread_mlfqs && curr->priority < lock->max_priority)
+		curr->priority = lock->max_priority;
+	spinlock_release (&donate_lock);
+}
+
 /* Acquires LOCK, sleeping until it becomes available if
    necessary.  The lock must not already be held by the current
    thread.
@@ -193,19 +257,23 @@ lock_acquire (struct lock *lock) {
 	ASSERT (!lock_held_by_current_thread (lock));
 	
 	struct thread *curr = thread_current();
-	if(thread_mlfqs){
-		sema_down(&lock->semaphore);
-		lock->holder = curr;
-		return;
-	}
-	if(lock->holder){
+	enum intr_level old_level;
+
+	old_level = intr_disable ();
+	spinlock_acquire (&lock->semaphore.lock);
+	if(lock->holder && !thread_mlfqs){
+		spinlock_acquire (&donate_lock);
 		curr -> wait_on_lock = lock;
-		list_insert_ordered(&lock->holder->donations,&curr->d_elem,cmp_donation_priority,NULL);
-		priority_donation();
+		if (lock->max_priority < curr->priority)
+			lock->max_priority = curr->priority;
+		thread_donate_priority (lock->holder, curr->priority);
+		spinlock_release (&donate_lock);
 	}
-	sema_down (&lock->semaphore);
+	sema_down_locked (&lock->semaphore);
 	curr->wait_on_lock = NULL;
-	lock->holder = curr;
+	lock_take (lock);
+	spinlock_release (&lock->semaphore.lock);
+	intr_set_level (old_level);
 }
 
 /* Tries to acquires LOCK and returns true if successful or false
@@ -216,14 +284,21 @@ lock_acquire (struct lock *lock) {
    interrupt handler. */
 bool
 lock_try_acquire (struct lock *lock) {
+	enum intr_level old_level;
 	bool success;
 
 	ASSERT (lock != NULL);
 	ASSERT (!lock_held_by_current_thread (lock));
 
-	success = sema_try_down (&lock->semaphore);
-	if (success)
-		lock->holder = thread_current ();
+	old_level = intr_disable ();
+	spinlock_acquire (&lock->semaphore.lock);
+	success = lock->semaphore.value > 0;
+	if (success) {
+		lock->semaphore.value--;
+		lock_take (lock);
+	}
+	spinlock_release (&lock->semaphore.lock);
+	intr_set_level (old_level);
 	return success;
 }
 
@@ -235,18 +310,22 @@ lock_try_acquire (struct lock *lock) {
    handler. */
 void
 lock_release (struct lock *lock) {
+	enum intr_level old_level;
+
 	ASSERT (lock != NULL);
 	ASSERT (lock_held_by_current_thread (lock));
-	if(thread_mlfqs){
-		lock->holder = NULL;
-		sema_up(&lock->semaphore);
-		return;
-	}
-	remove_donation(lock);
-	re_priority();
+
+	old_level = intr_disable ();
+	spinlock_acquire (&lock->semaphore.lock);
+	list_remove (&lock->elem);
+	if (!thread_mlfqs)
+		re_priority();
 
 	lock->holder = NULL;
-	sema_up (&lock->semaphore);
+	sema_up_locked (&lock->semaphore);
+	spinlock_release (&lock->semaphore.lock);
+	thread_compare_priority ();
+	intr_set_level (old_level);
 }
 
 /* Returns true if the current thread holds LOCK, false
@@ -259,6 +338,261 @@ lock_held_by_current_thread (const struct lock *lock) {
 	return lock->holder == thread_current ();
 }
 
+/* Number of times lock_acquire_adaptive() polls a lock before
+   going to sleep on it. */
+#define LOCK_SPIN_CNT 100
+
+/* Acquires LOCK like lock_acquire(), but first polls it for a
+   short while as long as its holder is running on a CPU, on the
+   theory that a running holder will release it soon and that
+   polling is cheaper than a block/unblock round trip.  If the
+   holder is not running (it is ready, blocked, or there is no
+   other CPU for it to run on), spinning cannot help and we go
+   straight to sleep, with the usual priority donation.
+
+   The same restrictions as lock_acquire() apply. */
+void
+lock_acquire_adaptive (struct lock *lock) {
+	int i;
+
+	ASSERT (lock != NULL);
+	ASSERT (!intr_context ());
+	ASSERT (!lock_held_by_current_thread (lock));
+
+	for (i = 0; i < LOCK_SPIN_CNT; i++) {
+		struct thread *holder;
+
+		if (lock_try_acquire (lock))
+			return;
+
+		holder = lock->holder;
+		if (holder != NULL && holder->status != THREAD_RUNNING)
+			break;
+		asm volatile ("pause" : : : "memory");
+	}
+	lock_acquire (lock);
+}
+
+/* Initializes spinlock SL as free. */
+void
+spinlock_init (struct spinlock *sl) {
+	ASSERT (sl != NULL);
+
+	sl->locked = 0;
+	sl->holder = NULL;
+}
+
+/* Acquires SL, spinning until the CPU holding it lets go.
+   Interrupts must be off, and must stay off until SL is
+   released.  Spinlocks do not nest on one CPU. */
+void
+spinlock_acquire (struct spinlock *sl) {
+	ASSERT (sl != NULL);
+	ASSERT (intr_get_level () == INTR_OFF);
+	ASSERT (!spinlock_held_by_current_cpu (sl));
+
+	/* Spin on a plain load, so that waiting CPUs share the cache
+	   line until it is released, and only then try the
+	   exchange. */
+	while (__atomic_exchange_n (&sl->locked, 1, __ATOMIC_ACQUIRE))
+		while (__atomic_load_n (&sl->locked, __ATOMIC_RELAXED))
+			asm volatile ("pause" : : : "memory");
+	sl->holder = cpu_current ();
+}
+
+/* Releases SL, which the current CPU must hold. */
+void
+spinlock_release (struct spinlock *sl) {
+	ASSERT (sl != NULL);
+	ASSERT (spinlock_held_by_current_cpu (sl));
+
+	sl->holder = NULL;
+	__atomic_store_n (&sl->locked, 0, __ATOMIC_RELEASE);
+}
+
+/* Returns true if the current CPU holds SL, false otherwise. */
+bool
+spinlock_held_by_current_cpu (const struct spinlock *sl) {
+	ASSERT (sl != NULL);
+
+	return sl->locked && sl->holder == cpu_current ();
+}
+
+/* Initializes RW.  A reader-writer lock may be held by any
+   number of readers at once, or by a single writer.
+
+   Writers are preferred: once a writer is waiting, new readers
+   wait behind it, so that a stream of readers cannot starve
+   writers.  Threads waiting for the lock donate their priority
+   to the writer holding it, and a writer waiting for readers to
+   finish donates its priority to each of them. */
+void
+rwlock_init (struct rwlock *rw) {
+	ASSERT (rw != NULL);
+
+	lock_init (&rw->writer_lock);
+	sema_init (&rw->drained, 0);
+	list_init (&rw->readers);
+	rw->draining = false;
+	spinlock_init (&rw->lock);
+}
+
+/* Acquires RW for reading, sleeping until any writer holding or
+   waiting for it is done.  The current thread must not already
+   hold RW, and may hold at most RWLOCK_READ_MAX read locks.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void
+rwlock_acquire_read (struct rwlock *rw) {
+	struct thread *curr = thread_current ();
+	struct rwlock_reader *r = NULL;
+	enum intr_level old_level;
+	int i;
+
+	ASSERT (rw != NULL);
+	ASSERT (!intr_context ());
+	ASSERT (!rwlock_held_by_current_thread (rw));
+
+	for (i = 0; i < RWLOCK_READ_MAX; i++)
+		if (curr->rw_reads[i].rwlock == NULL) {
+			r = &curr->rw_reads[i];
+			break;
+		}
+	ASSERT (r != NULL);
+	r->thread = curr;
+
+	/* Fast path: no writer holds or waits for the lock.  A writer
+	   sets the holder before it looks for readers under RW's
+	   spinlock, so either it finds us there or we see it here. */
+	old_level = intr_disable ();
+	spinlock_acquire (&rw->lock);
+	if (rw->writer_lock.holder == NULL
+			&& list_empty (&rw->writer_lock.semaphore.waiters)) {
+		r->rwlock = rw;
+		list_push_back (&rw->readers, &r->elem);
+		spinlock_release (&rw->lock);
+		intr_set_level (old_level);
+		return;
+	}
+	spinlock_release (&rw->lock);
+	intr_set_level (old_level);
+
+	/* Slow path: queue up behind the writer. */
+	lock_acquire (&rw->writer_lock);
+	old_level = intr_disable ();
+	spinlock_acquire (&rw->lock);
+	r->rwlock = rw;
+	list_push_back (&rw->readers, &r->elem);
+	spinlock_release (&rw->lock);
+	intr_set_level (old_level);
+	lock_release (&rw->writer_lock);
+}
+
+/* Releases RW, which the current thread must hold for
+   reading.  If this was the last reader and a writer is waiting,
+   wakes the writer. */
+void
+rwlock_release_read (struct rwlock *rw) {
+	struct thread *curr = thread_current ();
+	struct rwlock_reader *r = NULL;
+	enum intr_level old_level;
+	bool drained;
+	int i;
+
+	ASSERT (rw != NULL);
+
+	for (i = 0; i < RWLOCK_READ_MAX; i++)
+		if (curr->rw_reads[i].rwlock == rw) {
+			r = &curr->rw_reads[i];
+			break;
+		}
+	ASSERT (r != NULL);
+
+	old_level = intr_disable ();
+	spinlock_acquire (&rw->lock);
+	list_remove (&r->elem);
+	r->rwlock = NULL;
+	if (!thread_mlfqs)
+		re_priority ();
+	drained = rw->draining && list_empty (&rw->readers);
+	spinlock_release (&rw->lock);
+	if (drained)
+		sema_up (&rw->drained);
+	else
+		thread_compare_priority ();
+	intr_set_level (old_level);
+}
+
+/* Acquires RW for writing, sleeping until no other thread holds
+   it.  The current thread must not already hold RW.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void
+rwlock_acquire_write (struct rwlock *rw) {
+	struct thread *curr = thread_current ();
+	enum intr_level old_level;
+
+	ASSERT (rw != NULL);
+	ASSERT (!intr_context ());
+	ASSERT (!rwlock_held_by_current_thread (rw));
+
+	/* Holding the writer lock keeps new readers out. */
+	lock_acquire (&rw->writer_lock);
+
+	/* Wait for the readers already inside to leave. */
+	old_level = intr_disable ();
+	spinlock_acquire (&rw->lock);
+	while (!list_empty (&rw->readers)) {
+		struct list_elem *e;
+
+		rw->draining = true;
+		if (!thread_mlfqs) {
+			spinlock_acquire (&donate_lock);
+			for (e = list_begin (&rw->readers); e != list_end (&rw->readers);
+					e = list_next (e))
+				thread_donate_priority (
+						list_entry (e, struct rwlock_reader, elem)->thread,
+						curr->priority);
+			spinlock_release (&donate_lock);
+		}
+		spinlock_release (&rw->lock);
+		sema_down (&rw->drained);
+		spinlock_acquire (&rw->lock);
+	}
+	rw->draining = false;
+	spinlock_release (&rw->lock);
+	intr_set_level (old_level);
+}
+
+/* Releases RW, which the current thread must hold for
+   writing. */
+void
+rwlock_release_write (struct rwlock *rw) {
+	ASSERT (rw != NULL);
+	ASSERT (lock_held_by_current_thread (&rw->writer_lock));
+
+	lock_release (&rw->writer_lock);
+}
+
+/* Returns true if the current thread holds RW for reading or for
+   writing, false otherwise. */
+bool
+rwlock_held_by_current_thread (const struct rwlock *rw) {
+	struct thread *curr = thread_current ();
+	int i;
+
+	ASSERT (rw != NULL);
+
+	if (lock_held_by_current_thread (&rw->writer_lock))
+		return true;
+	for (i = 0; i < RWLOCK_READ_MAX; i++)
+		if (curr->rw_reads[i].rwlock == rw)
+			return true;
+	return false;
+}
+
 /* One semaphore in a list. */
 struct semaphore_elem {
 	struct list_elem elem;              /* List element. */
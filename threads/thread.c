@@ -1,14 +1,21 @@
 #include "threads/thread.h"
 #include <debug.h>
+#include <inttypes.h>
 #include <stddef.h>
 #include <random.h>
 #include <stdio.h>
 #include <string.h>
+#include "devices/lapic.h"
+#include "devices/timer.h"
+#include "threads/cpu.h"
 #include "threads/flags.h"
+#include "threads/fpu.h"
 #include "threads/interrupt.h"
 #include "threads/intr-stubs.h"
 #include "threads/palloc.h"
+#include "threads/switch.h"
 #include "threads/synch.h"
+#include "threads/trace.h"
 #include "threads/vaddr.h"
 #include "threads/float.h"
 #include "intrinsic.h"
@@ -25,18 +32,28 @@
    Do not modify this value. */
 #define THREAD_BASIC 0xd42df210
 
-/* List of processes in THREAD_READY state, that is, processes
-   that are ready to run but not actually running. 
+/* List of all threads, and of threads in timer_sleep().
+   Threads in THREAD_READY state, that is, threads that are ready
+   to run but not actually running, are on the run queue of their
+   CPU, in struct cpu, along with the CPU's idle thread, its
+   destruction requests and its statistics.
 
-   THREAD_READY 상태의 프로세스 목록 
+   THREAD_READY 상태의 프로세스 목록은 CPU마다 struct cpu에 있다.
 */
 static struct list all_list;
-static struct list ready_list;
 static struct list sleep_list;
 // static struct list donations;
 
-/* Idle thread. */
-static struct thread *idle_thread;
+/* Protect all_list and sleep_list, which threads on any CPU
+   may change. */
+static struct spinlock all_lock;
+static struct spinlock sleep_lock;
+
+/* Protects priority donation: each thread's `priority' while it
+   takes or passes on a donation, the `max_priority' of the locks
+   it holds, and the chain of `wait_on_lock' and lock holders
+   that thread_donate_priority() follows. */
+struct spinlock donate_lock;
 
 /* Initial thread, the thread running init.c:main(). */
 static struct thread *initial_thread;
@@ -44,18 +61,29 @@ static struct thread *initial_thread;
 /* Lock used by allocate_tid(). */
 static struct lock tid_lock;
 
-/* Thread destruction requests */
-static struct list destruction_req;
-
-/* Statistics. */
-static long long idle_ticks;    /* # of timer ticks spent idle. */
-static long long kernel_ticks;  /* # of timer ticks in kernel threads. */
-static long long user_ticks;    /* # of timer ticks in user programs. */
-
 /* Scheduling. */
 #define TIMER_FREQ 100
 #define TIME_SLICE 4            /* # of timer ticks to give each thread. */
-static unsigned thread_ticks;   /* # of timer ticks since last yield. : 마지막 양보후 타이머틱 수*/
+
+/* Load balancing.
+
+   A CPU whose run queue is empty when it schedules, which is to
+   say one about to go idle, steals a thread from another queue
+   instead: the one whose first thread has the highest priority,
+   or the longest of those.  Of the victim's threads at the
+   highest priority that it can take, it prefers one that last
+   ran on the thief itself, then one that has been off the CPU longer
+   than CACHE_HOT_CYCLES and so has no cache footprint left to
+   lose, and otherwise takes the first.  A thread whose FPU state
+   is still loaded on its CPU stays put.
+
+   thread_tick() also runs balance() every BALANCE_TICKS, which
+   sends an idle CPU a reschedule IPI, and so makes it steal, for
+   each thread waiting in a queue anywhere.  Without it a CPU
+   that went idle would sleep through new work queued elsewhere
+   until something else woke it. */
+#define BALANCE_TICKS 4
+#define CACHE_HOT_CYCLES 1000000
 
 /* If false (default), use round-robin scheduler.
    If true, use multi-level feedback queue scheduler.
@@ -63,12 +91,25 @@ static unsigned thread_ticks;   /* # of timer ticks since last yield. : 마지
 bool thread_mlfqs;
 
 static void kernel_thread (thread_func *, void *aux);
+static void *alloc_frame (struct thread *, size_t size);
+
+/* Offset of `stack' member within `struct thread'.
+   Used by switch.S, which can't figure it out on its own. */
+const uint64_t thread_stack_ofs = offsetof (struct thread, stack);
 
 static void idle (void *aux UNUSED);
+static void idle_loop (void) NO_RETURN;
+static void rq_push (struct thread *);
 static struct thread *next_thread_to_run (void);
+static struct thread *steal (struct cpu *thief);
+static void wake (struct cpu *);
+static void wake_idle (void);
+static void balance (void);
 static void init_thread (struct thread *, const char *name, int priority);
 static void do_schedule(int status);
 static void schedule (void);
+static uint64_t thread_account (struct thread *, uint64_t *counter);
+static void cpu_account (struct thread *, uint64_t cycles);
 static tid_t allocate_tid (void);
 
 #define load_fir_co divide_xbyn (convert_ntox (59), 60)
@@ -172,9 +213,10 @@ thread_init (void) {
 	/* Init the globla thread context : 자료구조 초기화 */
 	lock_init (&tid_lock);
 	list_init (&all_list);
-	list_init (&ready_list);
-	list_init (&destruction_req);
 	list_init (&sleep_list);
+	spinlock_init (&all_lock);
+	spinlock_init (&sleep_lock);
+	spinlock_init (&donate_lock);
 	// list_init (&donations);
 
 	load_avg = 0;
@@ -182,7 +224,10 @@ thread_init (void) {
 	/* Set up a thread structure for the running thread.: 현재 실행중인 스레드 정보 설정 */
 	initial_thread = running_thread ();
 	init_thread (initial_thread, "main", PRI_DEFAULT);
+	initial_thread->cpu = cpu_init_bsp ();
+	initial_thread->cpu->running = initial_thread;
 	initial_thread->status = THREAD_RUNNING;
+	initial_thread->on_cpu = true;
 	initial_thread->tid = allocate_tid ();
 }
 
@@ -214,28 +259,83 @@ thread_start (void) {
 */
 void
 thread_tick (void) {
-	struct thread *t = thread_current ();
+	struct cpu *c = cpu_current ();
+	unsigned i;
 
-	/* Update statistics. */
-	if (t == idle_thread)
-		idle_ticks++;
+	/* Update statistics.  Only the bootstrap processor takes timer
+	   interrupts, so it samples what every CPU is running. */
+	for (i = 0; i < cpu_cnt; i++) {
+		struct cpu *other = &cpus[i];
+		struct thread *t = other->running;
+
+		if (t == other->idle_thread)
+			other->idle_ticks++;
 #ifdef USERPROG
-	else if (t->pml4 != NULL)
-		user_ticks++;
+		else if (t->pml4 != NULL)
+			other->user_ticks++;
 #endif
-	else
-		kernel_ticks++;
+		else
+			other->kernel_ticks++;
+	}
 
 	/* Enforce preemption. */
-	if (++thread_ticks >= TIME_SLICE)
+	if (++c->slice_ticks >= TIME_SLICE)
+		intr_yield_on_return ();
+
+	/* Spread waiting threads over the CPUs. */
+	if (cpu_cnt > 1 && ++c->balance_ticks >= BALANCE_TICKS) {
+		c->balance_ticks = 0;
+		balance ();
+	}
+}
+
+/* Called by the local APIC timer interrupt handler at each timer
+   tick of an application processor, which the 8254 that drives
+   thread_tick() does not reach.  Thus, this function runs in an
+   external interrupt context. */
+void
+thread_tick_ap (void) {
+	struct cpu *c = cpu_current ();
+
+	/* Enforce preemption. */
+	if (++c->slice_ticks >= TIME_SLICE)
 		intr_yield_on_return ();
 }
 
 /* Prints thread statistics. */
 void
 thread_print_stats (void) {
+	long long idle_ticks = 0, kernel_ticks = 0, user_ticks = 0;
+	unsigned i;
+
+	for (i = 0; i < cpu_cnt; i++) {
+		idle_ticks += cpus[i].idle_ticks;
+		kernel_ticks += cpus[i].kernel_ticks;
+		user_ticks += cpus[i].user_ticks;
+	}
 	printf ("Thread: %lld idle ticks, %lld kernel ticks, %lld user ticks\n",
 			idle_ticks, kernel_ticks, user_ticks);
+	if (cpu_cnt > 1)
+		for (i = 0; i < cpu_cnt; i++)
+			printf ("CPU %u: %"PRIu64" us idle, %"PRIu64" us kernel, "
+					"%"PRIu64" us user, %lld threads stolen\n", i,
+					timer_cycles_to_ns (cpus[i].idle_cycles) / 1000,
+					timer_cycles_to_ns (cpus[i].kernel_cycles) / 1000,
+					timer_cycles_to_ns (cpus[i].user_cycles) / 1000,
+					cpus[i].steal_cnt);
+
+	/* With -trace, also print the per-thread cycle counts, for
+	   utils/pintos-trace: tid, running, ready, blocked, name. */
+	if (trace_dump_on_exit) {
+		struct list_elem *e;
+
+		for (e = list_begin (&all_list); e != list_end (&all_list);
+				e = list_next (e)) {
+			struct thread *t = list_entry (e, struct thread, all_elem);
+			printf ("TN %d %llu %llu %llu %s\n", t->tid, t->run_cycles,
+					t->ready_cycles, t->blocked_cycles, t->name);
+		}
+	}
 }
 
 /* Creates a new kernel thread named NAME with the given initial
@@ -265,6 +365,7 @@ tid_t
 thread_create (const char *name, int priority,
 		thread_func *function, void *aux) { //이름,우선순위,인자
 		                                    //함수(쓰레드가 실행할 함수 => 쓰레드가 실행될때 함수 실행되고 함수종료되면 쓰레드 종료, main()처럼 작동한다.)
+	struct switch_frame *sf;
 	struct thread *t;
 	tid_t tid;
 
@@ -277,24 +378,15 @@ thread_create (const char *name, int priority,
 
 	/* Initialize thread. */
 	init_thread (t, name, priority);
-	t->fdt = palloc_get_multiple(PAL_ZERO,FDT_PAGES);
-	if(t -> fdt  == NULL)
-		return TID_ERROR;
-	t->fd_index = 2; // 0은 stdin 1은 stdout
-	t->fdt[0] = 1;
-	t->fdt[1] = 2;
 	tid = t->tid = allocate_tid ();
 
-	/* Call the kernel_thread if it scheduled.
-	 * Note) rdi is 1st argument, and rsi is 2nd argument. */
-	t->tf.rip = (uintptr_t) kernel_thread;
-	t->tf.R.rdi = (uint64_t) function;
-	t->tf.R.rsi = (uint64_t) aux;
-	t->tf.ds = SEL_KDSEG;
-	t->tf.es = SEL_KDSEG;
-	t->tf.ss = SEL_KDSEG;
-	t->tf.cs = SEL_KCSEG;
-	t->tf.eflags = FLAG_IF;
+	/* Stack frame for switch_to(), which "returns" into
+	 * switch_entry(), which calls kernel_thread (FUNCTION, AUX). */
+	sf = alloc_frame (t, sizeof *sf);
+	sf->rbx = (uint64_t) kernel_thread;
+	sf->r12 = (uint64_t) function;
+	sf->r13 = (uint64_t) aux;
+	sf->rip = switch_entry;
 
 	/* Add to run queue. 
 	우선 순위 비교해준다음에 넣어주는 코드 만들어주기
@@ -320,6 +412,21 @@ thread_block (void) {
 	schedule ();
 }
 
+/* Puts the current thread to sleep like thread_block(), and
+   releases SL, which the caller holds to keep whoever will wake
+   the thread from seeing it before it is marked blocked.  The
+   thread may be woken as soon as SL is released, before it is
+   even off the CPU, so thread_unblock() waits for it to get
+   off. */
+void
+thread_block_unlock (struct spinlock *sl) {
+	ASSERT (!intr_context ());
+	ASSERT (intr_get_level () == INTR_OFF);
+	thread_current ()->status = THREAD_BLOCKED;
+	spinlock_release (sl);
+	schedule ();
+}
+
 /* Transitions a blocked thread T to the ready-to-run state.
    This is an error if T is not blocked.  (Use thread_yield() to
    make the running thread ready.)
@@ -337,10 +444,25 @@ thread_unblock (struct thread *t) {
 	ASSERT (is_thread (t));
 
 	old_level = intr_disable ();
+
+	/* T may still be switching away on another CPU, after
+	   thread_block_unlock(). */
+	while (__atomic_load_n (&t->on_cpu, __ATOMIC_ACQUIRE))
+		asm volatile ("pause" : : : "memory");
 	ASSERT (t->status == THREAD_BLOCKED); 
-	// list_push_back (&ready_list, &t->elem);
-	list_insert_ordered(&ready_list,&t->elem,cmp_priority,NULL);
-	t->status = THREAD_READY;
+	rq_push (t);
+	thread_account (t, &t->blocked_cycles);
+	trace_record (TRACE_WAKEUP, t, 0,
+			intr_context () ? NULL : running_thread ());
+
+	/* Wake up T's CPU if it is another one, which may be idle.
+	   If it is ours and T will have to wait for the running
+	   thread, let an idle CPU come and steal it. */
+	if (t->cpu != cpu_current ())
+		wake (t->cpu);
+	else if (cpu_cnt > 1 && running_thread () != t->cpu->idle_thread
+			&& t->priority <= running_thread ()->priority)
+		wake_idle ();
 	intr_set_level (old_level);
 }
 
@@ -383,11 +505,15 @@ thread_exit (void) {
 #ifdef USERPROG
 	process_exit ();
 #endif
+	fpu_reset ();
 
 	/* Just set our status to dying and schedule another process.
 	   We will be destroyed during the call to schedule_tail(). */
 	intr_disable ();
+	trace_record (TRACE_EXIT, thread_current (), 0, NULL);
+	spinlock_acquire (&all_lock);
 	list_remove(&thread_current()->all_elem);
+	spinlock_release (&all_lock);
 	do_schedule (THREAD_DYING);
 	NOT_REACHED ();
 }
@@ -401,15 +527,11 @@ thread_exit (void) {
 */
 void
 thread_yield (void) {
-	struct thread *curr = thread_current ();
 	enum intr_level old_level;
 
 	ASSERT (!intr_context ());
 
 	old_level = intr_disable ();
-	if (curr != idle_thread)
-		//list_push_back (&ready_list, &curr->elem);
-		list_insert_ordered(&ready_list,&curr->elem,cmp_priority,NULL);
 	do_schedule (THREAD_READY);
 	intr_set_level (old_level);
 }
@@ -473,34 +595,69 @@ thread_get_recent_cpu (void) {
    초기에 한 번 스케줄 되고 thread_start()가 진행 될수 있도록 세마포어를 up(잠금 풀어주고) 하고  idle thread 즉시 블록 
    이후에는 idle thread는 준비목록에 나타나지 않는다.
    next_thread_to_run()의해 반환 된다.
+
+   This is the bootstrap processor's idle thread.  Each
+   application processor gets one from thread_create_idle().
    
 */
 static void
 idle (void *idle_started_ UNUSED) {
 	struct semaphore *idle_started = idle_started_;
 
-	idle_thread = thread_current ();
+	thread_current ()->cpu->idle_thread = thread_current ();
 	// idle_thread->recent_cpu = 0;
 	sema_up (idle_started);
+	idle_loop ();
+}
+
+/* Makes the idle thread for application processor C, which
+   starts out running it, and returns it, or a null pointer if
+   memory runs out.  Called by smp_init() on the bootstrap
+   processor. */
+struct thread *
+thread_create_idle (struct cpu *c) {
+	struct thread *t;
+	char name[16];
 
+	t = palloc_get_page (PAL_ZERO);
+	if (t == NULL)
+		return NULL;
+
+	snprintf (name, sizeof name, "idle%u", c->id);
+	init_thread (t, name, PRI_MIN);
+	t->tid = allocate_tid ();
+	t->status = THREAD_RUNNING;
+	t->on_cpu = true;
+	t->cpu = c;
+	c->idle_thread = t;
+	c->running = t;
+	return t;
+}
+
+/* Called by ap_main() once it has set up an application
+   processor, which is running its idle thread with interrupts
+   off.  Starts scheduling the processor's run queue. */
+void
+thread_start_ap (void) {
+	struct thread *t = thread_current ();
+
+	ASSERT (t == t->cpu->idle_thread);
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	t->state_tsc = rdtsc ();
+	idle_loop ();
+}
+
+/* Body of every idle thread. */
+static void
+idle_loop (void) {
 	for (;;) {
 		/* Let someone else run. */
 		intr_disable ();
 		thread_block ();
 
-		/* Re-enable interrupts and wait for the next one.
-
-		   The `sti' instruction disables interrupts until the
-		   completion of the next instruction, so these two
-		   instructions are executed atomically.  This atomicity is
-		   important; otherwise, an interrupt could be handled
-		   between re-enabling interrupts and waiting for the next
-		   one to occur, wasting as much as one clock tick worth of
-		   time.
-
-		   See [IA32-v2a] "HLT", [IA32-v2b] "STI", and [IA32-v3a]
-		   7.11.1 "HLT Instruction". */
-		asm volatile ("sti; hlt" : : : "memory");
+		/* Re-enable interrupts and wait for the next one. */
+		intr_wait ();
 	}
 }
 
@@ -519,24 +676,33 @@ kernel_thread (thread_func *function, void *aux) {
    NAME. */
 static void
 init_thread (struct thread *t, const char *name, int priority) {
+	enum intr_level old_level;
+
 	ASSERT (t != NULL);
 	ASSERT (PRI_MIN <= priority && priority <= PRI_MAX);
 	ASSERT (name != NULL);
 
 	memset (t, 0, sizeof *t);
 	t->status = THREAD_BLOCKED;
+	t->cpu = running_thread ()->cpu;    /* Start on our creator's CPU. */
 	strlcpy (t->name, name, sizeof t->name);
-	t->tf.rsp = (uint64_t) t + PGSIZE - sizeof (void *);
+	t->stack = (uint8_t *) t + PGSIZE;
 	t->priority = priority;
 	t->magic = THREAD_MAGIC;
 	t->init_priority = priority;
+	t->state_tsc = rdtsc ();
 	t->wait_on_lock = NULL;
 	t->nice = 0;
 	t->recent_cpu = 0;
-	t->runn_file = NULL;
+	t->exec_image = NULL;
 	// t->recent_cpu = thread_current ()->recent_cpu;
-	list_init (&t->donations);
+	list_init (&t->locks);
+
+	old_level = intr_disable ();
+	spinlock_acquire (&all_lock);
 	list_push_back (&all_list, &t->all_elem);
+	spinlock_release (&all_lock);
+	intr_set_level (old_level);
 
 	//project 2
 	list_init (&t->child_list);
@@ -545,6 +711,18 @@ init_thread (struct thread *t, const char *name, int priority) {
 	sema_init(&t->load_sema,0);
 }
 
+/* Allocates a SIZE-byte frame at the top of thread T's stack and
+   returns a pointer to the frame's base. */
+static void *
+alloc_frame (struct thread *t, size_t size) {
+	/* Stack data is always allocated in word-size units. */
+	ASSERT (is_thread (t));
+	ASSERT (size % sizeof (uint64_t) == 0);
+
+	t->stack -= size;
+	return t->stack;
+}
+
 /* Chooses and returns the next thread to be scheduled.  Should
    return a thread from the run queue, unless the run queue is
    empty.  (If the running thread can continue running, then it
@@ -556,15 +734,175 @@ init_thread (struct thread *t, const char *name, int priority) {
 */
 static struct thread *
 next_thread_to_run (void) {
-	if (list_empty (&ready_list))
-		return idle_thread;
-	else
-		return list_entry (list_pop_front (&ready_list), struct thread, elem);
+	struct cpu *c = cpu_current ();
+	struct thread *next = NULL;
+
+	spinlock_acquire (&c->rq_lock);
+	if (!list_empty (&c->ready_list)) {
+		next = list_entry (list_pop_front (&c->ready_list),
+				struct thread, elem);
+		next->status = THREAD_RUNNING;
+	}
+	spinlock_release (&c->rq_lock);
+
+	if (next == NULL && cpu_cnt > 1)
+		next = steal (c);
+	if (next == NULL)
+		next = c->idle_thread;
+	return next;
+}
+
+/* Takes a thread off the run queue of another CPU for
+   THIEF to run, as described at the top of this file, and
+   returns it, or a null pointer if there is none to take.
+   Interrupts must be off. */
+static struct thread *
+steal (struct cpu *thief) {
+	struct cpu *victim = NULL;
+	struct thread *best = NULL;
+	int best_rank = -1;
+	int top = PRI_MIN - 1;
+	size_t most = 0;
+	struct list_elem *e;
+	uint64_t now;
+	unsigned i;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	for (i = 0; i < cpu_cnt; i++) {
+		struct cpu *c = &cpus[i];
+		int pri = PRI_MIN - 1;
+		size_t n;
+
+		if (c == thief || !c->online)
+			continue;
+		spinlock_acquire (&c->rq_lock);
+		n = list_size (&c->ready_list);
+		if (n > 0)
+			pri = list_entry (list_front (&c->ready_list),
+					struct thread, elem)->priority;
+		spinlock_release (&c->rq_lock);
+		if (n > 0 && (pri > top || (pri == top && n > most))) {
+			top = pri;
+			most = n;
+			victim = c;
+		}
+	}
+	if (victim == NULL)
+		return NULL;
+
+	/* Rank the candidates: 2 if THIEF still has them in its cache,
+	   1 if nobody does, 0 if their own CPU does. */
+	now = rdtsc ();
+	spinlock_acquire (&victim->rq_lock);
+	for (e = list_begin (&victim->ready_list);
+			e != list_end (&victim->ready_list); e = list_next (e)) {
+		struct thread *t = list_entry (e, struct thread, elem);
+		int rank;
+
+		if (best != NULL && t->priority < best->priority)
+			break;
+		if (fpu_loaded (t) || t->on_cpu)
+			continue;
+		if (t->last_cpu == thief)
+			rank = 2;
+		else if (now - t->last_ran >= CACHE_HOT_CYCLES)
+			rank = 1;
+		else
+			rank = 0;
+		if (rank > best_rank) {
+			best = t;
+			best_rank = rank;
+			if (rank == 2)
+				break;
+		}
+	}
+	if (best != NULL) {
+		list_remove (&best->elem);
+		best->status = THREAD_RUNNING;
+		best->cpu = thief;
+		thief->steal_cnt++;
+	}
+	spinlock_release (&victim->rq_lock);
+	return best;
+}
+
+/* Sends C a reschedule IPI, unless it already has one it has not
+   acted on.  Interrupts must be off. */
+static void
+wake (struct cpu *c) {
+	if (!__atomic_exchange_n (&c->wake_pending, true, __ATOMIC_SEQ_CST))
+		lapic_send_ipi (c->apic_id, LAPIC_VEC_RESCHED);
+}
+
+/* Wakes one idle CPU, if there is one that is not already
+   waking up, to steal work.  Interrupts must be off. */
+static void
+wake_idle (void) {
+	unsigned i;
+
+	for (i = 0; i < cpu_cnt; i++) {
+		struct cpu *c = &cpus[i];
+
+		if (c->running == c->idle_thread && !c->wake_pending) {
+			wake (c);
+			return;
+		}
+	}
+}
+
+/* Periodic load balancing, from thread_tick(): wakes an idle CPU
+   for each thread waiting in a run queue. */
+static void
+balance (void) {
+	size_t waiting = 0;
+	unsigned i;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	for (i = 0; i < cpu_cnt; i++) {
+		struct cpu *c = &cpus[i];
+
+		spinlock_acquire (&c->rq_lock);
+		waiting += list_size (&c->ready_list);
+		spinlock_release (&c->rq_lock);
+	}
+
+	for (i = 0; i < cpu_cnt && waiting > 0; i++) {
+		struct cpu *c = &cpus[i];
+
+		if (c != cpu_current () && c->running == c->idle_thread
+				&& !c->wake_pending) {
+			wake (c);
+			waiting--;
+		}
+	}
+}
+
+/* Marks T ready and puts it on its CPU's run queue in priority
+   order.  Interrupts must be off.
+
+   A thread's status changes to and from THREAD_READY only under
+   the rq_lock of the queue it is on, so that another CPU that
+   holds the lock and finds the thread ready also finds it in the
+   queue. */
+static void
+rq_push (struct thread *t) {
+	struct cpu *c = t->cpu;
+
+	spinlock_acquire (&c->rq_lock);
+	t->status = THREAD_READY;
+	list_insert_ordered (&c->ready_list, &t->elem, cmp_priority, NULL);
+	spinlock_release (&c->rq_lock);
 }
 
-/* Use iretq to launch the thread */
+/* Use iretq to enter user mode with the context in TF. */
 void
 do_iret (struct intr_frame *tf) {
+	/* `iretq' turns interrupts back on without intr_enable(). */
+	intr_disable ();
+	intr_leave ();
+
 	__asm __volatile(
 			"movq %0, %%rsp\n"
 			"movq 0(%%rsp),%%r15\n"
@@ -590,83 +928,6 @@ do_iret (struct intr_frame *tf) {
 			: : "g" ((uint64_t) tf) : "memory");
 }
 
-/* Switching the thread by activating the new thread's page
-   tables, and, if the previous thread is dying, destroying it.
-
-   At this function's invocation, we just switched from thread
-   PREV, the new thread is already running, and interrupts are
-   still disabled.
-
-   It's not safe to call printf() until the thread switch is
-   complete.  In practice that means that printf()s should be
-   added at the end of the function. 
-   
-   =====이해 할 필요 없는 함수====
-   스레드를 전환하는 과정
-   현재 실행중인 스레드의 상태를 저장하고 전환중인 스레드의 상태를 복원
-   새로운 스레드는 이미 실행중이며 인터럽트는 아직 비활성화 된 상태 
-
-   함수 실행시 전환 진행중이니 printf는 함수의 끝부분에 할것
-*/
-static void
-thread_launch (struct thread *th) {
-	uint64_t tf_cur = (uint64_t) &running_thread ()->tf;
-	uint64_t tf = (uint64_t) &th->tf;
-	ASSERT (intr_get_level () == INTR_OFF);
-
-	/* The main switching logic.
-	 * We first restore the whole execution context into the intr_frame
-	 * and then switching to the next thread by calling do_iret.
-	 * Note that, we SHOULD NOT use any stack from here
-	 * until switching is done. */
-	__asm __volatile (
-			/* Store registers that will be used. */
-			"push %%rax\n"
-			"push %%rbx\n"
-			"push %%rcx\n"
-			/* Fetch input once */
-			"movq %0, %%rax\n"
-			"movq %1, %%rcx\n"
-			"movq %%r15, 0(%%rax)\n"
-			"movq %%r14, 8(%%rax)\n"
-			"movq %%r13, 16(%%rax)\n"
-			"movq %%r12, 24(%%rax)\n"
-			"movq %%r11, 32(%%rax)\n"
-			"movq %%r10, 40(%%rax)\n"
-			"movq %%r9, 48(%%rax)\n"
-			"movq %%r8, 56(%%rax)\n"
-			"movq %%rsi, 64(%%rax)\n"
-			"movq %%rdi, 72(%%rax)\n"
-			"movq %%rbp, 80(%%rax)\n"
-			"movq %%rdx, 88(%%rax)\n"
-			"pop %%rbx\n"              // Saved rcx
-			"movq %%rbx, 96(%%rax)\n"
-			"pop %%rbx\n"              // Saved rbx
-			"movq %%rbx, 104(%%rax)\n"
-			"pop %%rbx\n"              // Saved rax
-			"movq %%rbx, 112(%%rax)\n"
-			"addq $120, %%rax\n"
-			"movw %%es, (%%rax)\n"
-			"movw %%ds, 8(%%rax)\n"
-			"addq $32, %%rax\n"
-			"call __next\n"         // read the current rip.
-			"__next:\n"
-			"pop %%rbx\n"
-			"addq $(out_iret -  __next), %%rbx\n"
-			"movq %%rbx, 0(%%rax)\n" // rip
-			"movw %%cs, 8(%%rax)\n"  // cs
-			"pushfq\n"
-			"popq %%rbx\n"
-			"mov %%rbx, 16(%%rax)\n" // eflags
-			"mov %%rsp, 24(%%rax)\n" // rsp
-			"movw %%ss, 32(%%rax)\n"
-			"mov %%rcx, %%rdi\n"
-			"call do_iret\n"
-			"out_iret:\n"
-			: : "g"(tf_cur), "g" (tf) : "memory"
-			);
-}
-
 /* Schedules a new process. At entry, interrupts must be off.
  * This function modify current thread's status to status and then
  * finds another thread to run and switches to it.
@@ -680,37 +941,52 @@ thread_launch (struct thread *th) {
 */
 static void
 do_schedule(int status) {
+	struct thread *curr = thread_current ();
+	struct cpu *c = cpu_current ();
+
 	ASSERT (intr_get_level () == INTR_OFF);
-	ASSERT (thread_current()->status == THREAD_RUNNING);
-	while (!list_empty (&destruction_req)) {
+	ASSERT (curr->status == THREAD_RUNNING);
+	while (!list_empty (&c->destruction_req)) {
 		struct thread *victim =
-			list_entry (list_pop_front (&destruction_req), struct thread, elem);
+			list_entry (list_pop_front (&c->destruction_req), struct thread, elem);
 		palloc_free_page(victim);
 	}
-	thread_current ()->status = status;
+	if (status == THREAD_READY && curr != c->idle_thread)
+		rq_push (curr);
+	else
+		curr->status = status;
 	schedule ();
 }
 
 static void
 schedule (void) {
 	struct thread *curr = running_thread ();
-	struct thread *next = next_thread_to_run ();
+	struct thread *next;
 
 	ASSERT (intr_get_level () == INTR_OFF);
 	ASSERT (curr->status != THREAD_RUNNING);
+
+	/* A reschedule IPI sent from here on finds the run queue
+	   changed, so it must not be taken for one already acted
+	   on. */
+	__atomic_store_n (&curr->cpu->wake_pending, false, __ATOMIC_SEQ_CST);
+	next = next_thread_to_run ();
 	ASSERT (is_thread (next));
+
 	/* Mark us as running. */
 	next->status = THREAD_RUNNING;
+	curr->cpu->running = next;
 
 	/* Start new time slice. */
-	thread_ticks = 0;
+	curr->cpu->slice_ticks = 0;
 
+	if (curr != next) {
 #ifdef USERPROG
-	/* Activate the new address space. */
-	process_activate (next);
+		/* Activate the new address space. */
+		process_activate (next);
 #endif
+		fpu_switch (next);
 
-	if (curr != next) {
 		/* If the thread we switched from is dying, destroy its struct
 		   thread. This must happen late so that thread_exit() doesn't
 		   pull out the rug under itself.
@@ -720,15 +996,63 @@ schedule (void) {
 		   schedule(). */
 		if (curr && curr->status == THREAD_DYING && curr != initial_thread) {
 			ASSERT (curr != next);
-			list_push_back (&destruction_req, &curr->elem);
+			list_push_back (&curr->cpu->destruction_req, &curr->elem);
 		}
 
-		/* Before switching the thread, we first save the information
-		 * of current running. */
-		thread_launch (next);
+		cpu_account (curr, thread_account (curr, &curr->run_cycles));
+		thread_account (next, &next->ready_cycles);
+		curr->last_cpu = curr->cpu;
+		curr->last_ran = curr->state_tsc;
+		trace_record (TRACE_SWITCH, next, curr->status, curr);
+
+		/* Save our callee-saved registers and stack pointer and
+		 * resume NEXT.  Kernel threads never need the full
+		 * intr_frame; user context lives in the one pushed on
+		 * entry to the kernel. */
+		ASSERT (!next->on_cpu);
+		next->on_cpu = true;
+		thread_schedule_tail (switch_to (curr, next));
 	}
 }
 
+/* Called by a thread that switch_to() has just resumed, with
+   interrupts off, to say that PREV, the thread it switched from,
+   is off the CPU, so that another CPU may now wake it or run
+   it. */
+void
+thread_schedule_tail (struct thread *prev) {
+	__atomic_store_n (&prev->on_cpu, false, __ATOMIC_RELEASE);
+}
+
+/* Charges the time since T's last status change to *COUNTER,
+   one of T's cycle counters, and starts timing T's new
+   status.  Returns the number of cycles charged. */
+static uint64_t
+thread_account (struct thread *t, uint64_t *counter) {
+	uint64_t now = rdtsc ();
+	uint64_t cycles = now - t->state_tsc;
+
+	*counter += cycles;
+	t->state_tsc = now;
+	return cycles;
+}
+
+/* Charges CYCLES that T just spent running to T's CPU, as idle,
+   kernel or user time, the way thread_tick() samples it. */
+static void
+cpu_account (struct thread *t, uint64_t cycles) {
+	struct cpu *c = t->cpu;
+
+	if (t == c->idle_thread)
+		c->idle_cycles += cycles;
+#ifdef USERPROG
+	else if (t->pml4 != NULL)
+		c->user_cycles += cycles;
+#endif
+	else
+		c->kernel_cycles += cycles;
+}
+
 /* Returns a tid to use for a new thread. */
 static tid_t
 allocate_tid (void) {
@@ -750,16 +1074,19 @@ void thread_sleep(int64_t ticks){
 
 	old_level = intr_disable ();
 
-	if (curr != idle_thread){
+	if (curr != curr->cpu->idle_thread){
 		curr->awake = ticks;
+		spinlock_acquire (&sleep_lock);
 		list_push_back (&sleep_list, &curr->elem);
-		thread_block();
+		trace_record (TRACE_BLOCK, curr, TRACE_WAIT_SLEEP, NULL);
+		thread_block_unlock (&sleep_lock);
 	}
 	intr_set_level (old_level);
 }
 
 void thread_awake(int64_t ticks){
 
+	spinlock_acquire (&sleep_lock);
 	struct list_elem *curr = list_begin(&sleep_list);
 	while(curr != list_tail(&sleep_list)) {
 		struct thread *t = list_entry(curr,struct thread,elem);
@@ -770,6 +1097,7 @@ void thread_awake(int64_t ticks){
 			curr = list_next(curr);
 		}
 	}
+	spinlock_release (&sleep_lock);
 }
 
 bool cmp_priority (const struct list_elem *a,const struct list_elem *b,void *aux){
@@ -780,77 +1108,133 @@ bool cmp_priority (const struct list_elem *a,const struct list_elem *b,void *aux
 
 void thread_compare_priority(void){
 	struct thread *curr = thread_current();
+	struct cpu *c = curr->cpu;
+	enum intr_level old_level;
+	bool preempt;
+
+	old_level = intr_disable ();
+	spinlock_acquire (&c->rq_lock);
+	preempt = !list_empty (&c->ready_list) && 
+    curr->priority < 
+    list_entry (list_front (&c->ready_list), struct thread, elem)->priority;
+	spinlock_release (&c->rq_lock);
+	intr_set_level (old_level);
 
-	if (!list_empty (&ready_list) && 
-    thread_current ()->priority < 
-    list_entry (list_front (&ready_list), struct thread, elem)->priority)
+	if (preempt)
         thread_yield ();
 
 }
 
-bool cmp_donation_priority (const struct list_elem *a,const struct list_elem *b,void *aux){
-	int a_priority = list_entry(a,struct thread,d_elem) -> priority;
-	int b_priority = list_entry(b,struct thread,d_elem) -> priority;
-	return a_priority > b_priority;
-} 
-
-void priority_donation(void){
-	int depth;
+/* Recomputes the current thread's effective priority: the
+   highest of its own priority, the top waiter priority of each
+   lock it holds, and the priority of any writer waiting for it
+   to drop a read lock.  Takes time proportional to the number of
+   locks held, since each lock already knows its top waiter. */
+void re_priority(void){
 	struct thread *curr = thread_current();
-	for(depth = 0; depth<8; depth++){
-		if(!curr->wait_on_lock) break;
-		struct thread *holder =  curr->wait_on_lock->holder;
-		holder->priority = curr->priority;
-		curr = holder;
+	struct list_elem *e;
+	enum intr_level old_level;
+
+	/* With nothing donated, there is nothing to take back.  A
+	   donation that arrives meanwhile is for a lock we still hold,
+	   since lock_release() holds the spinlock of the one it
+	   releases. */
+	if (curr->priority == curr->init_priority)
+		return;
+
+	old_level = intr_disable ();
+	spinlock_acquire (&donate_lock);
+	curr->priority =  curr->init_priority;
+
+	for (e = list_begin (&curr->locks); e != list_end (&curr->locks);
+			e = list_next (e)) {
+		struct lock *lock = list_entry (e, struct lock, elem);
+		if (curr->priority < lock->max_priority)
+			curr->priority = lock->max_priority;
 	}
-}
 
-void remove_donation(struct lock *lock){
-	struct list_elem *e;
-	struct thread *curr = thread_current();
-	for(e = list_begin(&curr->donations);e != list_end(&curr->donations); e = list_next(e)){
-		struct thread *t = list_entry(e,struct thread,d_elem);
-		if(t->wait_on_lock == lock){
-			list_remove(&t->d_elem);
-		}
+	/* A writer waiting for us to drop a read lock donates to us. */
+	for (int i = 0; i < RWLOCK_READ_MAX; i++) {
+		struct rwlock *rw = curr->rw_reads[i].rwlock;
+		struct thread *writer;
+
+		if (rw == NULL || !rw->draining)
+			continue;
+		writer = rw->writer_lock.holder;
+		if (writer != NULL && curr->priority < writer->priority)
+			curr->priority = writer->priority;
 	}
+	spinlock_release (&donate_lock);
+	intr_set_level (old_level);
 }
 
-void re_priority(void){
-	struct thread *curr = thread_current();
-	curr->priority =  curr->init_priority;
-	
-	if(!list_empty(&curr->donations)){
-		list_sort(&curr->donations,cmp_donation_priority,NULL);
-		struct thread *front = list_entry(list_front(&curr->donations),struct thread,d_elem);
-		
-		if(curr->priority < front->priority)
-			curr->priority = front->priority;
+/* Raises T's priority to at least PRIORITY, keeping the ready
+   list ordered, and passes the donation on along the chain of
+   locks T is waiting for, updating each lock's top waiter
+   priority on the way.  Stops as soon as a thread already runs
+   at PRIORITY or higher, so a chain of any length is followed
+   exactly as far as it needs to be, and a deadlocked cycle of
+   waiters cannot make it loop.  The caller must hold
+   donate_lock. */
+void
+thread_donate_priority (struct thread *t, int priority) {
+	ASSERT (spinlock_held_by_current_cpu (&donate_lock));
+
+	while (t != NULL && t->priority < priority) {
+		struct lock *lock = t->wait_on_lock;
+
+		t->priority = priority;
+		trace_record (TRACE_DONATE, t, priority, running_thread ());
+		if (t->status == THREAD_READY) {
+			/* T may be stolen or start running before we get
+			   the lock; if it is still ready there, it is still
+			   in that queue. */
+			struct cpu *c = t->cpu;
+
+			spinlock_acquire (&c->rq_lock);
+			if (t->status == THREAD_READY && t->cpu == c) {
+				list_remove (&t->elem);
+				list_insert_ordered (&c->ready_list, &t->elem,
+						cmp_priority, NULL);
+			}
+			spinlock_release (&c->rq_lock);
+		}
+		if (lock == NULL)
+			break;
+		if (lock->max_priority < priority)
+			lock->max_priority = priority;
+		t = lock->holder;
 	}
 }
 
 void calculate_priority (struct thread *t) {
-	if(t == idle_thread)
+	if(t == t->cpu->idle_thread)
 		return;
 	t->priority = convert_xton(add_xandn(divide_xbyn(t->recent_cpu,-4),63-t->nice*2));
 }
 
 void calculate_recent_cpu (void) {
-	if (thread_current () != idle_thread) {
-		int recent_cpu = thread_current ()->recent_cpu;
-		recent_cpu = add_xandn (recent_cpu, 1);
-		thread_current()->recent_cpu = recent_cpu;
+	unsigned i;
+
+	/* Charge the thread running on each CPU. */
+	for (i = 0; i < cpu_cnt; i++) {
+		struct thread *t = cpus[i].running;
+		if (t != cpus[i].idle_thread)
+			t->recent_cpu = add_xandn (t->recent_cpu, 1);
 	}
 }
 
 void calculate_load_avg (void) {
 	int ready_threads = 0;
+	unsigned i;
 
-	if (thread_current () == idle_thread)
-		ready_threads = list_size (&ready_list);
-	else {
+	for (i = 0; i < cpu_cnt; i++) {
+		spinlock_acquire (&cpus[i].rq_lock);
+		ready_threads += list_size (&cpus[i].ready_list);
+		spinlock_release (&cpus[i].rq_lock);
 		// + 1 is count for the running thread
-		ready_threads = list_size (&ready_list) + 1;
+		if (cpus[i].running != cpus[i].idle_thread)
+			ready_threads++;
 	}
 
 	load_avg = mult_xbyy (load_fir_co, load_avg) + mult_xbyn (load_sec_co,  ready_threads);
@@ -862,6 +1246,7 @@ void recalculate_recent_cpu (void) {
 	struct list_elem* curr;
 	struct thread* t;
 
+	spinlock_acquire (&all_lock);
 	curr = list_begin(&all_list);
 	
 	while (curr != list_tail(&all_list)) {
@@ -869,6 +1254,7 @@ void recalculate_recent_cpu (void) {
 		t->recent_cpu = mult_xbyy (divide_xbyy (mult_xbyn (load_avg, 2), mult_xbyn (load_avg, 2) + convert_ntox(1)), t->recent_cpu) + convert_ntox(t->nice);
 		curr = list_next(curr);
 	}
+	spinlock_release (&all_lock);
 }
 void recalculate_priority (void) {
 	ASSERT (!list_empty (&all_list));
@@ -876,6 +1262,7 @@ void recalculate_priority (void) {
 	struct list_elem* curr;
 	struct thread* t;
 
+	spinlock_acquire (&all_lock);
 	curr = list_begin(&all_list);
 	
 	while (curr != list_tail(&all_list)) {
@@ -883,4 +1270,5 @@ void recalculate_priority (void) {
 		calculate_priority(t);
 		curr = list_next(curr);
 	}
+	spinlock_release (&all_lock);
 }
@@ -0,0 +1,102 @@
+#include "threads/trace.h"
+#include <debug.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/interrupt.h"
+#include "threads/thread.h"
+#include "intrinsic.h"
+
+/* Scheduler trace buffer.
+
+   A fixed-size ring of the most recent TRACE_SIZE scheduler
+   events: context switches, wakeups, priority donations and
+   blocking, each stamped with the TSC.  Recording takes no lock
+   and never blocks, so it can be done from the scheduler itself
+   and from interrupt handlers.  A writer claims a slot by
+   atomically incrementing trace_next, so concurrent writers
+   never share a slot; once the ring is full, the oldest events
+   are overwritten.
+
+   The buffer can be read by user programs through the
+   trace_read() system call, and is printed at shutdown if the
+   kernel was started with -trace.  Either way, utils/pintos-trace
+   turns it into something readable. */
+
+static struct trace_event trace_ring[TRACE_SIZE];
+
+/* Number of events ever recorded.  The next event goes in slot
+   trace_next % TRACE_SIZE. */
+static uint64_t trace_next;
+
+bool trace_dump_on_exit;
+
+/* Records an event of the given TYPE about thread T, caused by
+   OTHER, which may be null.  Interrupts must be off, so that the
+   events from one CPU land in the ring in TSC order. */
+void
+trace_record (enum trace_type type, const struct thread *t, int arg,
+		const struct thread *other) {
+	uint64_t seq;
+	struct trace_event *e;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	seq = __atomic_fetch_add (&trace_next, 1, __ATOMIC_RELAXED);
+	e = &trace_ring[seq % TRACE_SIZE];
+	e->tsc = rdtsc ();
+	e->tid = t->tid;
+	e->other = other != NULL ? other->tid : 0;
+	e->type = type;
+	e->arg = arg;
+	e->reserved = 0;
+}
+
+/* Returns the index of the oldest event still in the ring, and
+   stores the number of events in the ring in *CNT. */
+static uint64_t
+trace_oldest (size_t *cnt) {
+	uint64_t next = trace_next;
+	uint64_t first = next > TRACE_SIZE ? next - TRACE_SIZE : 0;
+
+	*cnt = next - first;
+	return first;
+}
+
+/* Copies as many of the buffered events as fit in SIZE bytes of
+   DST, oldest first, and returns the number of bytes copied. */
+size_t
+trace_copy (void *dst, size_t size) {
+	struct trace_event *out = dst;
+	size_t cnt, i;
+	uint64_t first = trace_oldest (&cnt);
+
+	if (cnt > size / sizeof *out)
+		cnt = size / sizeof *out;
+	for (i = 0; i < cnt; i++)
+		out[i] = trace_ring[(first + i) % TRACE_SIZE];
+	return cnt * sizeof *out;
+}
+
+/* Prints the trace buffer, one event per line as "TR" followed by
+   the event's bytes in hex, if the kernel was started with
+   -trace. */
+void
+trace_print_stats (void) {
+	size_t cnt, i;
+	uint64_t first;
+
+	if (!trace_dump_on_exit)
+		return;
+
+	first = trace_oldest (&cnt);
+	printf ("Trace: %llu events, last %zu follow\n", trace_next, cnt);
+	for (i = 0; i < cnt; i++) {
+		const uint8_t *p = (const uint8_t *) &trace_ring[(first + i) % TRACE_SIZE];
+		char line[2 * sizeof (struct trace_event) + 1];
+		size_t j;
+
+		for (j = 0; j < sizeof (struct trace_event); j++)
+			snprintf (line + 2 * j, 3, "%02x", p[j]);
+		printf ("TR %s\n", line);
+	}
+}
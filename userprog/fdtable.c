@@ -0,0 +1,172 @@
+#include "userprog/fdtable.h"
+#include <debug.h>
+#include <string.h>
+#include "filesys/file.h"
+#include "threads/malloc.h"
+
+/* File descriptor tables.
+
+   The table is an array of file pointers with a bitmap beside
+   it, one 64-bit word per 64 descriptors.  The lowest free
+   descriptor is the lowest clear bit, found a word at a time
+   starting from LO, the lowest word that may have one, so
+   opening a file does not scan the table.  The table starts
+   with 64 slots and doubles as needed, up to FD_MAX.
+
+   Entries hold a reference to their file (see file_dup()), so
+   several descriptors may share one file and its position.
+   Only the owning process touches its table and the files in
+   it, so no locking is needed. */
+
+#define WORD_BITS 64
+
+static bool grow (struct fd_table *);
+
+/* Puts FILE in the lowest free descriptor of FDT and returns it,
+   taking over the caller's reference to FILE.  Returns -1,
+   leaving FILE to the caller, if FDT is full or memory runs
+   out. */
+int
+fd_table_add (struct fd_table *fdt, struct file *file) {
+	int w, fd;
+
+	ASSERT (file != NULL);
+
+	for (w = fdt->lo; w < fdt->size / WORD_BITS; w++)
+		if (~fdt->used[w] != 0)
+			break;
+	if (w == fdt->size / WORD_BITS && !grow (fdt))
+		return -1;
+
+	fd = w * WORD_BITS + __builtin_ctzll (~fdt->used[w]);
+	fdt->used[w] |= 1ULL << (fd % WORD_BITS);
+	fdt->files[fd] = file;
+	fdt->lo = w;
+	return fd;
+}
+
+/* Returns the file open as FD in FDT, or a null pointer if FD
+   is not open or is the console. */
+struct file *
+fd_table_get (const struct fd_table *fdt, int fd) {
+	if (fd < 0 || fd >= fdt->size)
+		return NULL;
+	return fdt->files[fd];
+}
+
+/* Closes FD in FDT, dropping its reference to its file.
+   Returns false if FD is not open or is the console. */
+bool
+fd_table_close (struct fd_table *fdt, int fd) {
+	struct file *file = fd_table_get (fdt, fd);
+
+	if (file == NULL)
+		return false;
+	fdt->files[fd] = NULL;
+	fdt->used[fd / WORD_BITS] &= ~(1ULL << (fd % WORD_BITS));
+	if (fd / WORD_BITS < fdt->lo)
+		fdt->lo = fd / WORD_BITS;
+	file_close (file);
+	return true;
+}
+
+/* Makes DST, which must be empty, a copy of SRC for a forked
+   child.  Each file open in SRC is duplicated once, so the
+   child's position is its own; descriptors that share a file in
+   SRC share the duplicate in DST.  Only open descriptors are
+   visited.  Returns false if memory runs out, in which case DST
+   must still be destroyed. */
+bool
+fd_table_copy (struct fd_table *dst, const struct fd_table *src) {
+	int w;
+
+	ASSERT (dst->size == 0);
+
+	if (src->size == 0)
+		return true;
+	dst->files = calloc (src->size, sizeof *dst->files);
+	dst->used = malloc (src->size / WORD_BITS * sizeof *dst->used);
+	if (dst->files == NULL || dst->used == NULL)
+		return false;
+	dst->size = src->size;
+	dst->lo = src->lo;
+	memcpy (dst->used, src->used, src->size / WORD_BITS * sizeof *dst->used);
+
+	for (w = 0; w < src->size / WORD_BITS; w++) {
+		uint64_t bits = src->used[w];
+
+		while (bits != 0) {
+			int fd = w * WORD_BITS + __builtin_ctzll (bits);
+			struct file *file = src->files[fd];
+			struct file *copy = NULL;
+
+			bits &= bits - 1;
+			if (file == NULL)
+				continue;
+
+			/* A shared file was already copied for the first
+			   descriptor that refers to it. */
+			if (file_is_shared (file)) {
+				int i;
+
+				for (i = 0; i < fd; i++)
+					if (src->files[i] == file) {
+						copy = file_dup (dst->files[i]);
+						break;
+					}
+			}
+			if (copy == NULL)
+				copy = file_duplicate (file);
+			if (copy == NULL)
+				return false;
+			dst->files[fd] = copy;
+		}
+	}
+	return true;
+}
+
+/* Closes every descriptor in FDT and frees its memory, leaving
+   it empty. */
+void
+fd_table_destroy (struct fd_table *fdt) {
+	int fd;
+
+	for (fd = 0; fd < fdt->size; fd++)
+		if (fdt->files[fd] != NULL)
+			file_close (fdt->files[fd]);
+	free (fdt->files);
+	free (fdt->used);
+	memset (fdt, 0, sizeof *fdt);
+}
+
+/* Doubles the size of FDT, or gives it its first 64 slots, with
+   0 and 1 reserved for the console.  Returns false if FDT is
+   already FD_MAX slots or memory runs out. */
+static bool
+grow (struct fd_table *fdt) {
+	int size = fdt->size == 0 ? WORD_BITS : fdt->size * 2;
+	struct file **files;
+	uint64_t *used;
+
+	if (size > FD_MAX)
+		size = FD_MAX;
+	if (size <= fdt->size)
+		return false;
+
+	files = realloc (fdt->files, size * sizeof *files);
+	if (files == NULL)
+		return false;
+	fdt->files = files;
+	used = realloc (fdt->used, size / WORD_BITS * sizeof *used);
+	if (used == NULL)
+		return false;
+	fdt->used = used;
+
+	memset (files + fdt->size, 0, (size - fdt->size) * sizeof *files);
+	memset (used + fdt->size / WORD_BITS, 0,
+			(size - fdt->size) / WORD_BITS * sizeof *used);
+	if (fdt->size == 0)
+		used[0] = 0x3;
+	fdt->size = size;
+	return true;
+}
@@ -1,6 +1,8 @@
 #include "userprog/gdt.h"
 #include <debug.h>
+#include <string.h>
 #include "userprog/tss.h"
+#include "threads/cpu.h"
 #include "threads/mmu.h"
 #include "threads/palloc.h"
 #include "threads/vaddr.h"
@@ -72,19 +74,43 @@ static struct segment_desc gdt[SEL_CNT] = {
 	[7] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 },
 };
 
-struct desc_ptr gdt_ds = {
-	.size = sizeof(gdt) - 1,
-	.address = (uint64_t) gdt
-};
+/* Copies of GDT for the application processors, indexed by CPU. */
+static struct segment_desc ap_gdt[CPU_MAX][SEL_CNT];
+
+static void gdt_load (struct segment_desc *);
 
 /* Sets up a proper GDT.  The bootstrap loader's GDT didn't
    include user-mode selectors or a TSS, but we need both now. */
 void
 gdt_init (void) {
-	/* Initialize GDT. */
+	gdt_load (gdt);
+}
+
+/* Gives an application processor a GDT of its own.  The TSS
+   descriptor is the only one that differs between CPUs, but the
+   CPU marks it busy when it loads the task register, and a busy
+   descriptor cannot be loaded again, so every CPU needs a copy
+   of the whole table. */
+void
+gdt_init_ap (void) {
+	struct segment_desc *table = ap_gdt[cpu_current ()->id];
+
+	memcpy (table, gdt, sizeof gdt);
+	gdt_load (table);
+	ltr (SEL_TSS);
+}
+
+/* Points TABLE's TSS descriptor at the running CPU's TSS, loads
+   TABLE into the GDTR and reloads the segment registers. */
+static void
+gdt_load (struct segment_desc *table) {
 	struct segment_descriptor64 *tss_desc =
-		(struct segment_descriptor64 *) &gdt[SEL_TSS >> 3];
+		(struct segment_descriptor64 *) &table[SEL_TSS >> 3];
 	struct task_state *tss = tss_get ();
+	struct desc_ptr ds = {
+		.size = sizeof(gdt) - 1,
+		.address = (uint64_t) table
+	};
 
 	*tss_desc = (struct segment_descriptor64) {
 		.lim_15_0 = (uint64_t) (sizeof (struct task_state)) & 0xffff,
@@ -105,7 +131,7 @@ gdt_init (void) {
 		.res2 = 0
 	};
 
-	lgdt (&gdt_ds);
+	lgdt (&ds);
 	/* reload segment registers */
 	asm volatile("movw %%ax, %%gs" :: "a" (SEL_UDSEG));
 	asm volatile("movw %%ax, %%fs" :: "a" (0));
@@ -0,0 +1,111 @@
+#include <ioring.h>
+#include <debug.h>
+#include "userprog/syscall.h"
+#include "threads/mmu.h"
+#include "threads/palloc.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+
+/* Batched system calls through a ring shared with the process;
+   see lib/ioring.h for the protocol.
+
+   The ring is an ordinary user page, mapped into the process's
+   page table like a loaded segment, so pml4_destroy() frees it
+   along with the rest of the process's memory.  The kernel keeps
+   its own address for the page in the thread and reads and
+   writes the ring through that, so no access to it can fault.
+   Only the process's own thread runs ioring_enter(), while the
+   process is in the kernel, so the two sides never touch the
+   ring at the same time. */
+
+static int64_t do_sqe (const struct io_sqe *);
+
+/* Maps a new, empty ring at ADDR, which must be page-aligned and
+   unmapped, and returns ADDR, or a null pointer if ADDR is bad,
+   the process already has a ring, or memory runs out.  A forked
+   child gets a copy of the page but no ring; exec() drops the
+   ring. */
+void *
+ioring_setup (void *addr) {
+	struct thread *t = thread_current ();
+	void *kpage;
+
+	ASSERT (sizeof (struct io_ring) <= PGSIZE);
+
+	if (t->ioring != NULL || addr == NULL || pg_ofs (addr) != 0
+			|| !is_user_vaddr (addr) || pml4_get_page (t->pml4, addr) != NULL)
+		return NULL;
+#ifdef VM
+	if (spt_find_page (&t->spt, addr) != NULL)
+		return NULL;
+#endif
+
+	kpage = palloc_get_page (PAL_USER | PAL_ZERO);
+	if (kpage == NULL)
+		return NULL;
+	if (!pml4_set_page (t->pml4, addr, kpage, true)) {
+		palloc_free_page (kpage);
+		return NULL;
+	}
+	t->ioring = kpage;
+	return addr;
+}
+
+/* Performs up to TO_SUBMIT queued operations, in order, and
+   returns the number performed, or -1 if the process has no
+   ring.  Stops early when the submission queue is empty or the
+   completion queue is full. */
+int
+ioring_enter (unsigned to_submit) {
+	struct io_ring *ring = thread_current ()->ioring;
+	unsigned done = 0;
+
+	if (ring == NULL)
+		return -1;
+
+	while (done < to_submit && ring->sq_head != ring->sq_tail
+			&& ring->cq_tail - ring->cq_head < IORING_ENTRIES) {
+		/* Copy the entry, so the process cannot change it while
+		   it is in use. */
+		struct io_sqe sqe = ring->sqes[ring->sq_head % IORING_ENTRIES];
+		struct io_cqe *cqe;
+		int64_t res;
+
+		ring->sq_head++;
+		res = do_sqe (&sqe);
+
+		cqe = &ring->cqes[ring->cq_tail % IORING_ENTRIES];
+		cqe->user_data = sqe.user_data;
+		cqe->res = res;
+		ring->cq_tail++;
+		done++;
+	}
+	return done;
+}
+
+/* Performs SQE and returns its result. */
+static int64_t
+do_sqe (const struct io_sqe *sqe) {
+	switch (sqe->op) {
+		case IORING_OP_NOP:
+			return 0;
+		case IORING_OP_OPEN:
+			return open ((const char *) sqe->addr);
+		case IORING_OP_CLOSE:
+			close (sqe->fd);
+			return 0;
+		case IORING_OP_READ:
+			return read (sqe->fd, (void *) sqe->addr, sqe->len);
+		case IORING_OP_WRITE:
+			return write (sqe->fd, (const void *) sqe->addr, sqe->len);
+		case IORING_OP_PREAD:
+			return pread (sqe->fd, (void *) sqe->addr, sqe->len, sqe->off);
+		case IORING_OP_PWRITE:
+			return pwrite (sqe->fd, (const void *) sqe->addr, sqe->len, sqe->off);
+		case IORING_OP_SEEK:
+			seek (sqe->fd, sqe->off);
+			return 0;
+		default:
+			return -1;
+	}
+}
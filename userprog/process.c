@@ -10,9 +10,12 @@
 #include "filesys/directory.h"
 #include "filesys/file.h"
 #include "filesys/filesys.h"
+#include "filesys/inode.h"
 #include "threads/flags.h"
+#include "threads/fpu.h"
 #include "threads/init.h"
 #include "threads/interrupt.h"
+#include "threads/malloc.h"
 #include "threads/palloc.h"
 #include "threads/thread.h"
 #include "threads/mmu.h"
@@ -24,7 +27,8 @@
 
 static void process_cleanup (void);
 static bool load (const char *file_name, struct intr_frame *if_);
-static void initd (void *f_name);
+static bool push_args (const struct exec_args *, struct intr_frame *if_);
+static void initd (void *args);
 static void __do_fork (void *);
 
 /* General process initializer for initd and other process. */
@@ -33,6 +37,129 @@ process_init (void) {
 	struct thread *current = thread_current ();
 }
 
+/* An executable that running processes were loaded from.  Loading
+ * a program that is already running shares its image: there is no
+ * directory lookup and no inode to read, and the one struct file
+ * keeps writes denied until the last process running it exits. */
+struct exec_image {
+	struct list_elem elem;      /* Element in exec_images. */
+	char name[NAME_MAX + 1];    /* File name. */
+	struct file *file;          /* The executable, writes denied. */
+	int ref_cnt;                /* Processes running it. */
+};
+
+/* Images of running programs, protected by exec_images_lock. */
+static struct list exec_images;
+static struct lock exec_images_lock;
+
+/* Returns the image of the program named NAME, opening the file
+ * only if no running process has it open already.  Returns a null
+ * pointer if it cannot be opened. */
+static struct exec_image *
+exec_image_get (const char *name) {
+	struct exec_image *image;
+	struct list_elem *e;
+	struct file *file;
+
+	lock_acquire (&exec_images_lock);
+	for (e = list_begin (&exec_images); e != list_end (&exec_images);
+			e = list_next (e)) {
+		image = list_entry (e, struct exec_image, elem);
+		/* A removed file's name may now belong to a new one. */
+		if (!strcmp (image->name, name)
+				&& !inode_is_removed (file_get_inode (image->file))) {
+			image->ref_cnt++;
+			lock_release (&exec_images_lock);
+			return image;
+		}
+	}
+
+	file = filesys_open (name);
+	image = file != NULL ? malloc (sizeof *image) : NULL;
+	if (image != NULL) {
+		strlcpy (image->name, name, sizeof image->name);
+		image->file = file;
+		image->ref_cnt = 1;
+		file_deny_write (file);
+		list_push_front (&exec_images, &image->elem);
+	} else
+		file_close (file);
+	lock_release (&exec_images_lock);
+	return image;
+}
+
+/* Adds a reference to IMAGE, which may be null, and returns it. */
+static struct exec_image *
+exec_image_dup (struct exec_image *image) {
+	if (image != NULL) {
+		lock_acquire (&exec_images_lock);
+		image->ref_cnt++;
+		lock_release (&exec_images_lock);
+	}
+	return image;
+}
+
+/* Drops a reference to IMAGE, which may be null, closing its file
+ * when the last process running it lets go. */
+static void
+exec_image_put (struct exec_image *image) {
+	if (image == NULL)
+		return;
+
+	lock_acquire (&exec_images_lock);
+	if (--image->ref_cnt == 0) {
+		list_remove (&image->elem);
+		lock_release (&exec_images_lock);
+		file_close (image->file);
+		free (image);
+	} else
+		lock_release (&exec_images_lock);
+}
+
+/* Returns a new set of arguments with room for SIZE bytes of
+ * strings, or a null pointer if memory is short.  The caller
+ * fills in STRS and ARGC, or writes a command line into STRS and
+ * calls exec_args_split(), and eventually frees it with free(). */
+struct exec_args *
+exec_args_create (size_t size) {
+	struct exec_args *args = malloc (sizeof *args + size);
+
+	if (args != NULL) {
+		args->argc = 0;
+		args->size = size;
+	}
+	return args;
+}
+
+/* Splits the null-terminated command line in ARGS's STRS into
+ * arguments separated by spaces, packing them back to back in
+ * place, and sets ARGC and SIZE to match. */
+void
+exec_args_split (struct exec_args *args) {
+	char *src = args->strs;
+	char *dst = args->strs;
+
+	args->argc = 0;
+	for (;;) {
+		while (*src == ' ')
+			src++;
+		if (*src == '\0')
+			break;
+
+		args->argc++;
+		while (*src != ' ' && *src != '\0')
+			*dst++ = *src++;
+		if (*src == ' ')
+			src++;
+		*dst++ = '\0';
+	}
+	args->size = dst - args->strs;
+
+	/* With no arguments, leave an empty program name to fail on. */
+	if (args->argc == 0)
+		args->strs[0] = '\0';
+}
+
 /* Starts the first userland program, called "initd", loaded from FILE_NAME.
  * The new thread may be scheduled (and may even exit)
  * before process_create_initd() returns. Returns the initd's
@@ -40,24 +167,25 @@ process_init (void) {
  * Notice that THIS SHOULD BE CALLED ONCE. */
 tid_t
 process_create_initd (const char *file_name) {
-	char *fn_copy;
+	struct exec_args *args;
 	tid_t tid;
-	char *save_ptr;
-	// printf("기존의 filename => %s",file_name);
+
+	/* No program has been loaded yet. */
+	list_init (&exec_images);
+	lock_init (&exec_images_lock);
+
 	/* Make a copy of FILE_NAME.
 	 * Otherwise there's a race between the caller and load(). */
-	fn_copy = palloc_get_page (0);
-	if (fn_copy == NULL)
+	args = exec_args_create (strlen (file_name) + 1);
+	if (args == NULL)
 		return TID_ERROR;
-	strlcpy (fn_copy, file_name, PGSIZE);
-	strtok_r(file_name," ",&save_ptr);
-	// printf("이거 filname => %s",file_name);
-	// printf("이거 fn_copy => %s",fn_copy);
+	strlcpy (args->strs, file_name, args->size);
+	exec_args_split (args);
 
 	/* Create a new thread to execute FILE_NAME. */
-	tid = thread_create (file_name, PRI_DEFAULT, initd, fn_copy);
+	tid = thread_create (args->strs, PRI_DEFAULT, initd, args);
 	if (tid == TID_ERROR)
-		palloc_free_page (fn_copy);
+		free (args);
 	return tid;
 }
 
@@ -65,14 +193,14 @@ process_create_initd (const char *file_name) {
    처음 사용자 프로세스를 시작하는 스레드 함수?
 */
 static void
-initd (void *f_name) {
+initd (void *args) {
 #ifdef VM
 	supplemental_page_table_init (&thread_current ()->spt);
 #endif
 
 	process_init ();
 
-	if (process_exec (f_name) < 0)
+	if (process_exec (args) < 0)
 		PANIC("Fail to launch initd\n");
 	NOT_REACHED ();
 }
@@ -84,6 +212,7 @@ process_fork (const char *name, struct intr_frame *if_ UNUSED) {
 	/* Clone current thread to new thread.*/
 	struct thread *curr = thread_current();
 	memcpy(&curr->parent_if,if_,sizeof(struct intr_frame));
+	fpu_flush ();
 
 	tid_t tid = thread_create (name,PRI_DEFAULT, __do_fork, curr);
 	if(tid == TID_ERROR)
@@ -97,11 +226,10 @@ process_fork (const char *name, struct intr_frame *if_ UNUSED) {
 
 #ifndef VM
 /* Duplicate the parent's address space by passing this function to the
- * pml4_for_each. This is only for the project 2. */
+ * pml4_for_each_range. This is only for the project 2. */
 static bool
-duplicate_pte (uint64_t *pte, void *va, void *aux) {
+duplicate_pte (uint64_t *pte, void *va, void *aux UNUSED) {
 	struct thread *current = thread_current ();
-	struct thread *parent = (struct thread *) aux;
 	void *parent_page;
 	void *newpage;
 	bool writable;
@@ -110,10 +238,11 @@ duplicate_pte (uint64_t *pte, void *va, void *aux) {
 	if (is_kernel_vaddr(va)){
 		return true;
 	}
-	/* 2. Resolve VA from the parent's page map level 4. */
-	parent_page = pml4_get_page (parent->pml4, va);
-	if(parent_page == NULL)
-		return false;
+	/* 2. Resolve VA from the parent's page map level 4.  PTE is
+	 *    already the parent's entry; walking the parent's tables again
+	 *    would also evict the child's from the pde_cache that
+	 *    pml4_set_page() below relies on. */
+	parent_page = ptov (PTE_ADDR (*pte));
 
 	/* 3. TODO: Allocate new PAL_USER page for the child and set result to
 	 *    TODO: NEWPAGE. */
@@ -165,7 +294,8 @@ __do_fork (void *aux) {
 	if (!supplemental_page_table_copy (&current->spt, &parent->spt))
 		goto error;
 #else
-	if (!pml4_for_each (parent->pml4, duplicate_pte, parent))
+	if (!pml4_for_each_range (parent->pml4, NULL, (void *) KERN_BASE,
+				duplicate_pte, parent))
 		goto error;
 #endif
 
@@ -174,16 +304,11 @@ __do_fork (void *aux) {
 	 * TODO:       in include/filesys/file.h. Note that parent should not return
 	 * TODO:       from the fork() until this function successfully duplicates
 	 * TODO:       the resources of parent.*/
-	  for (int i = 0; i < FDCOUNT_LIMIT; i++)
-    {
-        struct file *file = parent->fdt[i];
-        if (file == NULL)
-            continue;
-        if (file > 2)
-            file = file_duplicate(file);
-        current->fdt[i] = file;
-    }
-	current->fd_index = parent->fd_index;
+	if (!fd_table_copy (&current->fdt, &parent->fdt))
+		goto error;
+	if (!fpu_fork (parent))
+		goto error;
+	current->exec_image = exec_image_dup (parent->exec_image);
 	sema_up(&current->load_sema);
 	process_init ();
 	
@@ -195,11 +320,13 @@ error:
 	exit(TID_ERROR);
 }
 
-/* Switch the current execution context to the f_name.
+/* Switch the current execution context to the program named by
+ * the first of ARGS, passing it ARGS, which this function frees.
  * Returns -1 on fail. */
 int
-process_exec (void *f_name) {
-	char *file_name = f_name;
+process_exec (struct exec_args *args) {
+	struct thread *curr = thread_current ();
+	struct exec_image *old_image = curr->exec_image;
 	bool success;
 
 	/* We cannot use the intr_frame in the thread structure.
@@ -212,66 +339,139 @@ process_exec (void *f_name) {
 
 	/* We first kill the current context */
 	process_cleanup ();
+	fpu_reset ();
 
-	char *parse[64];
-   	char *token, *save_ptr;
-	int count = 0;
-   	for (token = strtok_r (file_name, " ", &save_ptr); token != NULL;
-   	token = strtok_r (NULL, " ", &save_ptr)){
-		parse[count++] = token;
-	}
-
-	/* And then load the binary : 메모리로 */
-	success = load (file_name, &_if);
-	if (!success){
-		//printf("succ확인용");
-		return -1;
-	}
-
-	argument_stack(parse,count,&_if.rsp);
-	palloc_free_page (file_name);
-
-	// hex_dump(_if.rsp, _if.rsp, USER_STACK - (uint64_t)_if.rsp, true); 
+	/* And then load the binary.  The old image is released only
+	 * afterward, so a process exec()ing the program it is running
+	 * shares the open file instead of opening it again. */
+	curr->exec_image = NULL;
+	success = load (args->strs, &_if) && push_args (args, &_if);
+	exec_image_put (old_image);
+	free (args);
 
 	/* If load failed, quit. */
-		
-	_if.R.rdi = count;
-	_if.R.rsi = (char*)_if.rsp + 8;
+	if (!success)
+		return -1;
 
 	/* Start switched process. */
 	do_iret (&_if);
 	NOT_REACHED ();
 }
-void argument_stack(char **parse, int count, void**rsp){
-	//argument 
-	for(int i = count-1; i > -1; i--){
-		//printf(" 테스트용 : %s\n",parse[i]);
-		for(int j = strlen(parse[i]); j > -1; j--){
-			(*rsp)--;
-			**(char**)rsp = parse[i][j];
-			//printf(" 테스트용22 : %c\n",parse[i][j]);
-		}
-		parse[i] = *(char**)rsp;
+
+/* Copies ARGS onto the user stack that IF_'s RSP points to and
+ * sets up IF_ to pass them to main().  The layout is computed up
+ * front, so the strings go in with one copy and each argv[]
+ * pointer is written once:
+ *
+ *	strings         ARGS's STRS, unchanged
+ *	padding         to a 16-byte boundary
+ *	argv[]          ARGC pointers into the strings, then null
+ *	return address  a fake, null one
+ *
+ * which leaves RSP aligned as main() expects after a call.
+ * Returns false if the arguments do not fit in the stack page. */
+static bool
+push_args (const struct exec_args *args, struct intr_frame *if_) {
+	uintptr_t strs = if_->rsp - args->size;
+	uintptr_t argv = ROUND_DOWN (strs - (args->argc + 1) * sizeof (char *),
+			16);
+	uintptr_t rsp = argv - sizeof (void *);
+	char **uargv = (char **) argv;
+	const char *s = args->strs;
+	int i;
+
+	if (if_->rsp - rsp > PGSIZE)
+		return false;
+
+	memcpy ((void *) strs, args->strs, args->size);
+	for (i = 0; i < args->argc; i++) {
+		uargv[i] = (char *) strs + (s - args->strs);
+		s += strlen (s) + 1;
 	}
-	//padding
-	int padding = (int)*rsp % 8;
-	for(int i = 0; i <padding; i++){
-		(*rsp)--;
-		**(uint8_t**)rsp = 0;
+	uargv[args->argc] = NULL;
+	*(void **) rsp = NULL;
+
+	if_->rsp = rsp;
+	if_->R.rdi = args->argc;
+	if_->R.rsi = argv;
+	return true;
+}
+
+/* What process_spawn() hands to the child it creates. */
+struct spawn_aux {
+	struct thread *parent;      /* Process calling spawn(). */
+	const char *file;           /* Program to load. */
+	const struct exec_args *args; /* Arguments to pass it. */
+	bool success;               /* Set by the child: loaded? */
+};
+
+static void spawn_start (void *);
+
+/* Starts a new process running FILE, passing it ARGS, which the
+ * caller still owns and frees.  The child inherits the
+ * current process's open files but none of its memory, so unlike
+ * process_fork() followed by process_exec() no page of the parent
+ * is ever copied.  Returns the new process's thread id once the
+ * child has loaded FILE, or TID_ERROR if it could not. */
+tid_t
+process_spawn (const char *file, struct exec_args *args) {
+	struct spawn_aux aux;
+	struct thread *child;
+	tid_t tid;
+
+	aux.parent = thread_current ();
+	aux.file = file;
+	aux.args = args;
+	aux.success = false;
+
+	tid = thread_create (file, PRI_DEFAULT, spawn_start, &aux);
+	if (tid == TID_ERROR)
+		return TID_ERROR;
+
+	child = get_child_process (tid);
+	sema_down (&child->load_sema);
+	if (!aux.success) {
+		/* Reap the child, which exits without printing. */
+		process_wait (tid);
+		return TID_ERROR;
 	}
+	return tid;
+}
+
+/* A thread function that builds a new process from scratch for
+ * process_spawn().  The parent waits on our load_sema, so AUX
+ * (on its stack) stays valid until we sema_up() it. */
+static void
+spawn_start (void *aux_) {
+	struct spawn_aux *aux = aux_;
+	struct thread *current = thread_current ();
+	struct intr_frame if_;
+	bool success;
 
-	// 0
-	(*rsp) -= 8;
-	**(char ***)rsp = 0;
+	memset (&if_, 0, sizeof if_);
+	if_.ds = if_.es = if_.ss = SEL_UDSEG;
+	if_.cs = SEL_UCSEG;
+	if_.eflags = FLAG_IF | FLAG_MBS;
 
-	//argument address
-	for(int i = count-1 ; i>-1 ; i--){
-		(*rsp) -= 8;
-		**(char ***)rsp = parse[i];
+#ifdef VM
+	supplemental_page_table_init (&current->spt);
+#endif
+	process_init ();
+
+	success = fd_table_copy (&current->fdt, &aux->parent->fdt)
+		&& load (aux->file, &if_)
+		&& push_args (aux->args, &if_);
+
+	/* AUX is gone once the parent wakes up. */
+	aux->success = success;
+	sema_up (&current->load_sema);
+
+	if (!success) {
+		current->exit_status = -1;
+		thread_exit ();
 	}
-	//return address
-	(*rsp) -= 8;
-	**(void***)rsp = 0;
+	do_iret (&if_);
+	NOT_REACHED ();
 }
 
 
@@ -316,11 +516,9 @@ process_exit (void) {
 	 * TODO: We recommend you to implement process resource cleanup here. */
 
 	// 여기가 있으면 왜 모두 fail?
-	for(int i = 0; i<FDCOUNT_LIMIT;i++){
-		close(i);
-	}
-	palloc_free_multiple(curr->fdt,FDT_PAGES);
-	file_close(curr->runn_file);
+	fd_table_destroy (&curr->fdt);
+	exec_image_put (curr->exec_image);
+	curr->exec_image = NULL;
 
 	sema_up(&curr -> wait_sema);
 	sema_down(&curr -> free_sema);
@@ -338,6 +536,9 @@ process_cleanup (void) {
 	supplemental_page_table_kill (&curr->spt);
 #endif
 
+	/* The ring's page goes with the page table. */
+	curr->ioring = NULL;
+
 	uint64_t *pml4;
 	/* Destroy the current process's page directory and switch back
 	 * to the kernel-only page directory. */
@@ -352,7 +553,7 @@ process_cleanup (void) {
 		 * that's been freed (and cleared). */
 		curr->pml4 = NULL;
 		pml4_activate (NULL);
-		pml4_destroy (pml4);
+		pml4_destroy_deferred (pml4);
 	}
 }
 
@@ -445,18 +646,18 @@ load (const char *file_name, struct intr_frame *if_) {
 		goto done;
 	process_activate (thread_current ());
 
-	/* Open executable file. */
-	file = filesys_open (file_name);
-	if (file == NULL) {
+	/* Open executable file, or share it with the processes already
+	 * running it.  Reads go through file_read_at() so that those
+	 * processes can load from the same file at once. */
+	t->exec_image = exec_image_get (file_name);
+	if (t->exec_image == NULL) {
 		printf ("load: %s: open failed\n", file_name);
-		//printf ("load: %d: 처음 석세스\n", success);
 		goto done;
 	}
-	t-> runn_file = file;
-	file_deny_write(file);
+	file = t->exec_image->file;
 
 	/* Read and verify executable header. */
-	if (file_read (file, &ehdr, sizeof ehdr) != sizeof ehdr
+	if (file_read_at (file, &ehdr, sizeof ehdr, 0) != sizeof ehdr
 			|| memcmp (ehdr.e_ident, "\177ELF\2\1\1", 7)
 			|| ehdr.e_type != 2
 			|| ehdr.e_machine != 0x3E // amd64
@@ -474,9 +675,7 @@ load (const char *file_name, struct intr_frame *if_) {
 
 		if (file_ofs < 0 || file_ofs > file_length (file))
 			goto done;
-		file_seek (file, file_ofs);
-
-		if (file_read (file, &phdr, sizeof phdr) != sizeof phdr)
+		if (file_read_at (file, &phdr, sizeof phdr, file_ofs) != sizeof phdr)
 			goto done;
 		file_ofs += sizeof phdr;
 		switch (phdr.p_type) {
@@ -615,7 +814,6 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
 	ASSERT (pg_ofs (upage) == 0);
 	ASSERT (ofs % PGSIZE == 0);
 
-	file_seek (file, ofs);
 	while (read_bytes > 0 || zero_bytes > 0) {
 		/* Do calculate how to fill this page.
 		 * We will read PAGE_READ_BYTES bytes from FILE
@@ -629,7 +827,8 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
 			return false;
 
 		/* Load this page. */
-		if (file_read (file, kpage, page_read_bytes) != (int) page_read_bytes) {
+		if (file_read_at (file, kpage, page_read_bytes, ofs)
+				!= (int) page_read_bytes) {
 			palloc_free_page (kpage);
 			return false;
 		}
@@ -645,6 +844,7 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
 		/* Advance. */
 		read_bytes -= page_read_bytes;
 		zero_bytes -= page_zero_bytes;
+		ofs += page_read_bytes;
 		upage += PGSIZE;
 	}
 	return true;
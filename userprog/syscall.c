@@ -1,6 +1,10 @@
 #include "userprog/syscall.h"
 #include <stdio.h>
+#include <limits.h>
+#include <string.h>
+#include <histogram.h>
 #include <syscall-nr.h>
+#include "threads/cpu.h"
 #include "threads/interrupt.h"
 #include "threads/thread.h"
 #include "threads/loader.h"
@@ -9,17 +13,112 @@
 #include "intrinsic.h"
 #include "filesys/filesys.h"
 #include "filesys/file.h"
+#include "devices/disk.h"
 #include "threads/palloc.h"
+#include "threads/malloc.h"
+#include "threads/trace.h"
+#include "userprog/uaccess.h"
+#include "userprog/process.h"
 
 
 void syscall_entry (void);
 void syscall_handler (struct intr_frame *);
 pid_t fork(const char *thread_name, struct intr_frame *f);
 
-// File Descriptor
 static struct file *find_file_by_fd(int fd);
-int add_file_to_fdt(struct file *file);
-void remove_file_from_fdt(int fd);
+
+static bool get_user_string (char *dst, const char *ustr, size_t size);
+static struct iovec *get_user_iovec (const struct iovec *iov, int iovcnt);
+static int do_read (int fd, const struct iovec *iov, int iovcnt, off_t ofs);
+static int do_write (int fd, const struct iovec *iov, int iovcnt, off_t ofs);
+
+/* Longest file name, including the null terminator, that the
+   file system calls accept. */
+#define NAME_BUF_SIZE 256
+
+/* Size of the kernel buffer that data moving between user memory
+   and a file or the console goes through.  It lives on the kernel
+   stack, so read() and write() need no memory of their own, and
+   matches the file system's unit of transfer. */
+#define BOUNCE_SIZE DISK_SECTOR_SIZE
+
+/* A system call handler.  ARG holds the call's arguments, in
+   order, and F the caller's registers.  The return value goes
+   back to the caller in %rax. */
+typedef uint64_t syscall_func (const uint64_t arg[], struct intr_frame *f);
+
+static syscall_func sys_halt, sys_exit, sys_fork, sys_exec, sys_wait;
+static syscall_func sys_create, sys_remove, sys_open, sys_filesize;
+static syscall_func sys_read, sys_write, sys_seek, sys_tell, sys_close;
+static syscall_func sys_trace_read, sys_readv, sys_writev, sys_pread;
+static syscall_func sys_pwrite, sys_copy_file_range, sys_syscall_stats;
+static syscall_func sys_ioring_setup, sys_ioring_enter, sys_getpid;
+static syscall_func sys_spawn, sys_yield;
+
+/* One entry of the dispatch table. */
+struct syscall {
+	const char *name;           /* Name, for syscall_print_stats(). */
+	int argc;                   /* Number of arguments, 0 to 6. */
+	syscall_func *func;         /* Handler. */
+	bool fast;                  /* Take the fast entry path?  Only for
+	                               calls with at most 4 arguments that
+	                               never block and do not need F. */
+};
+
+/* Dispatch table, indexed by system call number.  Numbers with
+   a null FUNC are not implemented, and kill the caller. */
+static const struct syscall syscall_table[] = {
+	[SYS_HALT] = {"halt", 0, sys_halt},
+	[SYS_EXIT] = {"exit", 1, sys_exit},
+	[SYS_FORK] = {"fork", 1, sys_fork},
+	[SYS_EXEC] = {"exec", 1, sys_exec},
+	[SYS_WAIT] = {"wait", 1, sys_wait},
+	[SYS_CREATE] = {"create", 2, sys_create},
+	[SYS_REMOVE] = {"remove", 1, sys_remove},
+	[SYS_OPEN] = {"open", 1, sys_open},
+	[SYS_FILESIZE] = {"filesize", 1, sys_filesize, true},
+	[SYS_READ] = {"read", 3, sys_read},
+	[SYS_WRITE] = {"write", 3, sys_write},
+	[SYS_SEEK] = {"seek", 2, sys_seek, true},
+	[SYS_TELL] = {"tell", 1, sys_tell, true},
+	[SYS_CLOSE] = {"close", 1, sys_close},
+	[SYS_TRACE_READ] = {"trace_read", 2, sys_trace_read},
+	[SYS_READV] = {"readv", 3, sys_readv},
+	[SYS_WRITEV] = {"writev", 3, sys_writev},
+	[SYS_PREAD] = {"pread", 4, sys_pread},
+	[SYS_PWRITE] = {"pwrite", 4, sys_pwrite},
+	[SYS_COPY_FILE_RANGE] = {"copy_file_range", 3, sys_copy_file_range},
+	[SYS_SYSCALL_STATS] = {"syscall_stats", 2, sys_syscall_stats},
+	[SYS_IORING_SETUP] = {"ioring_setup", 1, sys_ioring_setup},
+	[SYS_IORING_ENTER] = {"ioring_enter", 1, sys_ioring_enter},
+	[SYS_GETPID] = {"getpid", 0, sys_getpid, true},
+	[SYS_SPAWN] = {"spawn", 2, sys_spawn},
+	[SYS_YIELD] = {"yield", 0, sys_yield},
+};
+#define SYSCALL_CNT (sizeof syscall_table / sizeof *syscall_table)
+
+/* Per-syscall statistics, indexed like syscall_table[].  CNT
+   counts calls on entry, LATENCY records each call that returns.
+   Any number of processes may be in the same call at once, so
+   both are updated with atomic operations, which stay correct
+   with more than one CPU and cost less than turning interrupts
+   off and on around each update. */
+static struct {
+	uint64_t cnt;
+	struct histogram latency;
+} syscall_stat[SYSCALL_CNT];
+
+/* Bit N is set if system call N takes the fast entry path in
+   syscall-entry.S.  Set up by syscall_init() from the FAST
+   members of syscall_table[]. */
+uint64_t syscall_fast_mask;
+
+/* -no-fast-syscall: Send every system call through the full
+   intr_frame path, to measure what the fast path saves? */
+bool syscall_no_fast;
+
+uint64_t syscall_fast_handler (uint64_t, uint64_t, uint64_t, uint64_t,
+		uint64_t);
 
 /* System call.
  *
@@ -33,9 +132,11 @@ void remove_file_from_fdt(int fd);
 #define MSR_STAR 0xc0000081         /* Segment selector msr */
 #define MSR_LSTAR 0xc0000082        /* Long mode SYSCALL target */
 #define MSR_SYSCALL_MASK 0xc0000084 /* Mask for the eflags */
+#define MSR_KERNEL_GS_BASE 0xc0000102 /* %gs base after swapgs */
 
-void
-syscall_init (void) {
+/* Points the running CPU's MSRs at syscall_entry. */
+static void
+syscall_init_msrs (void) {
 	write_msr(MSR_STAR, ((uint64_t)SEL_UCSEG - 0x10) << 48  |
 			((uint64_t)SEL_KCSEG) << 32);
 	write_msr(MSR_LSTAR, (uint64_t) syscall_entry);
@@ -45,72 +146,429 @@ syscall_init (void) {
 	 * mode stack. Therefore, we masked the FLAG_FL. */
 	write_msr(MSR_SYSCALL_MASK,
 			FLAG_IF | FLAG_TF | FLAG_DF | FLAG_IOPL | FLAG_AC | FLAG_NT);
-	lock_init(&file_lock);
+
+	/* syscall_entry finds this CPU's TSS and scratch space through
+	 * %gs, after a swapgs. */
+	write_msr(MSR_KERNEL_GS_BASE, (uint64_t) cpu_current ());
+}
+
+void
+syscall_init (void) {
+	syscall_init_msrs ();
+
+	for (size_t i = 0; i < SYSCALL_CNT; i++) {
+		histogram_init (&syscall_stat[i].latency);
+		if (syscall_table[i].fast && !syscall_no_fast) {
+			ASSERT (i < 64 && syscall_table[i].argc <= 4);
+			syscall_fast_mask |= 1ULL << i;
+		}
+	}
+}
+
+/* Sets up system calls on an application processor. */
+void
+syscall_init_ap (void) {
+	syscall_init_msrs ();
+}
+
+/* Calls SC's handler with arguments ARG and registers F, which
+   is null on the fast path, and keeps SC's statistics.  Returns
+   the handler's return value. */
+static uint64_t
+dispatch (const struct syscall *sc, const uint64_t arg[],
+		struct intr_frame *f) {
+	uint64_t start, ret;
+
+	__atomic_fetch_add (&syscall_stat[sc - syscall_table].cnt, 1,
+			__ATOMIC_RELAXED);
+
+	start = rdtsc ();
+	ret = sc->func (arg, f);
+
+	histogram_add_atomic (&syscall_stat[sc - syscall_table].latency,
+			rdtsc () - start);
+	return ret;
 }
 
 /* The main system call interface */
 void
-syscall_handler (struct intr_frame *f UNUSED) {
-	// printf ("system call!\n");
-	// thread_exit ();
-	switch (f->R.rax){
-	case SYS_HALT:
-		halt();
-		break;
-	case SYS_EXIT:
-		exit(f->R.rdi);
-		break;
-	case SYS_EXEC:
-		f->R.rax = exec(f->R.rdi);
-		break;
-	case SYS_WAIT:
-		f->R.rax = wait(f->R.rdi);
-		break;
-	case SYS_FORK:
-		f->R.rax = fork(f->R.rdi,f);
-		break;
-	case SYS_CREATE:
-		f->R.rax = create(f->R.rdi,f->R.rsi);
-		break;
-	case SYS_REMOVE:
-		f->R.rax = remove(f->R.rdi);
-		break;
-	case SYS_OPEN:
-		f->R.rax = open(f->R.rdi);
-		break;
-	case SYS_FILESIZE:
-		f->R.rax = filesize(f->R.rdi);
-		break;
-	case SYS_READ:
-		f->R.rax = read(f->R.rdi,f->R.rsi,f->R.rdx);
-		break;
-	case SYS_WRITE:
-		f->R.rax = write(f->R.rdi,(char*)f->R.rsi,f->R.rdx);
-		break;	
-	case SYS_SEEK:
-		seek(f->R.rdi,f->R.rsi);
-		break;
-	case SYS_TELL:
-		f->R.rax = tell(f->R.rdi);
-		break;
-	case SYS_CLOSE:
-		close(f->R.rdi);
-		break;
-	
-	default:
+syscall_handler (struct intr_frame *f) {
+	const struct syscall *sc;
+	uint64_t arg[6];
+
+	if (f->R.rax >= SYSCALL_CNT || syscall_table[f->R.rax].func == NULL)
 		exit(-1);
-		break;
+	sc = &syscall_table[f->R.rax];
+
+	/* Fetch only the argument registers the call uses. */
+	switch (sc->argc) {
+	case 6: arg[5] = f->R.r9;   /* Fall through. */
+	case 5: arg[4] = f->R.r8;   /* Fall through. */
+	case 4: arg[3] = f->R.r10;  /* Fall through. */
+	case 3: arg[2] = f->R.rdx;  /* Fall through. */
+	case 2: arg[1] = f->R.rsi;  /* Fall through. */
+	case 1: arg[0] = f->R.rdi;  /* Fall through. */
+	case 0: break;
 	}
+
+	f->R.rax = dispatch (sc, arg, f);
+}
+
+/* Handler for the system calls in syscall_fast_mask, called
+   from syscall-entry.S with the first four argument registers
+   and the system call number NR, and no intr_frame. */
+uint64_t
+syscall_fast_handler (uint64_t arg0, uint64_t arg1, uint64_t arg2,
+		uint64_t arg3, uint64_t nr) {
+	const uint64_t arg[4] = {arg0, arg1, arg2, arg3};
+
+	return dispatch (&syscall_table[nr], arg, NULL);
 }
-//유효성 체크를 위한 
-void check_address(const uint64_t *useradd){
-	struct thread *curr = thread_current();
 
-	if(useradd == NULL || !(is_user_vaddr(useradd)) || pml4_get_page(curr->pml4,useradd) == NULL){
+/* Prints the count and latency of each system call that was
+   made at least once. */
+void
+syscall_print_stats (void) {
+	uint64_t total = 0;
+	size_t i;
+
+	for (i = 0; i < SYSCALL_CNT; i++)
+		total += syscall_stat[i].cnt;
+	printf ("Syscall: %llu calls\n", total);
+	for (i = 0; i < SYSCALL_CNT; i++) {
+		const struct histogram *h = &syscall_stat[i].latency;
+
+		if (syscall_stat[i].cnt == 0)
+			continue;
+		printf ("Syscall: %s: %llu calls, cycles mean %llu, p50 %llu, "
+				"p99 %llu, max %llu\n", syscall_table[i].name,
+				syscall_stat[i].cnt, histogram_mean (h),
+				histogram_percentile (h, 500), histogram_percentile (h, 990),
+				h->max);
+	}
+}
+
+static uint64_t
+sys_halt (const uint64_t arg[] UNUSED, struct intr_frame *f UNUSED) {
+	halt();
+}
+
+static uint64_t
+sys_exit (const uint64_t arg[], struct intr_frame *f UNUSED) {
+	exit(arg[0]);
+}
+
+static uint64_t
+sys_fork (const uint64_t arg[], struct intr_frame *f) {
+	return fork((const char *) arg[0], f);
+}
+
+static uint64_t
+sys_exec (const uint64_t arg[], struct intr_frame *f UNUSED) {
+	return exec((const char *) arg[0]);
+}
+
+static uint64_t
+sys_wait (const uint64_t arg[], struct intr_frame *f UNUSED) {
+	return wait(arg[0]);
+}
 
+static uint64_t
+sys_create (const uint64_t arg[], struct intr_frame *f UNUSED) {
+	return create((const char *) arg[0], arg[1]);
+}
+
+static uint64_t
+sys_remove (const uint64_t arg[], struct intr_frame *f UNUSED) {
+	return remove((const char *) arg[0]);
+}
+
+static uint64_t
+sys_open (const uint64_t arg[], struct intr_frame *f UNUSED) {
+	return open((const char *) arg[0]);
+}
+
+static uint64_t
+sys_filesize (const uint64_t arg[], struct intr_frame *f UNUSED) {
+	return filesize(arg[0]);
+}
+
+static uint64_t
+sys_read (const uint64_t arg[], struct intr_frame *f UNUSED) {
+	return read(arg[0], (void *) arg[1], arg[2]);
+}
+
+static uint64_t
+sys_write (const uint64_t arg[], struct intr_frame *f UNUSED) {
+	return write(arg[0], (const void *) arg[1], arg[2]);
+}
+
+static uint64_t
+sys_seek (const uint64_t arg[], struct intr_frame *f UNUSED) {
+	seek(arg[0], arg[1]);
+	return 0;
+}
+
+static uint64_t
+sys_tell (const uint64_t arg[], struct intr_frame *f UNUSED) {
+	return tell(arg[0]);
+}
+
+static uint64_t
+sys_close (const uint64_t arg[], struct intr_frame *f UNUSED) {
+	close(arg[0]);
+	return 0;
+}
+
+static uint64_t
+sys_trace_read (const uint64_t arg[], struct intr_frame *f UNUSED) {
+	return trace_read((void *) arg[0], arg[1]);
+}
+
+static uint64_t
+sys_readv (const uint64_t arg[], struct intr_frame *f UNUSED) {
+	return readv(arg[0], (const struct iovec *) arg[1], arg[2]);
+}
+
+static uint64_t
+sys_writev (const uint64_t arg[], struct intr_frame *f UNUSED) {
+	return writev(arg[0], (const struct iovec *) arg[1], arg[2]);
+}
+
+static uint64_t
+sys_pread (const uint64_t arg[], struct intr_frame *f UNUSED) {
+	return pread(arg[0], (void *) arg[1], arg[2], arg[3]);
+}
+
+static uint64_t
+sys_pwrite (const uint64_t arg[], struct intr_frame *f UNUSED) {
+	return pwrite(arg[0], (const void *) arg[1], arg[2], arg[3]);
+}
+
+static uint64_t
+sys_copy_file_range (const uint64_t arg[], struct intr_frame *f UNUSED) {
+	return copy_file_range(arg[0], arg[1], arg[2]);
+}
+
+static uint64_t
+sys_syscall_stats (const uint64_t arg[], struct intr_frame *f UNUSED) {
+	return syscall_stats((struct syscall_stat *) arg[0], arg[1]);
+}
+
+static uint64_t
+sys_ioring_setup (const uint64_t arg[], struct intr_frame *f UNUSED) {
+	return (uint64_t) ioring_setup((void *) arg[0]);
+}
+
+static uint64_t
+sys_ioring_enter (const uint64_t arg[], struct intr_frame *f UNUSED) {
+	return ioring_enter(arg[0]);
+}
+
+static uint64_t
+sys_getpid (const uint64_t arg[] UNUSED, struct intr_frame *f UNUSED) {
+	return getpid();
+}
+
+static uint64_t
+sys_spawn (const uint64_t arg[], struct intr_frame *f UNUSED) {
+	return spawn((const char *) arg[0], (char *const *) arg[1]);
+}
+
+static uint64_t
+sys_yield (const uint64_t arg[] UNUSED, struct intr_frame *f UNUSED) {
+	yield();
+	return 0;
+}
+
+/* Copies the user string USTR into the SIZE-byte kernel buffer
+   DST, killing the process if USTR is a bad pointer.  Returns
+   false if the string is too long for DST. */
+static bool
+get_user_string (char *dst, const char *ustr, size_t size) {
+	int len = strncpy_from_user(dst, ustr, size);
+
+	if (len < 0)
 		exit(-1);
-		
+	return (size_t) len < size;
+}
+
+/* Copies the IOVCNT-entry vector at IOV into a new kernel array
+   and checks that every buffer it names lies in user space, all
+   before any data moves.  Kills the process if a pointer is bad.
+   Returns the array, which the caller must free, or a null
+   pointer if IOVCNT is out of range, the total length does not
+   fit in the int return value, or memory runs out. */
+static struct iovec *
+get_user_iovec (const struct iovec *iov, int iovcnt) {
+	struct iovec *kiov;
+	size_t total = 0;
+	int i;
+
+	if (iovcnt <= 0 || iovcnt > IOV_MAX)
+		return NULL;
+	kiov = malloc(iovcnt * sizeof *kiov);
+	if (kiov == NULL)
+		return NULL;
+	if (!copy_from_user(kiov, iov, iovcnt * sizeof *kiov)) {
+		free(kiov);
+		exit(-1);
+	}
+	for (i = 0; i < iovcnt; i++) {
+		if (!is_user_range(kiov[i].iov_base, kiov[i].iov_len)) {
+			free(kiov);
+			exit(-1);
+		}
+		if (kiov[i].iov_len > INT_MAX - total) {
+			free(kiov);
+			return NULL;
+		}
+		total += kiov[i].iov_len;
+	}
+	return kiov;
+}
+
+/* Reads up to SIZE bytes from the keyboard into BUFFER, stopping
+   after a null character.  Returns the number of bytes read,
+   not counting the null. */
+static size_t
+read_console (uint8_t *buffer, size_t size) {
+	size_t i;
+
+	for (i = 0; i < size; i++) {
+		buffer[i] = input_getc();
+		if (buffer[i] == '\0')
+			break;
+	}
+	return i;
+}
+
+/* Reads up to LENGTH bytes into the user buffer UBUF from the
+   keyboard, if FILEOBJ is null, or from FILEOBJ at offset OFS,
+   a chunk at a time through a buffer on the stack.  Returns the
+   number of bytes read, or -1 if UBUF is bad. */
+static int
+read_to_user (struct file *fileobj, off_t ofs, uint8_t *ubuf,
+		size_t length) {
+	uint8_t bounce[BOUNCE_SIZE];
+	size_t total = 0;
+
+	while (total < length) {
+		size_t chunk = length - total < BOUNCE_SIZE ? length - total : BOUNCE_SIZE;
+		size_t n;
+
+		if (fileobj == NULL)
+			n = read_console(bounce, chunk);
+		else
+			n = file_read_at(fileobj, bounce, chunk, ofs + total);
+		if (!copy_to_user(ubuf + total, bounce, n))
+			return -1;
+		total += n;
+		if (n < chunk)
+			break;
+	}
+	return total;
+}
+
+/* Writes up to LENGTH bytes from the user buffer UBUF to the
+   console, if FILEOBJ is null, or to FILEOBJ at offset OFS, a
+   chunk at a time through a buffer on the stack.  Returns the
+   number of bytes written, or -1 if UBUF is bad. */
+static int
+write_from_user (struct file *fileobj, off_t ofs, const uint8_t *ubuf,
+		size_t length) {
+	uint8_t bounce[BOUNCE_SIZE];
+	size_t total = 0;
+
+	while (total < length) {
+		size_t chunk = length - total < BOUNCE_SIZE ? length - total : BOUNCE_SIZE;
+		size_t n;
+
+		if (!copy_from_user(bounce, ubuf + total, chunk))
+			return -1;
+		if (fileobj == NULL) {
+			putbuf((const char *) bounce, chunk);
+			n = chunk;
+		} else
+			n = file_write_at(fileobj, bounce, chunk, ofs + total);
+		total += n;
+		if (n < chunk)
+			break;
+	}
+	return total;
+}
+
+/* Common body of read(), readv() and pread(): reads into the
+   IOVCNT buffers at IOV, already checked to lie in user space,
+   from FD at offset OFS or, if OFS is negative, at FD's current
+   position, which is then advanced.  A short read ends the
+   call. */
+static int
+do_read (int fd, const struct iovec *iov, int iovcnt, off_t ofs) {
+	struct file *fileobj = NULL;
+	bool advance = ofs < 0;
+	int total = 0;
+	int i;
+
+	if (fd == 1)
+		return -1;
+	if (fd != 0) {
+		fileobj = find_file_by_fd(fd);
+		if (fileobj == NULL)
+			return -1;
+		if (advance)
+			ofs = file_tell(fileobj);
+	}
+
+	for (i = 0; i < iovcnt; i++) {
+		int n = read_to_user(fileobj, ofs + total, iov[i].iov_base,
+				iov[i].iov_len);
+
+		if (n < 0)
+			exit(-1);
+		total += n;
+		if ((size_t) n < iov[i].iov_len)
+			break;
+	}
+
+	if (fileobj != NULL && advance)
+		file_seek(fileobj, ofs + total);
+	return total;
+}
+
+/* Common body of write(), writev() and pwrite(), the
+   counterpart of do_read(). */
+static int
+do_write (int fd, const struct iovec *iov, int iovcnt, off_t ofs) {
+	struct file *fileobj = NULL;
+	bool advance = ofs < 0;
+	int total = 0;
+	int i;
+
+	if (fd == 0)
+		return -1;
+	if (fd != 1) {
+		fileobj = find_file_by_fd(fd);
+		if (fileobj == NULL)
+			return -1;
+		if (advance)
+			ofs = file_tell(fileobj);
 	}
+
+	for (i = 0; i < iovcnt; i++) {
+		int n = write_from_user(fileobj, ofs + total, iov[i].iov_base,
+				iov[i].iov_len);
+
+		if (n < 0)
+			exit(-1);
+		total += n;
+		if ((size_t) n < iov[i].iov_len)
+			break;
+	}
+
+	if (fileobj != NULL && advance)
+		file_seek(fileobj, ofs + total);
+	return total;
 }
 
 void halt (void) {
@@ -126,50 +584,148 @@ void exit (int status) {
 }
 
 pid_t fork(const char *thread_name, struct intr_frame *f){
-	return process_fork(thread_name,f);
+	char name[16];
+
+	if (strncpy_from_user(name, thread_name, sizeof name) < 0)
+		exit(-1);
+	return process_fork(name,f);
 }
 
 int exec (const char *file) {
-	check_address(file);
+	struct exec_args *args;
+	int len;
 
-	char *file_copy;
-    file_copy = palloc_get_page (PAL_ZERO);
-	
-	if(file_copy == NULL)
+	/* Measure the command line, then copy it once into a buffer of
+	   just the right size. */
+	len = strnlen_user (file, PGSIZE);
+	if (len < 0 || len == PGSIZE)
+		exit(-1);
+	args = exec_args_create (len + 1);
+	if (args == NULL)
 		exit(-1);
-	
-	strlcpy (file_copy, file, strlen(file)+1);
-	
-	if(process_exec(file_copy) == -1){
-		//printf("여기 넘어오나요?");
+	if (strncpy_from_user (args->strs, file, len + 1) != len) {
+		free (args);
 		exit(-1);
 	}
-		
+	exec_args_split (args);
+
+	if (process_exec (args) == -1)
+		exit(-1);
+	NOT_REACHED ();
+}
+
+/* Starts a new process running FILE, with arguments ARGV, a
+   null-terminated array like main()'s, or just FILE if ARGV is
+   null.  The child gets a fresh address space loaded from FILE
+   and a copy of the caller's file descriptors, as if the caller
+   forked and the child then ran exec(), but without copying the
+   caller's memory.  Unlike exec(), arguments may contain spaces.
+   Returns the child's pid, or -1 if FILE cannot be loaded or
+   the arguments do not fit on its stack. */
+pid_t spawn (const char *file, char *const argv[]) {
+	char name[NAME_BUF_SIZE];
+	struct exec_args *args;
+	size_t size = 0;
+	char *dst;
+	int argc, i;
+	pid_t pid;
+
+	if (!get_user_string(name, file, sizeof name))
+		return PID_ERROR;
+
+	if (argv == NULL) {
+		args = exec_args_create (strlen (name) + 1);
+		if (args == NULL)
+			return PID_ERROR;
+		strlcpy (args->strs, name, args->size);
+		args->argc = 1;
+	} else {
+		/* Measure the arguments, then copy them back to back into
+		   a buffer of just the right size. */
+		for (argc = 0; ; argc++) {
+			const char *uarg;
+			int len;
+
+			if (!copy_from_user(&uarg, &argv[argc], sizeof uarg))
+				exit(-1);
+			if (uarg == NULL)
+				break;
+			len = strnlen_user(uarg, PGSIZE);
+			if (len < 0)
+				exit(-1);
+			size += len + 1;
+			/* The strings share the child's stack page with
+			   argv[0] through argv[ARGC] and a return address. */
+			if (size + (argc + 3) * sizeof (char *) > PGSIZE)
+				return PID_ERROR;
+		}
+
+		args = exec_args_create (size);
+		if (args == NULL)
+			return PID_ERROR;
+		args->argc = argc;
+		dst = args->strs;
+		for (i = 0; i < argc; i++) {
+			const char *uarg;
+
+			if (!copy_from_user(&uarg, &argv[i], sizeof uarg)
+					|| strncpy_from_user(dst, uarg,
+						args->strs + size - dst) < 0) {
+				free (args);
+				exit(-1);
+			}
+			dst += strlen (dst) + 1;
+		}
+	}
+
+	pid = process_spawn(name, args);
+	free (args);
+	return pid;
+}
+
+/* Returns the process's pid, which is its thread's tid. */
+pid_t getpid (void) {
+	return thread_current()->tid;
 }
 
 int wait (pid_t pid) {
 	return process_wait(pid);
 }
 
+/* Gives up the CPU to any other thread of the same priority that
+   is ready to run. */
+void yield (void) {
+	thread_yield();
+}
+
 bool create (const char *file, unsigned initial_size) {
-	check_address(file);
-	return filesys_create(file, initial_size);
+	char name[NAME_BUF_SIZE];
+
+	if (!get_user_string(name, file, sizeof name))
+		return false;
+	return filesys_create(name, initial_size);
 }
 
 bool remove (const char *file) {
-	check_address(file);
-	return filesys_remove(file);
+	char name[NAME_BUF_SIZE];
+
+	if (!get_user_string(name, file, sizeof name))
+		return false;
+	return filesys_remove(name);
 }
 
 int open (const char *file) {
-	check_address(file);
-	struct file *fileobj = filesys_open(file);
+	char name[NAME_BUF_SIZE];
+
+	if (!get_user_string(name, file, sizeof name))
+		return -1;
+	struct file *fileobj = filesys_open(name);
 
 	if(fileobj == NULL)
 		return -1;
 
 	// file을 fd table에 추가 성공하면 fd리턴 아니면 -1
-	int fd = add_file_to_fdt(fileobj);
+	int fd = fd_table_add(&thread_current()->fdt, fileobj);
 
 	// 실패 했다면(자리 없다면) close
 	if(fd == -1)
@@ -185,127 +741,186 @@ int filesize (int fd) {
 }
 
 int read (int fd, void *buffer, unsigned length) {
-	check_address(buffer);
-	int ret;
-	if(fd == 0){
-		int i;
-		unsigned char *buf = buffer;
-		for(i=0;i<length;i++){
-			char c = input_getc();
-			*buf++ = c;
-			if(c == '\0')
-				break;
-		}
-		ret = i;
-	}else if(fd == 1){
-		return -1;
-	}else{
-		struct thread *curr = thread_current();
-		struct file *fileobj = find_file_by_fd(fd);
+	struct iovec iov = { buffer, length };
 
-		if(fileobj == NULL)
-			return -1;
-
-		lock_acquire(&file_lock);
-		ret = file_read(fileobj,buffer,length);
-		lock_release(&file_lock);
-	}
-	return ret;
+	if (!is_user_range(buffer, length))
+		exit(-1);
+	return do_read(fd, &iov, 1, -1);
 }
 
 int write (int fd, const void *buffer, unsigned length) {
+	struct iovec iov = { (void *) buffer, length };
 
-	check_address(buffer);
-	int ret;
-
-	if(fd == 1){ // 표준 출력 : 버퍼의 내용 콘솔창으로 출력
-		putbuf(buffer,length);
-		ret = length;
-	}else if(fd == 0){// 표준 입력
-		return -1;
-	}else {
-		struct thread *curr = thread_current();
-		struct file *fileobj = find_file_by_fd(fd);
-
-		if(fileobj == NULL)
-			return -1;
-
-		lock_acquire(&file_lock);
-		ret = file_write(fileobj,buffer,length);
-		lock_release(&file_lock);
-		
-	}
-	return ret;
+	if (!is_user_range(buffer, length))
+		exit(-1);
+	return do_write(fd, &iov, 1, -1);
 }
 
 void seek (int fd, unsigned position) {
 	struct file *fileobj = find_file_by_fd(fd);
-	if(fileobj <= 2)
+	if(fileobj == NULL)
 		return;
 	file_seek(fileobj,position);
 }
 
 unsigned tell (int fd) {
 	struct file *fileobj = find_file_by_fd(fd);
-	if(fileobj<=2)
+	if(fileobj == NULL)
 		return;
 	return file_tell(fileobj);
 }
 
 void close (int fd) {
-	if(fd ==0 || fd == 1)
-		return;
-	else{
-		struct thread *curr = thread_current();
-		struct file *fileobj = find_file_by_fd(fd);
+	fd_table_close(&thread_current()->fdt, fd);
+}
 
-		if(fileobj == NULL)
-			return;
-		remove_file_from_fdt(fd);
-		file_close(fileobj);
+/* Copies the scheduler trace, oldest event first, into BUFFER,
+   which is SIZE bytes long.  Returns the number of bytes copied,
+   always a multiple of sizeof (struct trace_event). */
+int trace_read (void *buffer, unsigned size) {
+	void *events;
+	int n;
+
+	if (!is_user_range(buffer, size))
+		exit(-1);
+	if (size > TRACE_SIZE * sizeof (struct trace_event))
+		size = TRACE_SIZE * sizeof (struct trace_event);
+	if (size == 0)
+		return 0;
+	events = malloc(size);
+	if (events == NULL)
+		return -1;
+	n = trace_copy(events, size);
+	if (!copy_to_user(buffer, events, n)) {
+		free(events);
+		exit(-1);
 	}
+	free(events);
+	return n;
 }
 
-//file descriptor 서브 함수들 
+/* readv/writev move a whole iovec in one system call.  The
+   vector is copied in and checked once, then data moves like a
+   read() or write() of each segment in turn, from the current
+   position, which is advanced once at the end.  A short
+   transfer ends the call, like a short read() would. */
+int readv (int fd, const struct iovec *iov, int iovcnt) {
+	struct iovec *kiov;
+	int ret;
 
-/* fdt안에 파일 넣기*/
-int add_file_to_fdt(struct file *file){
-	struct thread *curr = thread_current();
-	struct file **fdt = curr->fdt;
-	
-	// file 자리 찾기 : FDCOUNT_LIMIT 범위 안에서 fdt NULL인곳 찾기
-	//                  최근 파일 이후부터 확인 
-	while(curr->fd_index < FDCOUNT_LIMIT && fdt[curr->fd_index])
-		curr-> fd_index++;
-	
-	if(curr->fd_index >= FDCOUNT_LIMIT)
+	if (iovcnt == 0)
+		return 0;
+	kiov = get_user_iovec(iov, iovcnt);
+	if (kiov == NULL)
 		return -1;
-	
-	//넣어주고
-	fdt[curr->fd_index] = file;
+	ret = do_read(fd, kiov, iovcnt, -1);
+	free(kiov);
+	return ret;
+}
 
-	//fd_index 반환
-	return curr->fd_index;
+int writev (int fd, const struct iovec *iov, int iovcnt) {
+	struct iovec *kiov;
+	int ret;
+
+	if (iovcnt == 0)
+		return 0;
+	kiov = get_user_iovec(iov, iovcnt);
+	if (kiov == NULL)
+		return -1;
+	ret = do_write(fd, kiov, iovcnt, -1);
+	free(kiov);
+	return ret;
 }
 
-/* fdt에서 file 지우기 */
-void remove_file_from_fdt(int fd){
-	struct thread *curr = thread_current();
+/* pread/pwrite transfer at OFFSET without touching the file
+   position, saving the seek() round trip of random access.
+   They are not defined on the console. */
+int pread (int fd, void *buffer, unsigned length, off_t offset) {
+	struct iovec iov = { buffer, length };
 
-	//파일 디스크럽터는 정수이고, 최대값 넘지 않아야
-	if(fd < 0 || fd > FDCOUNT_LIMIT)
-		return NULL;
-	curr -> fdt[fd] = NULL;
+	if (!is_user_range(buffer, length))
+		exit(-1);
+	if (fd == 0 || fd == 1 || offset < 0)
+		return -1;
+	return do_read(fd, &iov, 1, offset);
 }
 
-/* 만약 유효성 검사 통과하면 fd로 fdt안의 파일 꺼내기*/
-static struct file *find_file_by_fd(int fd){
-	struct thread *curr = thread_current();
-	
-	//파일 디스크럽터는 정수이고, 최대값 넘지 않아야
-	if(fd < 0 || fd > FDCOUNT_LIMIT)
-		return NULL;
-	
-	return curr-> fdt[fd];
+int pwrite (int fd, const void *buffer, unsigned length, off_t offset) {
+	struct iovec iov = { (void *) buffer, length };
+
+	if (!is_user_range(buffer, length))
+		exit(-1);
+	if (fd == 0 || fd == 1 || offset < 0)
+		return -1;
+	return do_write(fd, &iov, 1, offset);
+}
+
+/* Copies LENGTH bytes from FD_IN to FD_OUT inside the kernel,
+   from and to each file's current position, so a file copy
+   needs neither a user buffer nor a read()/write() pair per
+   chunk.  Copying a file onto an overlapping range of itself is
+   refused. */
+int copy_file_range (int fd_in, int fd_out, unsigned length) {
+	struct file *in, *out;
+	off_t in_pos, out_pos;
+
+	if (fd_in == 0 || fd_in == 1 || fd_out == 0 || fd_out == 1)
+		return -1;
+	in = find_file_by_fd(fd_in);
+	out = find_file_by_fd(fd_out);
+	if (in == NULL || out == NULL || length > INT_MAX)
+		return -1;
+
+	in_pos = file_tell(in);
+	out_pos = file_tell(out);
+	if (file_get_inode(in) == file_get_inode(out)
+			&& in_pos < (int64_t) out_pos + length
+			&& out_pos < (int64_t) in_pos + length)
+		return -1;
+	return file_copy_range(in, out, length);
+}
+
+/* Copies the statistics of the first CNT system calls, indexed
+   by system call number, into STATS.  Returns the number of
+   system call numbers the kernel knows, which may be more or
+   less than CNT; entries for unimplemented calls are zero. */
+int syscall_stats (struct syscall_stat *stats, int cnt) {
+	struct syscall_stat *kstats;
+	int i;
 
-}
\ No newline at end of file
+	if (cnt < 0)
+		return -1;
+	if ((size_t) cnt > SYSCALL_CNT)
+		cnt = SYSCALL_CNT;
+	if (!is_user_range(stats, cnt * sizeof *stats))
+		exit(-1);
+	if (cnt == 0)
+		return SYSCALL_CNT;
+	kstats = malloc(cnt * sizeof *kstats);
+	if (kstats == NULL)
+		return -1;
+
+	for (i = 0; i < cnt; i++) {
+		const struct histogram *h = &syscall_stat[i].latency;
+
+		kstats[i].cnt = syscall_stat[i].cnt;
+		kstats[i].mean = histogram_mean (h);
+		kstats[i].p50 = histogram_percentile (h, 500);
+		kstats[i].p99 = histogram_percentile (h, 990);
+		kstats[i].max = h->max;
+	}
+
+	if (!copy_to_user(stats, kstats, cnt * sizeof *kstats)) {
+		free(kstats);
+		exit(-1);
+	}
+	free(kstats);
+	return SYSCALL_CNT;
+}
+
+/* Returns the file open as FD in the current process, or a null
+   pointer if FD is not open or is the console. */
+static struct file *
+find_file_by_fd (int fd) {
+	return fd_table_get(&thread_current()->fdt, fd);
+}
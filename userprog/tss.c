@@ -2,6 +2,7 @@
 #include <debug.h>
 #include <stddef.h>
 #include "userprog/gdt.h"
+#include "threads/cpu.h"
 #include "threads/thread.h"
 #include "threads/palloc.h"
 #include "threads/vaddr.h"
@@ -43,32 +44,41 @@
  *      not in use, so we can always use that.  Thus, when the
  *      scheduler switches threads, it also changes the TSS's
  *      stack pointer to point to the new thread's kernel stack.
- *      (The call is in schedule in thread.c.) */
+ *      (The call is in schedule in thread.c.)
+ *
+ *  Each CPU runs its own thread, so each needs its own TSS.  It
+ *  hangs off the CPU's struct cpu, where syscall-entry.S also
+ *  finds it.  An application processor sets its TSS up with
+ *  interrupts off, before it may sleep in palloc, so the TSSes
+ *  are static. */
 
-/* Kernel TSS. */
-struct task_state *tss;
+/* Kernel TSSes, one per CPU. */
+static struct task_state tss_area[CPU_MAX];
 
-/* Initializes the kernel TSS. */
+/* Initializes the running CPU's TSS. */
 void
 tss_init (void) {
+	struct cpu *c = cpu_current ();
+
 	/* Our TSS is never used in a call gate or task gate, so only a
 	 * few fields of it are ever referenced, and those are the only
 	 * ones we initialize. */
-	tss = palloc_get_page (PAL_ASSERT | PAL_ZERO);
+	c->tss = &tss_area[c->id];
 	tss_update (thread_current ());
 }
 
-/* Returns the kernel TSS. */
+/* Returns the running CPU's TSS. */
 struct task_state *
 tss_get (void) {
+	struct task_state *tss = cpu_current ()->tss;
+
 	ASSERT (tss != NULL);
 	return tss;
 }
 
-/* Sets the ring 0 stack pointer in the TSS to point to the end
- * of the thread stack. */
+/* Sets the ring 0 stack pointer in the running CPU's TSS to
+ * point to the end of the thread stack. */
 void
 tss_update (struct thread *next) {
-	ASSERT (tss != NULL);
-	tss->rsp0 = (uint64_t) next + PGSIZE;
+	tss_get ()->rsp0 = (uint64_t) next + PGSIZE;
 }
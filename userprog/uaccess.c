@@ -0,0 +1,153 @@
+#include "userprog/uaccess.h"
+#include <debug.h>
+
+/* Access to user memory from the kernel.
+
+   System calls used to validate user pointers by walking the
+   page table for each one (check_address()) before touching
+   them.  That is slow for large buffers, and for a buffer
+   spanning several pages only the first was ever checked.
+
+   Instead, the functions here check only that a range lies
+   below KERN_BASE and then access it directly.  Each instruction
+   that touches user memory is listed in an exception table
+   along with a fixup address.  If it faults, the page fault
+   handler finds it there (see uaccess_fixup()) and resumes at
+   the fixup, which makes the function report failure.  The cost
+   of validation is therefore constant, and a bad pointer is
+   found exactly where it is used. */
+
+/* An entry in the exception table: if the instruction at INSN
+   faults, resume at FIXUP. */
+struct exception_entry {
+	uintptr_t insn;
+	uintptr_t fixup;
+};
+
+/* Start and end of the exception table, from kernel.lds.S. */
+extern const struct exception_entry __start_ex_table[];
+extern const struct exception_entry __stop_ex_table[];
+
+/* Emits an exception table entry that sends a fault at label
+   INSN to label FIXUP. */
+#define EX_ENTRY(INSN, FIXUP)                   \
+	".pushsection .ex_table, \"a\"\n\t"         \
+	".balign 8\n\t"                             \
+	".quad " #INSN ", " #FIXUP "\n\t"           \
+	".popsection\n\t"
+
+/* Copies SIZE bytes from SRC to DST, either of which may be in
+   user memory, with a single "rep movsb".  If the copy faults,
+   RCX holds the count of bytes not copied and the fixup simply
+   falls through with it.  Returns the number of bytes not
+   copied. */
+static inline size_t
+copy_user (void *dst, const void *src, size_t size) {
+	asm volatile ("1: rep movsb\n\t"
+	              "2:\n\t"
+	              EX_ENTRY (1b, 2b)
+	              : "+c" (size), "+D" (dst), "+S" (src)
+	              : : "memory");
+	return size;
+}
+
+/* Returns the byte at user address UADDR, or -1 if reading it
+   faults. */
+static inline int
+get_user (const uint8_t *uaddr) {
+	int64_t result;
+
+	asm volatile ("movq $-1, %0\n\t"
+	              "1: movzbq %1, %0\n\t"
+	              "2:\n\t"
+	              EX_ENTRY (1b, 2b)
+	              : "=&r" (result) : "m" (*uaddr));
+	return result;
+}
+
+/* Copies SIZE bytes from user address USRC to kernel address
+   DST.  Returns true if successful, false if USRC is not a valid
+   user range, in which case DST may have been partly written. */
+bool
+copy_from_user (void *dst, const void *usrc, size_t size) {
+	if (!is_user_range (usrc, size))
+		return false;
+	return copy_user (dst, usrc, size) == 0;
+}
+
+/* Copies SIZE bytes from kernel address SRC to user address
+   UDST.  Returns true if successful, false if UDST is not a
+   valid, writable user range, in which case UDST may have been
+   partly written.  Read-only pages fault, rather than being
+   written, because start.S sets CR0.WP. */
+bool
+copy_to_user (void *udst, const void *src, size_t size) {
+	if (!is_user_range (udst, size))
+		return false;
+	return copy_user (udst, src, size) == 0;
+}
+
+/* Copies the null-terminated string at user address USRC into
+   DST, which is SIZE bytes long.  Returns the length of the
+   string, or SIZE if it does not fit, in which case DST holds
+   its first SIZE - 1 characters and a null terminator.  Returns
+   -1 if USRC is not a valid user string. */
+int
+strncpy_from_user (char *dst, const char *usrc, size_t size) {
+	const uint8_t *p = (const uint8_t *) usrc;
+	size_t i;
+
+	ASSERT (size > 0);
+
+	for (i = 0; i < size; i++) {
+		int c;
+
+		if (!is_user_vaddr (p + i))
+			return -1;
+		c = get_user (p + i);
+		if (c < 0)
+			return -1;
+		dst[i] = c;
+		if (c == '\0')
+			return i;
+	}
+	dst[size - 1] = '\0';
+	return size;
+}
+
+/* Returns the length of the null-terminated string at user
+   address USRC, or SIZE if it has no null terminator within its
+   first SIZE bytes.  Returns -1 if USRC is not a valid user
+   string.  Lets a caller allocate exactly enough room before
+   copying a string with strncpy_from_user(). */
+int
+strnlen_user (const char *usrc, size_t size) {
+	const uint8_t *p = (const uint8_t *) usrc;
+	size_t i;
+
+	for (i = 0; i < size; i++) {
+		int c;
+
+		if (!is_user_vaddr (p + i))
+			return -1;
+		c = get_user (p + i);
+		if (c < 0)
+			return -1;
+		if (c == '\0')
+			return i;
+	}
+	return size;
+}
+
+/* Returns the address at which to resume after a page fault at
+   RIP, or 0 if the instruction at RIP is not expected to fault.
+   Called by the page fault handler. */
+uintptr_t
+uaccess_fixup (uintptr_t rip) {
+	const struct exception_entry *e;
+
+	for (e = __start_ex_table; e < __stop_ex_table; e++)
+		if (e->insn == rip)
+			return e->fixup;
+	return 0;
+}